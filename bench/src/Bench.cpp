@@ -0,0 +1,449 @@
+#include <FWU/ConcurrentLooseOctree.hpp>
+#include <FWU/LooseOctree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/** LooseOctree benchmarks.
+ *
+ * Runs insert, search, move-update, publish (ConcurrentLooseOctree snapshot of
+ * the whole tree), erase and churn (erase and insert, which keeps cleanup busy)
+ * workloads on uniform, clustered and mostly static data for 1k to max_items
+ * items. Results go to stdout as CSV, one row per
+ * workload:
+ *
+ *   * ns_per_op: Wall time per operation.
+ *   * allocs_per_op: Heap allocations per operation (whole process).
+ *   * peak_bytes: Maximum heap growth during the workload.
+ *   * checksum: Workload result (e.g. number of hits), equal between runs.
+ *
+ * Usage: bench [max_items] (default 1000000).
+ */
+
+namespace {
+
+struct HeapStats {
+	std::size_t num_allocations;
+	std::size_t current_bytes;
+	std::size_t peak_bytes;
+};
+
+// Keeps the alignment of operator new.
+const std::size_t HEADER_SIZE = 16;
+
+HeapStats heap_stats = { 0, 0, 0 };
+
+}
+
+void* operator new( std::size_t size ) {
+	char* block = static_cast<char*>( std::malloc( size + HEADER_SIZE ) );
+
+	if( !block ) {
+		throw std::bad_alloc();
+	}
+
+	std::memcpy( block, &size, sizeof( size ) );
+
+	++heap_stats.num_allocations;
+	heap_stats.current_bytes += size;
+	heap_stats.peak_bytes = std::max( heap_stats.peak_bytes, heap_stats.current_bytes );
+
+	return block + HEADER_SIZE;
+}
+
+void operator delete( void* ptr ) noexcept {
+	if( !ptr ) {
+		return;
+	}
+
+	// Integer arithmetic, as the compiler can't see the header in front of ptr.
+	void* block = reinterpret_cast<void*>( reinterpret_cast<std::uintptr_t>( ptr ) - HEADER_SIZE );
+	std::size_t size = 0;
+
+	std::memcpy( &size, block, sizeof( size ) );
+	heap_stats.current_bytes -= size;
+	std::free( block );
+}
+
+void* operator new[]( std::size_t size ) {
+	return operator new( size );
+}
+
+void operator delete[]( void* ptr ) noexcept {
+	operator delete( ptr );
+}
+
+namespace {
+
+typedef util::LooseOctree<uint32_t> Tree;
+
+const Tree::Size WORLD_SIZE = 4096;
+const std::size_t NUM_QUERIES = 10000;
+const float QUERY_SIZE = 32.0f;
+const std::size_t NUM_CLUSTERS = 32;
+const float CLUSTER_RADIUS = 64.0f;
+
+/** Data distribution.
+ */
+struct Distribution {
+	const char* name;
+	bool clustered; ///< Data around a few centers instead of uniform.
+	float moving_fraction; ///< Fraction of data moved by the update workload.
+};
+
+const Distribution DISTRIBUTIONS[] = {
+	{ "uniform", false, 1.0f },
+	{ "clustered", true, 1.0f },
+	{ "static", false, 0.02f }
+};
+
+/** Deterministic random numbers, equal on all platforms.
+ */
+class Random {
+	public:
+		Random( uint32_t seed ) :
+			m_state( seed )
+		{
+		}
+
+		uint32_t next() {
+			m_state = m_state * 1664525u + 1013904223u;
+			return m_state >> 8;
+		}
+
+		float next_float( float min, float max ) {
+			return min + (max - min) * static_cast<float>( next() ) / static_cast<float>( 1u << 24 );
+		}
+
+		std::size_t next_index( std::size_t size ) {
+			return static_cast<std::size_t>( next() ) % size;
+		}
+
+	private:
+		uint32_t m_state;
+};
+
+/** Generates cuboids of a distribution.
+ */
+class Generator {
+	public:
+		Generator( const Distribution& distribution, uint32_t seed ) :
+			m_random( seed ),
+			m_clustered( distribution.clustered )
+		{
+			for( std::size_t cluster_idx = 0; cluster_idx < NUM_CLUSTERS; ++cluster_idx ) {
+				m_centers.push_back( Tree::DataVector(
+					m_random.next_float( CLUSTER_RADIUS, WORLD_SIZE - CLUSTER_RADIUS ),
+					m_random.next_float( CLUSTER_RADIUS, WORLD_SIZE - CLUSTER_RADIUS ),
+					m_random.next_float( CLUSTER_RADIUS, WORLD_SIZE - CLUSTER_RADIUS )
+				) );
+			}
+		}
+
+		Tree::DataVector next_position() {
+			if( !m_clustered ) {
+				return Tree::DataVector(
+					m_random.next_float( 0.0f, WORLD_SIZE ),
+					m_random.next_float( 0.0f, WORLD_SIZE ),
+					m_random.next_float( 0.0f, WORLD_SIZE )
+				);
+			}
+
+			// Sum of uniform offsets, denser towards the center.
+			const Tree::DataVector& center = m_centers[m_random.next_index( NUM_CLUSTERS )];
+			Tree::DataVector offset( 0.0f, 0.0f, 0.0f );
+
+			for( int sample = 0; sample < 3; ++sample ) {
+				offset.x += m_random.next_float( -CLUSTER_RADIUS, CLUSTER_RADIUS ) / 3.0f;
+				offset.y += m_random.next_float( -CLUSTER_RADIUS, CLUSTER_RADIUS ) / 3.0f;
+				offset.z += m_random.next_float( -CLUSTER_RADIUS, CLUSTER_RADIUS ) / 3.0f;
+			}
+
+			return center + offset;
+		}
+
+		Tree::DataCuboid next_cuboid() {
+			return make_cuboid( next_position(), m_random.next_float( 0.5f, 4.0f ) );
+		}
+
+		Tree::DataCuboid next_query() {
+			return make_cuboid( next_position(), QUERY_SIZE );
+		}
+
+		Tree::DataCuboid move( const Tree::DataCuboid& cuboid ) {
+			Tree::DataVector center(
+				cuboid.x + cuboid.width / 2.0f + m_random.next_float( -2.0f, 2.0f ),
+				cuboid.y + cuboid.height / 2.0f + m_random.next_float( -2.0f, 2.0f ),
+				cuboid.z + cuboid.depth / 2.0f + m_random.next_float( -2.0f, 2.0f )
+			);
+
+			return make_cuboid( center, cuboid.width );
+		}
+
+		Random& get_random() {
+			return m_random;
+		}
+
+	private:
+		static Tree::DataCuboid make_cuboid( const Tree::DataVector& center, float size ) {
+			// Keep the data inside the world.
+			float max = static_cast<float>( WORLD_SIZE ) - size;
+
+			return Tree::DataCuboid(
+				std::min( std::max( center.x - size / 2.0f, 0.0f ), max ),
+				std::min( std::max( center.y - size / 2.0f, 0.0f ), max ),
+				std::min( std::max( center.z - size / 2.0f, 0.0f ), max ),
+				size,
+				size,
+				size
+			);
+		}
+
+		Random m_random;
+		std::vector<Tree::DataVector> m_centers;
+		bool m_clustered;
+};
+
+/** Measures time and heap usage of one workload and prints it.
+ */
+class Measurement {
+	public:
+		Measurement( const char* workload, const Distribution& distribution, std::size_t num_items ) :
+			m_workload( workload ),
+			m_distribution( distribution ),
+			m_num_items( num_items ),
+			m_num_allocations( heap_stats.num_allocations ),
+			m_base_bytes( heap_stats.current_bytes )
+		{
+			heap_stats.peak_bytes = heap_stats.current_bytes;
+			m_start = std::chrono::steady_clock::now();
+		}
+
+		void finish( std::size_t num_ops, uint64_t checksum ) {
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double ns = static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>( end - m_start ).count() );
+			double ops = static_cast<double>( std::max( num_ops, static_cast<std::size_t>( 1 ) ) );
+
+			std::printf(
+				"%s,%s,%zu,%zu,%.2f,%.3f,%zu,%llu\n",
+				m_workload,
+				m_distribution.name,
+				m_num_items,
+				num_ops,
+				ns / ops,
+				static_cast<double>( heap_stats.num_allocations - m_num_allocations ) / ops,
+				heap_stats.peak_bytes - m_base_bytes,
+				static_cast<unsigned long long>( checksum )
+			);
+			std::fflush( stdout );
+		}
+
+	private:
+		const char* m_workload;
+		const Distribution& m_distribution;
+		std::size_t m_num_items;
+		std::size_t m_num_allocations;
+		std::size_t m_base_bytes;
+		std::chrono::steady_clock::time_point m_start;
+};
+
+void shuffle( std::vector<std::size_t>& indices, Random& random ) {
+	for( std::size_t idx = indices.size(); idx > 1; --idx ) {
+		std::swap( indices[idx - 1], indices[random.next_index( idx )] );
+	}
+}
+
+void run( const Distribution& distribution, std::size_t num_items ) {
+	Generator generator( distribution, 4711 );
+	std::vector<Tree::DataCuboid> cuboids;
+	std::vector<Tree::Handle> handles;
+
+	cuboids.reserve( num_items );
+	handles.reserve( num_items );
+
+	for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+		cuboids.push_back( generator.next_cuboid() );
+	}
+
+	Tree tree( WORLD_SIZE );
+
+	// Insert.
+	{
+		Measurement measurement( "insert", distribution, num_items );
+
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			handles.push_back( tree.insert( static_cast<uint32_t>( item_idx ), cuboids[item_idx] ) );
+		}
+
+		measurement.finish( num_items, tree.collect_stats().num_nodes );
+	}
+
+	// Search.
+	{
+		std::vector<Tree::DataCuboid> queries;
+
+		for( std::size_t query_idx = 0; query_idx < NUM_QUERIES; ++query_idx ) {
+			queries.push_back( generator.next_query() );
+		}
+
+		uint64_t num_hits = 0;
+		Measurement measurement( "search", distribution, num_items );
+
+		for( std::size_t query_idx = 0; query_idx < NUM_QUERIES; ++query_idx ) {
+			tree.search(
+				queries[query_idx],
+				[&num_hits]( const uint32_t& /*data*/, const Tree::DataCuboid& /*cuboid*/ ) -> bool {
+					++num_hits;
+					return true;
+				}
+			);
+		}
+
+		measurement.finish( NUM_QUERIES, num_hits );
+	}
+
+	// Move-update, moving data a little per round. Mostly static data needs
+	// more rounds for the same number of updates.
+	{
+		std::size_t num_moving = std::max( static_cast<std::size_t>( static_cast<float>( num_items ) * distribution.moving_fraction ), static_cast<std::size_t>( 1 ) );
+		std::size_t num_rounds = (num_items + num_moving - 1) / num_moving;
+		std::vector<std::size_t> moving( num_items );
+
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			moving[item_idx] = item_idx;
+		}
+
+		shuffle( moving, generator.get_random() );
+		moving.resize( num_moving );
+
+		std::vector<Tree::DataCuboid> targets;
+		targets.reserve( num_moving * num_rounds );
+
+		for( std::size_t round = 0; round < num_rounds; ++round ) {
+			for( std::size_t moving_idx = 0; moving_idx < num_moving; ++moving_idx ) {
+				Tree::DataCuboid& cuboid = cuboids[moving[moving_idx]];
+
+				cuboid = generator.move( cuboid );
+				targets.push_back( cuboid );
+			}
+		}
+
+		Measurement measurement( "update", distribution, num_items );
+
+		for( std::size_t target_idx = 0; target_idx < targets.size(); ++target_idx ) {
+			tree.update( handles[moving[target_idx % num_moving]], targets[target_idx] );
+		}
+
+		measurement.finish( targets.size(), tree.collect_stats().num_nodes );
+	}
+
+	// Publish the tree to readers. Two publishes first, so the measured ones
+	// recycle retired snapshots like a steady writer does.
+	{
+		static const std::size_t NUM_PUBLISHES = 10;
+		util::ConcurrentLooseOctree<uint32_t> concurrent( WORLD_SIZE );
+
+		concurrent.get_tree().assign( tree );
+		concurrent.publish();
+		concurrent.publish();
+
+		Measurement measurement( "publish", distribution, num_items );
+
+		for( std::size_t publish_idx = 0; publish_idx < NUM_PUBLISHES; ++publish_idx ) {
+			concurrent.publish();
+		}
+
+		measurement.finish( NUM_PUBLISHES, concurrent.read()->count_all() );
+	}
+
+	// Erase in random order.
+	{
+		std::vector<std::size_t> order( num_items );
+
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			order[item_idx] = item_idx;
+		}
+
+		shuffle( order, generator.get_random() );
+
+		Measurement measurement( "erase", distribution, num_items );
+
+		for( std::size_t order_idx = 0; order_idx < num_items; ++order_idx ) {
+			tree.erase( handles[order[order_idx]] );
+		}
+
+		measurement.finish( num_items, tree.collect_stats().num_nodes );
+	}
+
+	// Churn: replace a tenth of the data per round, creating and cleaning up
+	// nodes all the time.
+	{
+		handles.clear();
+
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			handles.push_back( tree.insert( static_cast<uint32_t>( item_idx ), cuboids[item_idx] ) );
+		}
+
+		static const std::size_t NUM_ROUNDS = 10;
+		std::size_t num_replaced = std::max( num_items / 10, static_cast<std::size_t>( 1 ) );
+		std::vector<std::size_t> order( num_items );
+		std::vector<std::size_t> replaced;
+		std::vector<Tree::DataCuboid> new_cuboids;
+
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			order[item_idx] = item_idx;
+		}
+
+		// Distinct items per round, so every erasure hits a valid handle.
+		for( std::size_t round = 0; round < NUM_ROUNDS; ++round ) {
+			shuffle( order, generator.get_random() );
+			replaced.insert( replaced.end(), order.begin(), order.begin() + static_cast<std::ptrdiff_t>( num_replaced ) );
+
+			for( std::size_t replaced_idx = 0; replaced_idx < num_replaced; ++replaced_idx ) {
+				new_cuboids.push_back( generator.next_cuboid() );
+			}
+		}
+
+		Measurement measurement( "churn", distribution, num_items );
+
+		for( std::size_t round = 0; round < NUM_ROUNDS; ++round ) {
+			std::size_t first = round * num_replaced;
+
+			for( std::size_t replaced_idx = first; replaced_idx < first + num_replaced; ++replaced_idx ) {
+				tree.erase( handles[replaced[replaced_idx]] );
+			}
+
+			for( std::size_t replaced_idx = first; replaced_idx < first + num_replaced; ++replaced_idx ) {
+				std::size_t item_idx = replaced[replaced_idx];
+				handles[item_idx] = tree.insert( static_cast<uint32_t>( item_idx ), new_cuboids[replaced_idx] );
+			}
+		}
+
+		measurement.finish( 2 * NUM_ROUNDS * num_replaced, tree.count_all() );
+	}
+}
+
+}
+
+int main( int argc, char** argv ) {
+	std::size_t max_items = 1000000;
+
+	if( argc > 1 ) {
+		max_items = static_cast<std::size_t>( std::strtoull( argv[1], nullptr, 10 ) );
+	}
+
+	std::printf( "workload,distribution,items,ops,ns_per_op,allocs_per_op,peak_bytes,checksum\n" );
+
+	for( std::size_t num_items = 1000; num_items <= max_items; num_items *= 10 ) {
+		for( std::size_t distribution_idx = 0; distribution_idx < sizeof( DISTRIBUTIONS ) / sizeof( DISTRIBUTIONS[0] ); ++distribution_idx ) {
+			run( DISTRIBUTIONS[distribution_idx], num_items );
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include <FWU/LinearLooseOctree.hpp>
+#include <FWU/LooseOctree.hpp>
+#include <FWU/ShardedLooseOctree.hpp>
+#include <FWU/WorkloadTrace.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/** Workload trace replay.
+ *
+ * Replays a trace recorded by util::RecordingLooseOctree against each index
+ * implementation, starting from an empty index per repetition. Results go to
+ * stdout as CSV, one row per index:
+ *
+ *   * *_ns_per_op: Mean wall time per insertion, erasure and search.
+ *   * mismatches: Searches with a different number of results than recorded.
+ *
+ * Usage: replay <trace file> [repetitions] (default 1).
+ */
+
+namespace {
+
+typedef util::WorkloadTrace<float> Trace;
+
+// Same as LinearLooseOctree's location codes allow.
+const uint32_t MAX_LINEAR_SIZE = 1u << 21;
+
+double get_ns_per_op( uint64_t ns, std::size_t num_ops ) {
+	return num_ops > 0 ? static_cast<double>( ns ) / static_cast<double>( num_ops ) : 0.0;
+}
+
+void print( const char* name, const Trace::ReplayResult& result, bool replayed ) {
+	std::printf(
+		"%s,%zu,%zu,%zu,%.2f,%.2f,%.2f,%zu,%s\n",
+		name,
+		result.num_inserts,
+		result.num_erases,
+		result.num_searches,
+		get_ns_per_op( result.insert_ns, result.num_inserts ),
+		get_ns_per_op( result.erase_ns, result.num_erases ),
+		get_ns_per_op( result.search_ns, result.num_searches ),
+		result.num_mismatches,
+		replayed ? "ok" : "failed"
+	);
+	std::fflush( stdout );
+}
+
+template <class Index, class Factory>
+void run( const char* name, const Trace& trace, std::size_t num_repetitions, Factory factory ) {
+	Trace::ReplayResult result;
+	bool replayed = true;
+
+	for( std::size_t repetition = 0; repetition < num_repetitions && replayed; ++repetition ) {
+		std::unique_ptr<Index> index( factory() );
+		replayed = trace.replay( *index, result );
+	}
+
+	print( name, result, replayed );
+}
+
+}
+
+int main( int argc, char** argv ) {
+	if( argc < 2 ) {
+		std::fprintf( stderr, "Usage: %s <trace file> [repetitions]\n", argv[0] );
+		return 1;
+	}
+
+	std::size_t num_repetitions = 1;
+
+	if( argc > 2 ) {
+		num_repetitions = std::max( static_cast<std::size_t>( std::strtoull( argv[2], nullptr, 10 ) ), static_cast<std::size_t>( 1 ) );
+	}
+
+	std::ifstream file( argv[1], std::ios::binary );
+
+	if( !file.is_open() ) {
+		std::fprintf( stderr, "Can't open %s.\n", argv[1] );
+		return 1;
+	}
+
+	std::vector<char> bytes( (std::istreambuf_iterator<char>( file )), std::istreambuf_iterator<char>() );
+	Trace trace;
+
+	if( !trace.load( bytes.data(), bytes.size() ) || trace.get_size() == 0 ) {
+		std::fprintf( stderr, "%s is not a valid workload trace.\n", argv[1] );
+		return 1;
+	}
+
+	uint32_t size = trace.get_size();
+
+	std::printf( "index,inserts,erases,searches,insert_ns_per_op,erase_ns_per_op,search_ns_per_op,mismatches,status\n" );
+
+	run<util::LooseOctree<uint32_t>>(
+		"LooseOctree",
+		trace,
+		num_repetitions,
+		[size]() {
+			return new util::LooseOctree<uint32_t>( size );
+		}
+	);
+
+	if( size <= MAX_LINEAR_SIZE ) {
+		run<util::LinearLooseOctree<uint32_t>>(
+			"LinearLooseOctree",
+			trace,
+			num_repetitions,
+			[size]() {
+				return new util::LinearLooseOctree<uint32_t>( size );
+			}
+		);
+	}
+
+	run<util::ShardedLooseOctree<uint32_t>>(
+		"ShardedLooseOctree",
+		trace,
+		num_repetitions,
+		[size]() {
+			return new util::ShardedLooseOctree<uint32_t>( size, std::max( size / 8, 1u ) );
+		}
+	);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <FWU/Cuboid.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+/** Append-only log of changes to a loose octree.
+ *
+ * Attached to a tree with LooseOctree::set_journal(), the journal receives one
+ * compact record per inserted, erased or updated data. Replaying the records on
+ * a tree restored from a snapshot (see LooseOctree::serialize() and
+ * LooseOctree::assign( const FrozenLooseOctree& )) gives the same data and
+ * handles as the journaled tree, so persisting only needs the journal's bytes
+ * as long as the snapshot doesn't change.
+ *
+ * Records are self-contained, so journals written one after another can be
+ * concatenated with append().
+ *
+ * A journal is not synchronized. To compact or checkpoint it in the
+ * background, swap() it with an empty one at the tree first, then compact()
+ * the swapped out journal or replay it on a restored snapshot and serialize
+ * that into a new snapshot on another thread.
+ *
+ *   * T: Data type (trivially copyable).
+ *   * DVS: Data vector scalar.
+ */
+template <class T, class DVS = float>
+class ChangeJournal {
+	public:
+		typedef Cuboid<DVS> DataCuboid; ///< Data cuboid.
+
+		/** Record type.
+		 */
+		enum RecordType {
+			INSERT = 0,
+			ERASE,
+			UPDATE
+		};
+
+		/** Ctor.
+		 */
+		ChangeJournal();
+
+		/** Check if journal has no records.
+		 * @return true if empty.
+		 */
+		bool is_empty() const;
+
+		/** Get records.
+		 * @return Pointer to first byte.
+		 */
+		const char* get_bytes() const;
+
+		/** Get size of records.
+		 * @return Number of bytes.
+		 */
+		std::size_t get_num_bytes() const;
+
+		/** Record insertion.
+		 * @param handle Handle of inserted data (LooseOctree::Handle).
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 */
+		template <class Handle>
+		void record_insert( const Handle& handle, const T& data, const DataCuboid& cuboid );
+
+		/** Record erasure.
+		 * @param handle Handle of erased data (LooseOctree::Handle).
+		 */
+		template <class Handle>
+		void record_erase( const Handle& handle );
+
+		/** Record update.
+		 * @param handle Handle of updated data (LooseOctree::Handle).
+		 * @param cuboid New cuboid.
+		 */
+		template <class Handle>
+		void record_update( const Handle& handle, const DataCuboid& cuboid );
+
+		/** Append records, e.g. read from a file.
+		 * @param bytes Records as returned by get_bytes().
+		 * @param num_bytes Number of bytes.
+		 */
+		void append( const void* bytes, std::size_t num_bytes );
+
+		/** Remove all records.
+		 */
+		void clear();
+
+		/** Swap records with another journal.
+		 * @param other Other journal.
+		 */
+		void swap( ChangeJournal& other );
+
+		/** Shrink the journal without changing the result of replay().
+		 * Updates are folded into the insertion or first update of the same data,
+		 * updates of data erased later are dropped. Insertions and erasures are
+		 * kept, they determine the handles.
+		 * @return false if records are truncated (journal unchanged), true otherwise.
+		 */
+		bool compact();
+
+		/** Apply records to a tree.
+		 * The tree must be in the state the journal started at. Stops at the
+		 * first record that doesn't apply, i.e. erases or updates invalid
+		 * handles, or inserts with a different handle than recorded.
+		 * @param tree Tree (LooseOctree).
+		 * @return true if all records were applied.
+		 */
+		template <class Tree>
+		bool replay( Tree& tree ) const;
+
+	private:
+		struct Record {
+			RecordType type;
+			uint32_t index;
+			uint32_t generation;
+			DataCuboid cuboid;
+			const char* data;
+		};
+
+		static std::size_t get_record_size( RecordType type );
+		bool read_record( std::size_t& offset, Record& record ) const;
+		void write_record( RecordType type, uint32_t index, uint32_t generation, const DataCuboid* cuboid, const void* data );
+
+		std::vector<char> m_bytes;
+};
+
+}
+
+#include "ChangeJournal.inl"
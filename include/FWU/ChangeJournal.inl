@@ -0,0 +1,241 @@
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+namespace util {
+
+template <class T, class DVS>
+ChangeJournal<T, DVS>::ChangeJournal() {
+}
+
+template <class T, class DVS>
+bool ChangeJournal<T, DVS>::is_empty() const {
+	return m_bytes.empty();
+}
+
+template <class T, class DVS>
+const char* ChangeJournal<T, DVS>::get_bytes() const {
+	return m_bytes.data();
+}
+
+template <class T, class DVS>
+std::size_t ChangeJournal<T, DVS>::get_num_bytes() const {
+	return m_bytes.size();
+}
+
+template <class T, class DVS>
+template <class Handle>
+void ChangeJournal<T, DVS>::record_insert( const Handle& handle, const T& data, const DataCuboid& cuboid ) {
+	write_record( INSERT, handle.index, handle.generation, &cuboid, &data );
+}
+
+template <class T, class DVS>
+template <class Handle>
+void ChangeJournal<T, DVS>::record_erase( const Handle& handle ) {
+	write_record( ERASE, handle.index, handle.generation, nullptr, nullptr );
+}
+
+template <class T, class DVS>
+template <class Handle>
+void ChangeJournal<T, DVS>::record_update( const Handle& handle, const DataCuboid& cuboid ) {
+	write_record( UPDATE, handle.index, handle.generation, &cuboid, nullptr );
+}
+
+template <class T, class DVS>
+void ChangeJournal<T, DVS>::append( const void* bytes, std::size_t num_bytes ) {
+	const char* first = static_cast<const char*>( bytes );
+	m_bytes.insert( m_bytes.end(), first, first + num_bytes );
+}
+
+template <class T, class DVS>
+void ChangeJournal<T, DVS>::clear() {
+	m_bytes.clear();
+}
+
+template <class T, class DVS>
+void ChangeJournal<T, DVS>::swap( ChangeJournal& other ) {
+	m_bytes.swap( other.m_bytes );
+}
+
+template <class T, class DVS>
+bool ChangeJournal<T, DVS>::compact() {
+	std::vector<Record> records;
+	std::size_t offset = 0;
+	Record record;
+
+	while( offset < m_bytes.size() ) {
+		if( !read_record( offset, record ) ) {
+			return false;
+		}
+
+		records.push_back( record );
+	}
+
+	// Record holding the latest cuboid per handle, while the data exists.
+	std::unordered_map<uint64_t, std::size_t> latest;
+	std::vector<bool> keep( records.size(), true );
+
+	for( std::size_t record_idx = 0; record_idx < records.size(); ++record_idx ) {
+		const Record& current = records[record_idx];
+		uint64_t key = (static_cast<uint64_t>( current.index ) << 32) | current.generation;
+		std::unordered_map<uint64_t, std::size_t>::iterator iter = latest.find( key );
+
+		if( current.type == INSERT ) {
+			latest[key] = record_idx;
+		}
+		else if( current.type == UPDATE ) {
+			if( iter != latest.end() ) {
+				records[iter->second].cuboid = current.cuboid;
+				keep[record_idx] = false;
+			}
+			else {
+				latest[key] = record_idx;
+			}
+		}
+		else if( iter != latest.end() ) {
+			if( records[iter->second].type == UPDATE ) {
+				keep[iter->second] = false;
+			}
+
+			latest.erase( iter );
+		}
+	}
+
+	// Records point into the old bytes, so write to another journal.
+	ChangeJournal<T, DVS> compacted;
+	compacted.m_bytes.reserve( m_bytes.size() );
+
+	for( std::size_t record_idx = 0; record_idx < records.size(); ++record_idx ) {
+		const Record& current = records[record_idx];
+
+		if( keep[record_idx] ) {
+			compacted.write_record( current.type, current.index, current.generation, &current.cuboid, current.data );
+		}
+	}
+
+	swap( compacted );
+	return true;
+}
+
+template <class T, class DVS>
+template <class Tree>
+bool ChangeJournal<T, DVS>::replay( Tree& tree ) const {
+	static_assert( std::is_trivially_copyable<T>::value, "Journaled data must be trivially copyable." );
+
+	std::size_t offset = 0;
+	Record record;
+
+	while( offset < m_bytes.size() ) {
+		if( !read_record( offset, record ) ) {
+			return false;
+		}
+
+		typename Tree::Handle handle;
+		handle.index = record.index;
+		handle.generation = record.generation;
+
+		if( record.type == INSERT ) {
+			// Records aren't aligned.
+			typename std::aligned_storage<sizeof( T ), std::alignment_of<T>::value>::type storage;
+			std::memcpy( &storage, record.data, sizeof( T ) );
+
+			if( tree.insert( *reinterpret_cast<const T*>( &storage ), record.cuboid ) != handle ) {
+				return false;
+			}
+		}
+		else if( !tree.is_valid( handle ) ) {
+			return false;
+		}
+		else if( record.type == ERASE ) {
+			tree.erase( handle );
+		}
+		else {
+			tree.update( handle, record.cuboid );
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS>
+std::size_t ChangeJournal<T, DVS>::get_record_size( RecordType type ) {
+	// Type, handle index and generation, cuboid, data.
+	std::size_t size = 1 + 2 * sizeof( uint32_t );
+
+	if( type != ERASE ) {
+		size += 6 * sizeof( DVS );
+	}
+
+	if( type == INSERT ) {
+		size += sizeof( T );
+	}
+
+	return size;
+}
+
+template <class T, class DVS>
+bool ChangeJournal<T, DVS>::read_record( std::size_t& offset, Record& record ) const {
+	assert( offset < m_bytes.size() );
+
+	unsigned char type = static_cast<unsigned char>( m_bytes[offset] );
+
+	if( type > UPDATE ) {
+		return false;
+	}
+
+	record.type = static_cast<RecordType>( type );
+
+	std::size_t size = get_record_size( record.type );
+
+	if( size > m_bytes.size() - offset ) {
+		return false;
+	}
+
+	const char* bytes = m_bytes.data() + offset + 1;
+
+	std::memcpy( &record.index, bytes, sizeof( uint32_t ) );
+	std::memcpy( &record.generation, bytes + sizeof( uint32_t ), sizeof( uint32_t ) );
+	bytes += 2 * sizeof( uint32_t );
+
+	if( record.type != ERASE ) {
+		DVS components[6];
+		std::memcpy( components, bytes, sizeof( components ) );
+		bytes += sizeof( components );
+
+		record.cuboid = DataCuboid( components[0], components[1], components[2], components[3], components[4], components[5] );
+	}
+
+	record.data = record.type == INSERT ? bytes : nullptr;
+	offset += size;
+
+	return true;
+}
+
+template <class T, class DVS>
+void ChangeJournal<T, DVS>::write_record( RecordType type, uint32_t index, uint32_t generation, const DataCuboid* cuboid, const void* data ) {
+	std::size_t offset = m_bytes.size();
+	m_bytes.resize( offset + get_record_size( type ) );
+
+	char* bytes = m_bytes.data() + offset;
+
+	*bytes = static_cast<char>( type );
+	std::memcpy( bytes + 1, &index, sizeof( uint32_t ) );
+	std::memcpy( bytes + 1 + sizeof( uint32_t ), &generation, sizeof( uint32_t ) );
+	bytes += 1 + 2 * sizeof( uint32_t );
+
+	if( type != ERASE ) {
+		assert( cuboid );
+
+		DVS components[6] = { cuboid->x, cuboid->y, cuboid->z, cuboid->width, cuboid->height, cuboid->depth };
+		std::memcpy( bytes, components, sizeof( components ) );
+		bytes += sizeof( components );
+	}
+
+	if( type == INSERT ) {
+		assert( data );
+		std::memcpy( bytes, data, sizeof( T ) );
+	}
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <FWU/EpochManager.hpp>
+#include <FWU/LooseOctree.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace util {
+
+/** Loose octree with lock-free readers.
+ *
+ * The writer modifies its own tree (get_tree()) and makes the changes visible
+ * to readers by publish(), which copies the tree into a snapshot and swaps it
+ * in atomically. Readers pin an epoch with read() and search the snapshot
+ * current at that time, without locks and without ever blocking the writer.
+ * Snapshots replaced by publish() are kept until no reader can see them
+ * anymore, then recycled for the next publish() (see EpochManager).
+ *
+ * Snapshots don't share nodes, so publish() copies the whole tree: it costs
+ * O(number of nodes + data) on the writer's thread, no matter how little
+ * changed (see the publish rows of the bench target). Publish as rarely as
+ * readers can tolerate, e.g. every few ticks for big trees, rather than after
+ * every change.
+ *
+ * Readers may run on any number of threads. get_tree() and publish() must only
+ * be used by one thread at a time.
+ *
+ *   * T: Data type.
+ *   * DVS: Data vector scalar.
+ *   * Allocator: Allocator used for the trees.
+ */
+template <class T, class DVS = float, class Allocator = std::allocator<T>>
+class ConcurrentLooseOctree {
+	public:
+		typedef LooseOctree<T, DVS, Allocator> Tree; ///< Tree type.
+		typedef typename Tree::Size Size; ///< Size type.
+
+		/** Pinned snapshot.
+		 * Unpins on destruction. Must not outlive the ConcurrentLooseOctree.
+		 */
+		class ReadGuard {
+			public:
+				/** Move ctor.
+				 * @param other Guard, unpinned afterwards.
+				 */
+				ReadGuard( ReadGuard&& other );
+
+				/** Dtor.
+				 */
+				~ReadGuard();
+
+				/** Get snapshot.
+				 * @return Snapshot.
+				 */
+				const Tree& get_tree() const;
+
+				/** Access snapshot.
+				 * @return Snapshot.
+				 */
+				const Tree* operator->() const;
+
+			private:
+				friend class ConcurrentLooseOctree;
+
+				ReadGuard( EpochManager& epochs, std::size_t slot, const Tree* tree );
+				ReadGuard( const ReadGuard& ) = delete;
+				ReadGuard& operator=( const ReadGuard& ) = delete;
+
+				EpochManager* m_epochs;
+				std::size_t m_slot;
+				const Tree* m_tree;
+		};
+
+		/** Ctor.
+		 * The initial snapshot is empty.
+		 * @param size Size (must be power of two).
+		 * @param num_reader_slots Maximum number of concurrent readers (see EpochManager).
+		 * @param allocator Allocator.
+		 */
+		ConcurrentLooseOctree( Size size, std::size_t num_reader_slots = 64, const Allocator& allocator = Allocator() );
+
+		/** Dtor.
+		 * No reader may be active.
+		 */
+		~ConcurrentLooseOctree();
+
+		/** Get the writer's tree.
+		 * Changes aren't visible to readers before publish().
+		 * @return Tree.
+		 */
+		Tree& get_tree();
+
+		/** Publish the writer's tree.
+		 * Copies the tree into a new snapshot and makes it current for readers
+		 * from now on. Snapshots no reader can see anymore are reclaimed first.
+		 * Takes time linear in the tree's number of nodes and data, as the whole
+		 * tree is copied. Recycled snapshots reuse their nodes and data blocks,
+		 * so steady publishing allocates little.
+		 */
+		void publish();
+
+		/** Pin the current snapshot for reading.
+		 * Lock-free, may be called from any thread.
+		 * @return Guard.
+		 */
+		ReadGuard read() const;
+
+		/** Get number of replaced snapshots that are waiting for readers.
+		 * @return Number of snapshots.
+		 */
+		std::size_t get_num_retired() const;
+
+	private:
+		struct Retired {
+			uint64_t epoch;
+			Tree* tree;
+		};
+
+		ConcurrentLooseOctree( const ConcurrentLooseOctree& ) = delete;
+		ConcurrentLooseOctree& operator=( const ConcurrentLooseOctree& ) = delete;
+
+		void reclaim();
+
+		Tree m_tree;
+		Allocator m_allocator;
+		mutable EpochManager m_epochs;
+		std::atomic<Tree*> m_snapshot;
+		std::vector<Retired> m_retired;
+		std::unique_ptr<Tree> m_spare;
+};
+
+}
+
+#include "ConcurrentLooseOctree.inl"
@@ -0,0 +1,129 @@
+#include <cassert>
+#include <limits>
+
+namespace util {
+
+///// ReadGuard //////
+
+template <class T, class DVS, class A>
+ConcurrentLooseOctree<T, DVS, A>::ReadGuard::ReadGuard( EpochManager& epochs, std::size_t slot, const Tree* tree ) :
+	m_epochs( &epochs ),
+	m_slot( slot ),
+	m_tree( tree )
+{
+}
+
+template <class T, class DVS, class A>
+ConcurrentLooseOctree<T, DVS, A>::ReadGuard::ReadGuard( ReadGuard&& other ) :
+	m_epochs( other.m_epochs ),
+	m_slot( other.m_slot ),
+	m_tree( other.m_tree )
+{
+	other.m_epochs = nullptr;
+	other.m_tree = nullptr;
+}
+
+template <class T, class DVS, class A>
+ConcurrentLooseOctree<T, DVS, A>::ReadGuard::~ReadGuard() {
+	if( m_epochs ) {
+		m_epochs->unpin( m_slot );
+	}
+}
+
+template <class T, class DVS, class A>
+const typename ConcurrentLooseOctree<T, DVS, A>::Tree& ConcurrentLooseOctree<T, DVS, A>::ReadGuard::get_tree() const {
+	assert( m_tree );
+	return *m_tree;
+}
+
+template <class T, class DVS, class A>
+const typename ConcurrentLooseOctree<T, DVS, A>::Tree* ConcurrentLooseOctree<T, DVS, A>::ReadGuard::operator->() const {
+	assert( m_tree );
+	return m_tree;
+}
+
+///// ConcurrentLooseOctree //////
+
+template <class T, class DVS, class A>
+ConcurrentLooseOctree<T, DVS, A>::ConcurrentLooseOctree( Size size, std::size_t num_reader_slots, const A& allocator ) :
+	m_tree( size, allocator ),
+	m_allocator( allocator ),
+	m_epochs( num_reader_slots ),
+	m_snapshot( new Tree( size, allocator ) )
+{
+}
+
+template <class T, class DVS, class A>
+ConcurrentLooseOctree<T, DVS, A>::~ConcurrentLooseOctree() {
+	assert( m_epochs.get_min_pinned_epoch() == std::numeric_limits<uint64_t>::max() );
+
+	for( std::size_t retired_idx = 0; retired_idx < m_retired.size(); ++retired_idx ) {
+		delete m_retired[retired_idx].tree;
+	}
+
+	delete m_snapshot.load();
+}
+
+template <class T, class DVS, class A>
+typename ConcurrentLooseOctree<T, DVS, A>::Tree& ConcurrentLooseOctree<T, DVS, A>::get_tree() {
+	return m_tree;
+}
+
+template <class T, class DVS, class A>
+void ConcurrentLooseOctree<T, DVS, A>::publish() {
+	reclaim();
+
+	// Recycled snapshots have their nodes and data blocks pooled already.
+	std::unique_ptr<Tree> snapshot( std::move( m_spare ) );
+
+	if( !snapshot ) {
+		snapshot.reset( new Tree( m_tree.get_size(), m_allocator ) );
+	}
+
+	snapshot->assign( m_tree );
+
+	// New readers see the new snapshot. Readers that have already loaded the
+	// old one pinned an epoch up to the one returned by advance().
+	Retired retired;
+	retired.tree = m_snapshot.exchange( snapshot.release() );
+	retired.epoch = m_epochs.advance();
+
+	m_retired.push_back( retired );
+}
+
+template <class T, class DVS, class A>
+typename ConcurrentLooseOctree<T, DVS, A>::ReadGuard ConcurrentLooseOctree<T, DVS, A>::read() const {
+	// Pin before loading the snapshot, so publish() can't miss the reader.
+	std::size_t slot = m_epochs.pin();
+	return ReadGuard( m_epochs, slot, m_snapshot.load() );
+}
+
+template <class T, class DVS, class A>
+std::size_t ConcurrentLooseOctree<T, DVS, A>::get_num_retired() const {
+	return m_retired.size();
+}
+
+template <class T, class DVS, class A>
+void ConcurrentLooseOctree<T, DVS, A>::reclaim() {
+	uint64_t min_epoch = m_epochs.get_min_pinned_epoch();
+	std::size_t num_kept = 0;
+
+	for( std::size_t retired_idx = 0; retired_idx < m_retired.size(); ++retired_idx ) {
+		const Retired& retired = m_retired[retired_idx];
+
+		if( retired.epoch >= min_epoch ) {
+			m_retired[num_kept++] = retired;
+		}
+		// Keep one snapshot for the next publish().
+		else if( !m_spare ) {
+			m_spare.reset( retired.tree );
+		}
+		else {
+			delete retired.tree;
+		}
+	}
+
+	m_retired.resize( num_kept );
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SFML/System/Vector3.hpp>
+
+namespace util {
+
+/** Calculate squared distance between a point and an axis aligned box.
+ * @param point Point.
+ * @param box_min Minimum corner of box.
+ * @param box_max Maximum corner of box.
+ * @return Squared distance, 0 if the point is inside the box.
+ */
+template <class T>
+T calc_squared_distance_point_box( const sf::Vector3<T>& point, const sf::Vector3<T>& box_min, const sf::Vector3<T>& box_max );
+
+/** Calculate squared distance between a point and a line segment.
+ * @param point Point.
+ * @param start Start of segment.
+ * @param end End of segment (may equal start).
+ * @return Squared distance.
+ */
+template <class T>
+T calc_squared_distance_point_segment( const sf::Vector3<T>& point, const sf::Vector3<T>& start, const sf::Vector3<T>& end );
+
+/** Calculate squared distance between a line segment and an axis aligned box.
+ * Along the segment, the squared distance is a sum of per-axis terms that are
+ * quadratic in the segment parameter between the points where the segment
+ * crosses the box's slabs. The result is the exact minimum of these pieces,
+ * not an approximation.
+ * @param start Start of segment.
+ * @param end End of segment (may equal start).
+ * @param box_min Minimum corner of box.
+ * @param box_max Maximum corner of box.
+ * @return Squared distance, 0 if the segment touches the box.
+ */
+template <class T>
+T calc_squared_distance_segment_box(
+	const sf::Vector3<T>& start,
+	const sf::Vector3<T>& end,
+	const sf::Vector3<T>& box_min,
+	const sf::Vector3<T>& box_max
+);
+
+}
+
+#include "Distance.inl"
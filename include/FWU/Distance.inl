@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <limits>
+
+namespace util {
+
+template <class T>
+inline T calc_squared_distance_axis( T value, T min, T max ) {
+	if( value < min ) {
+		return (min - value) * (min - value);
+	}
+	else if( value > max ) {
+		return (value - max) * (value - max);
+	}
+
+	return T( 0 );
+}
+
+template <class T>
+T calc_squared_distance_point_box( const sf::Vector3<T>& point, const sf::Vector3<T>& box_min, const sf::Vector3<T>& box_max ) {
+	return (
+		calc_squared_distance_axis( point.x, box_min.x, box_max.x ) +
+		calc_squared_distance_axis( point.y, box_min.y, box_max.y ) +
+		calc_squared_distance_axis( point.z, box_min.z, box_max.z )
+	);
+}
+
+template <class T>
+T calc_squared_distance_point_segment( const sf::Vector3<T>& point, const sf::Vector3<T>& start, const sf::Vector3<T>& end ) {
+	sf::Vector3<T> direction = end - start;
+	sf::Vector3<T> offset = point - start;
+	T length_squared = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+	T t = T( 0 );
+
+	if( length_squared > T( 0 ) ) {
+		t = (offset.x * direction.x + offset.y * direction.y + offset.z * direction.z) / length_squared;
+		t = std::max( T( 0 ), std::min( T( 1 ), t ) );
+	}
+
+	offset -= direction * t;
+
+	return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+}
+
+template <class T>
+T calc_squared_distance_segment_box(
+	const sf::Vector3<T>& start,
+	const sf::Vector3<T>& end,
+	const sf::Vector3<T>& box_min,
+	const sf::Vector3<T>& box_max
+) {
+	const T origins[] = { start.x, start.y, start.z };
+	const T directions[] = { end.x - start.x, end.y - start.y, end.z - start.z };
+	const T mins[] = { box_min.x, box_min.y, box_min.z };
+	const T maxs[] = { box_max.x, box_max.y, box_max.z };
+
+	// Parameters where the segment enters or leaves a slab, plus both ends.
+	T breaks[8];
+	std::size_t num_breaks = 0;
+
+	breaks[num_breaks++] = T( 0 );
+
+	for( std::size_t axis = 0; axis < 3; ++axis ) {
+		if( directions[axis] == T( 0 ) ) {
+			continue;
+		}
+
+		T t_min = (mins[axis] - origins[axis]) / directions[axis];
+		T t_max = (maxs[axis] - origins[axis]) / directions[axis];
+
+		if( t_min > T( 0 ) && t_min < T( 1 ) ) {
+			breaks[num_breaks++] = t_min;
+		}
+
+		if( t_max > T( 0 ) && t_max < T( 1 ) ) {
+			breaks[num_breaks++] = t_max;
+		}
+	}
+
+	breaks[num_breaks++] = T( 1 );
+
+	// Insertion sort, at most 8 breaks.
+	for( std::size_t break_idx = 1; break_idx < num_breaks; ++break_idx ) {
+		T value = breaks[break_idx];
+		std::size_t insert_idx = break_idx;
+
+		for( ; insert_idx > 0 && breaks[insert_idx - 1] > value; --insert_idx ) {
+			breaks[insert_idx] = breaks[insert_idx - 1];
+		}
+
+		breaks[insert_idx] = value;
+	}
+
+	T min_distance = std::numeric_limits<T>::max();
+
+	for( std::size_t break_idx = 0; break_idx + 1 < num_breaks; ++break_idx ) {
+		T first = breaks[break_idx];
+		T last = breaks[break_idx + 1];
+		T middle = (first + last) / T( 2 );
+
+		// Within the piece, every axis is either below, inside or above its slab.
+		// The distance is sum( (origin + t * direction - bound)^2 ) over the axes
+		// outside, minimal at t = -sum( direction * (origin - bound) ) / sum(
+		// direction^2 ).
+		T quadratic = T( 0 );
+		T linear = T( 0 );
+
+		for( std::size_t axis = 0; axis < 3; ++axis ) {
+			T value = origins[axis] + middle * directions[axis];
+			T bound = T( 0 );
+
+			if( value < mins[axis] ) {
+				bound = mins[axis];
+			}
+			else if( value > maxs[axis] ) {
+				bound = maxs[axis];
+			}
+			else {
+				continue;
+			}
+
+			quadratic += directions[axis] * directions[axis];
+			linear += directions[axis] * (origins[axis] - bound);
+		}
+
+		T t = first;
+
+		if( quadratic > T( 0 ) ) {
+			t = std::max( first, std::min( last, -linear / quadratic ) );
+		}
+
+		min_distance = std::min( min_distance, calc_squared_distance_point_box( start + (end - start) * t, box_min, box_max ) );
+	}
+
+	return min_distance;
+}
+
+}
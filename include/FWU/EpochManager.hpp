@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace util {
+
+/** Epoch based reclamation.
+ *
+ * Readers pin the current epoch while they access shared objects. A writer
+ * that has made an object unreachable tags it with the epoch returned by
+ * advance() and may free it as soon as get_min_pinned_epoch() is greater than
+ * that tag: every reader that could still see the object has pinned an epoch
+ * up to the tag.
+ *
+ * Pinning and unpinning are lock-free. Pinned readers occupy one of a fixed
+ * number of slots. If all slots are taken, pin() yields until one is released.
+ */
+class EpochManager {
+	public:
+		/** Ctor.
+		 * @param num_slots Maximum number of concurrently pinned readers (at least 1).
+		 */
+		EpochManager( std::size_t num_slots = 64 );
+
+		/** Get number of reader slots.
+		 * @return Number of slots.
+		 */
+		std::size_t get_num_slots() const;
+
+		/** Get current epoch.
+		 * Epochs start at 1.
+		 * @return Epoch.
+		 */
+		uint64_t get_epoch() const;
+
+		/** Pin the current epoch.
+		 * @return Slot, pass to unpin().
+		 */
+		std::size_t pin();
+
+		/** Unpin an epoch.
+		 * @param slot Slot returned by pin().
+		 */
+		void unpin( std::size_t slot );
+
+		/** Advance the epoch.
+		 * Call after making objects unreachable for new readers.
+		 * @return Previous epoch, to tag the objects with.
+		 */
+		uint64_t advance();
+
+		/** Get minimum epoch pinned by any reader.
+		 * @return Minimum pinned epoch, maximum value of uint64_t if nothing is pinned.
+		 */
+		uint64_t get_min_pinned_epoch() const;
+
+	private:
+		/** Reader slot, padded to keep slots on separate cache lines.
+		 */
+		struct Slot {
+			std::atomic<uint64_t> epoch; ///< Pinned epoch, 0 if free.
+			char padding[64 - sizeof( std::atomic<uint64_t> )];
+		};
+
+		EpochManager( const EpochManager& ) = delete;
+		EpochManager& operator=( const EpochManager& ) = delete;
+
+		std::unique_ptr<Slot[]> m_slots;
+		std::size_t m_num_slots;
+		std::atomic<uint64_t> m_epoch;
+};
+
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <FWU/Cuboid.hpp>
+
+#include <SFML/System/Vector3.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+/** Header of a serialized loose octree.
+ * All offsets are in bytes from the start of the buffer. Every section starts
+ * at a multiple of FROZEN_OCTREE_ALIGNMENT.
+ */
+struct FrozenOctreeHeader {
+	char magic[4]; ///< FROZEN_OCTREE_MAGIC.
+	uint32_t version; ///< FROZEN_OCTREE_VERSION.
+	uint32_t byte_order; ///< FROZEN_OCTREE_BYTE_ORDER in the writer's byte order.
+	uint32_t data_size; ///< sizeof( T ).
+	uint32_t scalar_size; ///< sizeof( DVS ).
+	uint32_t scalar_is_float; ///< 1 if DVS is a floating point type.
+	uint32_t size; ///< Tree size.
+	uint32_t num_nodes; ///< Number of nodes.
+	uint32_t num_data; ///< Number of data.
+	uint32_t num_slots; ///< Number of handle slots.
+	uint32_t free_slot; ///< First free handle slot, FROZEN_OCTREE_INVALID_INDEX if none.
+	uint32_t reserved; ///< Zero.
+	uint64_t nodes_offset; ///< Offset of FrozenOctreeNode array.
+	uint64_t components_offset; ///< Offset of cuboid components (six DVS arrays).
+	uint64_t payload_offset; ///< Offset of T array.
+	uint64_t data_slots_offset; ///< Offset of slot index per data.
+	uint64_t slots_offset; ///< Offset of FrozenOctreeSlot array.
+	uint64_t total_size; ///< Size of the whole buffer.
+};
+
+/** Node of a serialized loose octree.
+ * Nodes are stored depth-first, children in quadrant order. Data is stored in
+ * node order, so the data of a node's whole subtree is one contiguous range
+ * starting at first_data.
+ */
+struct FrozenOctreeNode {
+	uint32_t position[3]; ///< Position.
+	uint32_t size; ///< Size.
+	uint32_t first_data; ///< Index of first data.
+	uint32_t num_data; ///< Number of data of this node.
+	uint32_t num_subtree_data; ///< Number of data of this node and all descendants.
+	uint32_t children[8]; ///< Distance from this node's index to child's index per quadrant, 0 if no child.
+};
+
+/** Handle slot of a serialized loose octree.
+ */
+struct FrozenOctreeSlot {
+	uint32_t data_idx; ///< Data index, FROZEN_OCTREE_INVALID_INDEX if free.
+	uint32_t generation; ///< Slot generation.
+	uint32_t next_free; ///< Next free slot if free, FROZEN_OCTREE_INVALID_INDEX if last or used.
+};
+
+static const char FROZEN_OCTREE_MAGIC[4] = { 'F', 'W', 'L', 'O' }; ///< Magic of serialized loose octrees.
+static const uint32_t FROZEN_OCTREE_VERSION = 2; ///< Current format version.
+static const uint32_t FROZEN_OCTREE_BYTE_ORDER = 0x01020304; ///< Byte order marker.
+static const uint32_t FROZEN_OCTREE_INVALID_INDEX = 0xffffffff; ///< Invalid data or slot index.
+static const std::size_t FROZEN_OCTREE_ALIGNMENT = 16; ///< Minimum section alignment.
+
+/** Read-only loose octree on top of a serialized buffer.
+ *
+ * The buffer is produced by LooseOctree::serialize() and may be loaded from a
+ * file or memory-mapped. Loading only checks the header (magic, version, byte
+ * order, type sizes and section bounds); nodes and data are used in place
+ * without parsing or copying, so the buffer must outlive the view. The buffer
+ * must be aligned to FROZEN_OCTREE_ALIGNMENT (and alignof( T ) if bigger),
+ * which memory mappings and heap allocations are.
+ *
+ * Search results are the same as of the serialized tree. Handles of the
+ * serialized tree stay valid. LooseOctree::assign( const FrozenLooseOctree& )
+ * restores a modifiable tree with the same handles.
+ *
+ * Node and data sections are trusted, only load buffers written by
+ * LooseOctree::serialize().
+ *
+ *   * T: Data type (trivially copyable).
+ *   * DVS: Data vector scalar.
+ */
+template <class T, class DVS = float>
+class FrozenLooseOctree {
+	public:
+		typedef uint32_t Size; ///< Size type.
+		typedef sf::Vector3<Size> Vector; ///< Tree location vector.
+		typedef Cuboid<DVS> DataCuboid; ///< Data cuboid.
+		typedef std::vector<T> DataArray; ///< Data array.
+
+		/** Ctor.
+		 * Creates an empty view, see load().
+		 */
+		FrozenLooseOctree();
+
+		/** Load serialized tree.
+		 * On failure the view is empty.
+		 * @param buffer Buffer (not copied, must outlive the view).
+		 * @param buffer_size Size of buffer in bytes (may exceed the serialized size).
+		 * @return true on success, false if the header doesn't match T and DVS or the buffer is too small or misaligned.
+		 */
+		bool load( const void* buffer, std::size_t buffer_size );
+
+		/** Check if a tree is loaded.
+		 * @return true if loaded.
+		 */
+		bool is_loaded() const;
+
+		/** Get size.
+		 * @return Size (0 if not loaded).
+		 */
+		Size get_size() const;
+
+		/** Get number of nodes.
+		 * @return Number of nodes (0 if not loaded).
+		 */
+		std::size_t get_num_nodes() const;
+
+		/** Count all data.
+		 * @return Number of data.
+		 */
+		std::size_t count_all() const;
+
+		/** Check if a handle of the serialized tree refers to data.
+		 * @param handle Handle (LooseOctree::Handle).
+		 * @return true if valid.
+		 */
+		template <class Handle>
+		bool is_valid( const Handle& handle ) const;
+
+		/** Get data by handle of the serialized tree.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle (LooseOctree::Handle).
+		 * @return Data.
+		 * @see is_valid
+		 */
+		template <class Handle>
+		const T& get( const Handle& handle ) const;
+
+		/** Get cuboid of data by handle of the serialized tree.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle (LooseOctree::Handle).
+		 * @return Cuboid.
+		 * @see is_valid
+		 */
+		template <class Handle>
+		DataCuboid get_cuboid( const Handle& handle ) const;
+
+		/** Search for data in a specific cuboid.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param results Array for results (not cleared).
+		 */
+		void search( const DataCuboid& cuboid, DataArray& results ) const;
+
+		/** Search for data in a specific cuboid without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 */
+		template <class Visitor>
+		bool search( const DataCuboid& cuboid, Visitor&& visitor ) const;
+
+	private:
+		template <class, class, class>
+		friend class LooseOctree;
+
+		enum Component {
+			X = 0,
+			Y,
+			Z,
+			WIDTH,
+			HEIGHT,
+			DEPTH,
+			NUM_COMPONENTS
+		};
+
+		struct DataAppender {
+			bool operator()( const T& data, const DataCuboid& cuboid ) const;
+
+			DataArray& results;
+		};
+
+		template <class Visitor>
+		bool search_node( const FrozenOctreeNode& node, const DataCuboid& cuboid, Visitor& visitor ) const;
+
+		template <class Visitor>
+		bool visit_range( std::size_t first, std::size_t num, Visitor& visitor ) const;
+
+		const DVS* get_component( Component component ) const;
+		DataCuboid get_data_cuboid( std::size_t data_idx ) const;
+
+		const FrozenOctreeHeader* m_header;
+		const FrozenOctreeNode* m_nodes;
+		const DVS* m_components;
+		const T* m_payload;
+		const uint32_t* m_data_slots;
+		const FrozenOctreeSlot* m_slots;
+};
+
+}
+
+#include "FrozenLooseOctree.inl"
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace util {
+
+inline bool is_frozen_section_valid( uint64_t offset, uint64_t num, uint64_t element_size, uint64_t alignment, uint64_t total_size ) {
+	return (
+		offset % alignment == 0 &&
+		offset <= total_size &&
+		num <= (total_size - offset) / element_size
+	);
+}
+
+inline uint64_t append_frozen_section( uint64_t& offset, uint64_t size, uint64_t alignment ) {
+	uint64_t section_offset = (offset + alignment - 1) / alignment * alignment;
+
+	offset = section_offset + size;
+	return section_offset;
+}
+
+template <class T, class DVS>
+FrozenLooseOctree<T, DVS>::FrozenLooseOctree() :
+	m_header( nullptr ),
+	m_nodes( nullptr ),
+	m_components( nullptr ),
+	m_payload( nullptr ),
+	m_data_slots( nullptr ),
+	m_slots( nullptr )
+{
+	static_assert( std::is_trivially_copyable<T>::value, "Frozen data must be trivially copyable." );
+}
+
+template <class T, class DVS>
+bool FrozenLooseOctree<T, DVS>::load( const void* buffer, std::size_t buffer_size ) {
+	*this = FrozenLooseOctree();
+
+	const uint64_t alignment = std::max( FROZEN_OCTREE_ALIGNMENT, std::alignment_of<T>::value );
+
+	if(
+		!buffer ||
+		buffer_size < sizeof( FrozenOctreeHeader ) ||
+		reinterpret_cast<uintptr_t>( buffer ) % alignment != 0
+	) {
+		return false;
+	}
+
+	const FrozenOctreeHeader* header = static_cast<const FrozenOctreeHeader*>( buffer );
+
+	if(
+		std::memcmp( header->magic, FROZEN_OCTREE_MAGIC, sizeof( FROZEN_OCTREE_MAGIC ) ) != 0 ||
+		header->version != FROZEN_OCTREE_VERSION ||
+		header->byte_order != FROZEN_OCTREE_BYTE_ORDER ||
+		header->data_size != sizeof( T ) ||
+		header->scalar_size != sizeof( DVS ) ||
+		header->scalar_is_float != (std::is_floating_point<DVS>::value ? 1u : 0u) ||
+		header->num_nodes == 0 ||
+		(header->free_slot != FROZEN_OCTREE_INVALID_INDEX && header->free_slot >= header->num_slots) ||
+		header->total_size > buffer_size ||
+		!is_frozen_section_valid( header->nodes_offset, header->num_nodes, sizeof( FrozenOctreeNode ), alignment, header->total_size ) ||
+		!is_frozen_section_valid( header->components_offset, uint64_t( header->num_data ) * NUM_COMPONENTS, sizeof( DVS ), alignment, header->total_size ) ||
+		!is_frozen_section_valid( header->payload_offset, header->num_data, sizeof( T ), alignment, header->total_size ) ||
+		!is_frozen_section_valid( header->data_slots_offset, header->num_data, sizeof( uint32_t ), alignment, header->total_size ) ||
+		!is_frozen_section_valid( header->slots_offset, header->num_slots, sizeof( FrozenOctreeSlot ), alignment, header->total_size )
+	) {
+		return false;
+	}
+
+	const char* bytes = static_cast<const char*>( buffer );
+
+	m_header = header;
+	m_nodes = reinterpret_cast<const FrozenOctreeNode*>( bytes + header->nodes_offset );
+	m_components = reinterpret_cast<const DVS*>( bytes + header->components_offset );
+	m_payload = reinterpret_cast<const T*>( bytes + header->payload_offset );
+	m_data_slots = reinterpret_cast<const uint32_t*>( bytes + header->data_slots_offset );
+	m_slots = reinterpret_cast<const FrozenOctreeSlot*>( bytes + header->slots_offset );
+
+	return true;
+}
+
+template <class T, class DVS>
+bool FrozenLooseOctree<T, DVS>::is_loaded() const {
+	return m_header != nullptr;
+}
+
+template <class T, class DVS>
+typename FrozenLooseOctree<T, DVS>::Size FrozenLooseOctree<T, DVS>::get_size() const {
+	return m_header ? m_header->size : 0;
+}
+
+template <class T, class DVS>
+std::size_t FrozenLooseOctree<T, DVS>::get_num_nodes() const {
+	return m_header ? m_header->num_nodes : 0;
+}
+
+template <class T, class DVS>
+std::size_t FrozenLooseOctree<T, DVS>::count_all() const {
+	return m_header ? m_header->num_data : 0;
+}
+
+template <class T, class DVS>
+template <class Handle>
+bool FrozenLooseOctree<T, DVS>::is_valid( const Handle& handle ) const {
+	return (
+		m_header &&
+		handle.index < m_header->num_slots &&
+		m_slots[handle.index].generation == handle.generation &&
+		m_slots[handle.index].data_idx != FROZEN_OCTREE_INVALID_INDEX
+	);
+}
+
+template <class T, class DVS>
+template <class Handle>
+const T& FrozenLooseOctree<T, DVS>::get( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+	return m_payload[m_slots[handle.index].data_idx];
+}
+
+template <class T, class DVS>
+template <class Handle>
+typename FrozenLooseOctree<T, DVS>::DataCuboid FrozenLooseOctree<T, DVS>::get_cuboid( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+	return get_data_cuboid( m_slots[handle.index].data_idx );
+}
+
+template <class T, class DVS>
+void FrozenLooseOctree<T, DVS>::search( const DataCuboid& cuboid, DataArray& results ) const {
+	search( cuboid, DataAppender{ results } );
+}
+
+template <class T, class DVS>
+template <class Visitor>
+bool FrozenLooseOctree<T, DVS>::search( const DataCuboid& cuboid, Visitor&& visitor ) const {
+	if( !m_header ) {
+		return true;
+	}
+
+	return search_node( m_nodes[0], cuboid, visitor );
+}
+
+template <class T, class DVS>
+template <class Visitor>
+bool FrozenLooseOctree<T, DVS>::search_node( const FrozenOctreeNode& node, const DataCuboid& cuboid, Visitor& visitor ) const {
+	DVS size = static_cast<DVS>( node.size );
+	DVS loose_min[3];
+	DVS loose_max[3];
+
+	for( std::size_t axis = 0; axis < 3; ++axis ) {
+		loose_min[axis] = static_cast<DVS>( node.position[axis] ) - size / DVS( 2 );
+		loose_max[axis] = loose_min[axis] + size * DVS( 2 );
+	}
+
+	// Data outside the loose bounds can't be hit.
+	if(
+		std::max( loose_min[0], cuboid.x ) >= std::min( loose_max[0], cuboid.x + cuboid.width ) ||
+		std::max( loose_min[1], cuboid.y ) >= std::min( loose_max[1], cuboid.y + cuboid.height ) ||
+		std::max( loose_min[2], cuboid.z ) >= std::min( loose_max[2], cuboid.z + cuboid.depth )
+	) {
+		return true;
+	}
+
+	// The subtree's data is contiguous, if the cuboid covers the loose bounds
+	// it's all hits.
+	if(
+		cuboid.x <= loose_min[0] &&
+		cuboid.y <= loose_min[1] &&
+		cuboid.z <= loose_min[2] &&
+		cuboid.x + cuboid.width >= loose_max[0] &&
+		cuboid.y + cuboid.height >= loose_max[1] &&
+		cuboid.z + cuboid.depth >= loose_max[2]
+	) {
+		return visit_range( node.first_data, node.num_subtree_data, visitor );
+	}
+
+	const DVS* xs = get_component( X );
+	const DVS* ys = get_component( Y );
+	const DVS* zs = get_component( Z );
+	const DVS* widths = get_component( WIDTH );
+	const DVS* heights = get_component( HEIGHT );
+	const DVS* depths = get_component( DEPTH );
+	std::size_t data_end = node.first_data + node.num_data;
+
+	// Same boundary semantics as Cuboid::calc_intersection().
+	for( std::size_t data_idx = node.first_data; data_idx < data_end; ++data_idx ) {
+		if(
+			std::max( xs[data_idx], cuboid.x ) < std::min( xs[data_idx] + widths[data_idx], cuboid.x + cuboid.width ) &&
+			std::max( ys[data_idx], cuboid.y ) < std::min( ys[data_idx] + heights[data_idx], cuboid.y + cuboid.height ) &&
+			std::max( zs[data_idx], cuboid.z ) < std::min( zs[data_idx] + depths[data_idx], cuboid.z + cuboid.depth ) &&
+			!visitor( m_payload[data_idx], get_data_cuboid( data_idx ) )
+		) {
+			return false;
+		}
+	}
+
+	for( std::size_t child_idx = 0; child_idx < 8; ++child_idx ) {
+		if( node.children[child_idx] != 0 && !search_node( (&node)[node.children[child_idx]], cuboid, visitor ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS>
+template <class Visitor>
+bool FrozenLooseOctree<T, DVS>::visit_range( std::size_t first, std::size_t num, Visitor& visitor ) const {
+	for( std::size_t data_idx = first; data_idx < first + num; ++data_idx ) {
+		if( !visitor( m_payload[data_idx], get_data_cuboid( data_idx ) ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS>
+const DVS* FrozenLooseOctree<T, DVS>::get_component( Component component ) const {
+	return m_components + static_cast<std::size_t>( component ) * m_header->num_data;
+}
+
+template <class T, class DVS>
+typename FrozenLooseOctree<T, DVS>::DataCuboid FrozenLooseOctree<T, DVS>::get_data_cuboid( std::size_t data_idx ) const {
+	return DataCuboid(
+		get_component( X )[data_idx],
+		get_component( Y )[data_idx],
+		get_component( Z )[data_idx],
+		get_component( WIDTH )[data_idx],
+		get_component( HEIGHT )[data_idx],
+		get_component( DEPTH )[data_idx]
+	);
+}
+
+template <class T, class DVS>
+bool FrozenLooseOctree<T, DVS>::DataAppender::operator()( const T& data, const DataCuboid& /*cuboid*/ ) const {
+	results.push_back( data );
+	return true;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <FWU/Matrix.hpp>
+
+#include <SFML/System/Vector3.hpp>
+#include <cstdint>
+
+namespace util {
+
+/** Plane.
+ * Points p with dot( normal, p ) + distance >= 0 are in front of the plane.
+ */
+template <class T>
+struct Plane {
+	sf::Vector3<T> normal; ///< Normal.
+	T distance; ///< Signed distance of the origin.
+};
+
+/** View frustum, given by six inward facing planes.
+ */
+template <class T>
+struct Frustum {
+	/** Plane index.
+	 */
+	enum PlaneIndex {
+		LEFT_PLANE = 0,
+		RIGHT_PLANE,
+		BOTTOM_PLANE,
+		TOP_PLANE,
+		NEAR_PLANE,
+		FAR_PLANE,
+		NUM_PLANES
+	};
+
+	/** Result of classify().
+	 */
+	enum Classification {
+		OUTSIDE = 0,
+		INTERSECTING,
+		INSIDE
+	};
+
+	static const uint32_t ALL_PLANES = (1 << NUM_PLANES) - 1; ///< Mask of all planes.
+
+	/** Ctor.
+	 * Extracts the planes from a view-projection matrix, so that the frustum
+	 * contains all points inside the clip volume (OpenGL conventions, z from -w
+	 * to w). Plane normals are normalized.
+	 * @param view_projection View-projection matrix.
+	 */
+	Frustum( const Matrix<T>& view_projection );
+
+	/** Classify an axis aligned box.
+	 * Only planes set in the mask are tested. Planes the box is completely in
+	 * front of are removed from the mask, so tests of contained boxes can skip
+	 * them. Boxes near frustum corners may be reported as intersecting although
+	 * they're outside.
+	 * @param min Minimum corner.
+	 * @param max Maximum corner.
+	 * @param plane_mask Planes to test (bit per PlaneIndex), updated.
+	 * @return Classification.
+	 */
+	Classification classify( const sf::Vector3<T>& min, const sf::Vector3<T>& max, uint32_t& plane_mask ) const;
+
+	Plane<T> planes[NUM_PLANES]; ///< Planes.
+};
+
+typedef Frustum<float> FloatFrustum; ///< Float frustum.
+
+}
+
+#include "Frustum.inl"
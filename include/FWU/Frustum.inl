@@ -0,0 +1,75 @@
+#include <cmath>
+
+namespace util {
+
+template <class T>
+Frustum<T>::Frustum( const Matrix<T>& view_projection ) {
+	const T* m = view_projection.values;
+
+	// Clip space: -w <= x, y, z <= w, with rows of the column-major matrix
+	// giving x, y, z and w.
+	for( std::size_t plane_idx = 0; plane_idx < NUM_PLANES; ++plane_idx ) {
+		std::size_t row = plane_idx / 2;
+		T sign = (plane_idx % 2 == 0) ? T( 1 ) : T( -1 );
+		Plane<T>& plane = planes[plane_idx];
+
+		plane.normal.x = m[3] + sign * m[row];
+		plane.normal.y = m[7] + sign * m[4 + row];
+		plane.normal.z = m[11] + sign * m[8 + row];
+		plane.distance = m[15] + sign * m[12 + row];
+
+		T length = std::sqrt(
+			plane.normal.x * plane.normal.x +
+			plane.normal.y * plane.normal.y +
+			plane.normal.z * plane.normal.z
+		);
+
+		if( length > T( 0 ) ) {
+			plane.normal.x /= length;
+			plane.normal.y /= length;
+			plane.normal.z /= length;
+			plane.distance /= length;
+		}
+	}
+}
+
+template <class T>
+typename Frustum<T>::Classification Frustum<T>::classify( const sf::Vector3<T>& min, const sf::Vector3<T>& max, uint32_t& plane_mask ) const {
+	for( std::size_t plane_idx = 0; plane_idx < NUM_PLANES; ++plane_idx ) {
+		uint32_t plane_bit = static_cast<uint32_t>( 1 ) << plane_idx;
+
+		if( !(plane_mask & plane_bit) ) {
+			continue;
+		}
+
+		const Plane<T>& plane = planes[plane_idx];
+
+		// Corner farthest along the normal. If it's behind, the whole box is.
+		T positive = (
+			plane.normal.x * (plane.normal.x >= T( 0 ) ? max.x : min.x) +
+			plane.normal.y * (plane.normal.y >= T( 0 ) ? max.y : min.y) +
+			plane.normal.z * (plane.normal.z >= T( 0 ) ? max.z : min.z) +
+			plane.distance
+		);
+
+		if( positive < T( 0 ) ) {
+			return OUTSIDE;
+		}
+
+		// Opposite corner. If it's in front, the whole box is.
+		T negative = (
+			plane.normal.x * (plane.normal.x >= T( 0 ) ? min.x : max.x) +
+			plane.normal.y * (plane.normal.y >= T( 0 ) ? min.y : max.y) +
+			plane.normal.z * (plane.normal.z >= T( 0 ) ? min.z : max.z) +
+			plane.distance
+		);
+
+		if( negative >= T( 0 ) ) {
+			plane_mask &= ~plane_bit;
+		}
+	}
+
+	return plane_mask == 0 ? INSIDE : INTERSECTING;
+}
+
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <FWU/Cuboid.hpp>
+#include <FWU/LocationCode.hpp>
+
+#include <SFML/System/Vector3.hpp>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace util {
+
+/** Linear loose octree.
+ *
+ * Stores the same nodes as LooseOctree and places data the same way, but
+ * instead of linking nodes by pointers, nodes are kept in a flat array and
+ * found through an open-addressing hash map keyed by their location code (see
+ * calc_location_code()). The code of a node's parent, children and neighbours
+ * follows from its own code arithmetically, so the nodes don't store links
+ * except for a mask of existing children.
+ *
+ * The root node is always at position 0, 0, 0 and its size is limited to
+ * 2^21, so all location codes fit into 64 bits.
+ *
+ * Octants of children are the Morton bits of the child's cell: bit 0 for x,
+ * bit 1 for y and bit 2 for z.
+ *
+ * Const member functions don't modify the tree, so any number of threads may
+ * search the same tree concurrently as long as no thread modifies it.
+ *
+ *   * T: Data type.
+ *   * DVS: Data vector scalar.
+ *   * Allocator: Allocator used for nodes, hash map and data (rebound).
+ */
+template <class T, class DVS = float, class Allocator = std::allocator<T>>
+class LinearLooseOctree {
+	public:
+		typedef uint32_t Size; ///< Size type.
+		typedef uint64_t NodeCode; ///< Location code of a node.
+		typedef sf::Vector3<Size> Vector; ///< Tree location vector.
+		typedef Cuboid<DVS> DataCuboid; ///< Data cuboid.
+		typedef sf::Vector3<DVS> DataVector; ///< Data vector.
+		typedef std::vector<T> DataArray; ///< Data array.
+
+		/** Handle of inserted data.
+		 * Handles are slot indices checked against a generation counter, so a
+		 * handle of erased data is detected as invalid even if its slot has been
+		 * reused.
+		 */
+		struct Handle {
+			/** Ctor.
+			 * Initializes an invalid handle.
+			 */
+			Handle();
+
+			/** Equality.
+			 * @param other Other handle.
+			 * @return true if equal.
+			 */
+			bool operator==( const Handle& other ) const;
+
+			/** Unequality.
+			 * @param other Other handle.
+			 * @return true if not equal.
+			 */
+			bool operator!=( const Handle& other ) const;
+
+			uint32_t index; ///< Slot index.
+			uint32_t generation; ///< Slot generation.
+		};
+
+		/** Ctor.
+		 * @param size Size (must be power of two, at most 2^21).
+		 * @param allocator Allocator.
+		 */
+		LinearLooseOctree( Size size, const Allocator& allocator = Allocator() );
+
+		/** Get size.
+		 * @return Size.
+		 */
+		Size get_size() const;
+
+		/** Get number of nodes, including the root node.
+		 * @return Number of nodes.
+		 */
+		std::size_t get_num_nodes() const;
+
+		/** Get code of the root node.
+		 * @return Root node code.
+		 */
+		static NodeCode get_root_code();
+
+		/** Get code of a node's parent.
+		 * Undefined behaviour for the root node.
+		 * @param code Node code.
+		 * @return Parent node code.
+		 */
+		static NodeCode get_parent_code( NodeCode code );
+
+		/** Get code of a node's child.
+		 * @param code Node code.
+		 * @param octant Octant (0 to 7).
+		 * @return Child node code.
+		 */
+		static NodeCode get_child_code( NodeCode code, uint32_t octant );
+
+		/** Get depth of a node.
+		 * @param code Node code.
+		 * @return Depth (0 for the root node).
+		 */
+		static uint32_t get_depth( NodeCode code );
+
+		/** Get code of a neighbour node at the same depth.
+		 * @param code Node code.
+		 * @param offset_x Offset in cells along the x axis.
+		 * @param offset_y Offset in cells along the y axis.
+		 * @param offset_z Offset in cells along the z axis.
+		 * @param neighbour Receives the neighbour's code.
+		 * @return false if the neighbour would be outside the tree.
+		 */
+		bool get_neighbour_code( NodeCode code, int32_t offset_x, int32_t offset_y, int32_t offset_z, NodeCode& neighbour ) const;
+
+		/** Get size of a node.
+		 * @param code Node code.
+		 * @return Size.
+		 */
+		Size get_node_size( NodeCode code ) const;
+
+		/** Get position of a node.
+		 * @param code Node code.
+		 * @return Position.
+		 */
+		Vector get_node_position( NodeCode code ) const;
+
+		/** Check if a node exists.
+		 * @param code Node code.
+		 * @return true if it exists.
+		 */
+		bool has_node( NodeCode code ) const;
+
+		/** Get number of data of a node.
+		 * @param code Node code.
+		 * @return Number of data, 0 if the node doesn't exist.
+		 */
+		std::size_t get_num_data( NodeCode code ) const;
+
+		/** Get data of a node.
+		 * @param code Node code.
+		 * @return Data, empty if the node doesn't exist.
+		 */
+		DataArray get_data( NodeCode code ) const;
+
+		/** Insert data.
+		 * Creates the target node and its missing ancestors. Undefined behaviour
+		 * if cuboid is invalid (out of bounds, too big, empty etc.).
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 * @return Handle of the inserted data.
+		 */
+		Handle insert( const T& data, const DataCuboid& cuboid );
+
+		/** Check if a handle refers to data in the tree.
+		 * @param handle Handle.
+		 * @return true if valid, false if erased or invalid.
+		 */
+		bool is_valid( const Handle& handle ) const;
+
+		/** Get data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Data.
+		 * @see is_valid
+		 */
+		T& get( const Handle& handle );
+
+		/** Get data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Data.
+		 * @see is_valid
+		 */
+		const T& get( const Handle& handle ) const;
+
+		/** Get cuboid of data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Cuboid.
+		 * @see is_valid
+		 */
+		DataCuboid get_cuboid( const Handle& handle ) const;
+
+		/** Get code of the node holding data.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Node code.
+		 * @see is_valid
+		 */
+		NodeCode get_node_code( const Handle& handle ) const;
+
+		/** Search the tree for data in a specific cuboid.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param results Array for results (not cleared).
+		 */
+		void search( const DataCuboid& cuboid, DataArray& results ) const;
+
+		/** Search the tree for data in a specific cuboid without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 */
+		template <class Visitor>
+		bool search( const DataCuboid& cuboid, Visitor&& visitor ) const;
+
+		/** Count all data in the tree.
+		 * @return Number of data.
+		 */
+		std::size_t count_all() const;
+
+		/** Erase all data occurences in a specific cuboid.
+		 * Nodes left without data and children are removed.
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 */
+		void erase( const T& data, const DataCuboid& cuboid );
+
+		/** Erase data by handle.
+		 * If the handle is invalid, nothing happens.
+		 * @param handle Handle.
+		 */
+		void erase( const Handle& handle );
+
+	private:
+		struct Item {
+			Item( const T& data_, const DataCuboid& cuboid_, uint32_t slot_ );
+
+			T data;
+			DataCuboid cuboid;
+			uint32_t slot;
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Item> ItemAllocator;
+		typedef std::vector<Item, ItemAllocator> ItemArray;
+
+		struct Node {
+			Node( NodeCode code_, const Allocator& allocator );
+
+			NodeCode code;
+			ItemArray items;
+			uint32_t children; ///< Bit mask of existing children, indexed by octant.
+		};
+
+		/** Hash map entry. Code 0 marks an empty entry.
+		 */
+		struct Entry {
+			NodeCode code;
+			uint32_t node;
+		};
+
+		struct Slot {
+			NodeCode code; ///< Code of the node holding the data, 0 if free.
+			uint32_t index; ///< Data index if used, next free slot if free.
+			uint32_t generation;
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Entry> EntryAllocator;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Slot> SlotAllocator;
+
+		static const uint32_t INVALID_NODE = 0xffffffff;
+
+		uint32_t find_node( NodeCode code ) const;
+		uint32_t find_or_create_node( NodeCode code );
+		bool remove_unused_node( NodeCode code );
+		void remove_node( NodeCode code );
+
+		std::size_t find_entry( NodeCode code ) const;
+		void insert_entry( NodeCode code, uint32_t node );
+		void remove_entry( std::size_t entry_idx );
+		void grow_entries();
+
+		uint32_t acquire_slot();
+		void release_slot( uint32_t slot );
+		void remove_item( uint32_t node_idx, std::size_t item_idx );
+
+		static bool intersects( const DataCuboid& first, const DataCuboid& second );
+		bool overlaps_loosely( NodeCode code, const DataCuboid& cuboid, bool& covered ) const;
+
+		template <class Visitor>
+		bool search_node( uint32_t node_idx, const DataCuboid& cuboid, Visitor& visitor ) const;
+
+		template <class Visitor>
+		bool visit_all( uint32_t node_idx, Visitor& visitor ) const;
+
+		void erase_node( NodeCode code, const T& data, const DataCuboid& cuboid );
+
+		Allocator m_allocator;
+		std::vector<Node, NodeAllocator> m_nodes;
+		std::vector<Entry, EntryAllocator> m_entries;
+		std::vector<Slot, SlotAllocator> m_slots;
+		uint32_t m_free_slot;
+		Size m_size;
+};
+
+}
+
+#include "LinearLooseOctree.inl"
@@ -0,0 +1,611 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+namespace util {
+
+template <class T, class DVS, class A>
+LinearLooseOctree<T, DVS, A>::LinearLooseOctree( Size size, const A& allocator ) :
+	m_allocator( allocator ),
+	m_nodes( allocator ),
+	m_entries( 16, Entry(), allocator ),
+	m_slots( allocator ),
+	m_free_slot( std::numeric_limits<uint32_t>::max() ),
+	m_size( size )
+{
+	assert( size > 0 && (size & (size - 1)) == 0 );
+	assert( size <= (static_cast<Size>( 1 ) << MORTON_BITS) );
+
+	// The root node always exists.
+	find_or_create_node( get_root_code() );
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::Size LinearLooseOctree<T, DVS, A>::get_size() const {
+	return m_size;
+}
+
+template <class T, class DVS, class A>
+std::size_t LinearLooseOctree<T, DVS, A>::get_num_nodes() const {
+	return m_nodes.size();
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::NodeCode LinearLooseOctree<T, DVS, A>::get_root_code() {
+	return 1;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::NodeCode LinearLooseOctree<T, DVS, A>::get_parent_code( NodeCode code ) {
+	assert( code > 1 );
+	return code >> 3;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::NodeCode LinearLooseOctree<T, DVS, A>::get_child_code( NodeCode code, uint32_t octant ) {
+	assert( octant < 8 );
+	return (code << 3) | octant;
+}
+
+template <class T, class DVS, class A>
+uint32_t LinearLooseOctree<T, DVS, A>::get_depth( NodeCode code ) {
+	return calc_location_depth( code );
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::get_neighbour_code(
+	NodeCode code,
+	int32_t offset_x,
+	int32_t offset_y,
+	int32_t offset_z,
+	NodeCode& neighbour
+) const {
+	uint32_t depth = get_depth( code );
+	int64_t num_cells = static_cast<int64_t>( 1 ) << depth;
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t z = 0;
+
+	morton_decode( code ^ (static_cast<NodeCode>( 1 ) << (3 * depth)), x, y, z );
+
+	int64_t neighbour_x = static_cast<int64_t>( x ) + offset_x;
+	int64_t neighbour_y = static_cast<int64_t>( y ) + offset_y;
+	int64_t neighbour_z = static_cast<int64_t>( z ) + offset_z;
+
+	if(
+		neighbour_x < 0 || neighbour_x >= num_cells ||
+		neighbour_y < 0 || neighbour_y >= num_cells ||
+		neighbour_z < 0 || neighbour_z >= num_cells
+	) {
+		return false;
+	}
+
+	neighbour = (static_cast<NodeCode>( 1 ) << (3 * depth)) | morton_encode(
+		static_cast<uint32_t>( neighbour_x ),
+		static_cast<uint32_t>( neighbour_y ),
+		static_cast<uint32_t>( neighbour_z )
+	);
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::Size LinearLooseOctree<T, DVS, A>::get_node_size( NodeCode code ) const {
+	return m_size >> get_depth( code );
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::Vector LinearLooseOctree<T, DVS, A>::get_node_position( NodeCode code ) const {
+	Size size = get_node_size( code );
+	Vector position;
+
+	// Strip the depth marker, the remaining bits are the cell's Morton code.
+	morton_decode( code ^ (static_cast<NodeCode>( 1 ) << (3 * get_depth( code ))), position.x, position.y, position.z );
+
+	position.x *= size;
+	position.y *= size;
+	position.z *= size;
+
+	return position;
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::has_node( NodeCode code ) const {
+	return find_node( code ) != INVALID_NODE;
+}
+
+template <class T, class DVS, class A>
+std::size_t LinearLooseOctree<T, DVS, A>::get_num_data( NodeCode code ) const {
+	uint32_t node_idx = find_node( code );
+	return node_idx != INVALID_NODE ? m_nodes[node_idx].items.size() : 0;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::DataArray LinearLooseOctree<T, DVS, A>::get_data( NodeCode code ) const {
+	DataArray data;
+	uint32_t node_idx = find_node( code );
+
+	if( node_idx != INVALID_NODE ) {
+		const ItemArray& items = m_nodes[node_idx].items;
+
+		data.reserve( items.size() );
+
+		for( std::size_t item_idx = 0; item_idx < items.size(); ++item_idx ) {
+			data.push_back( items[item_idx].data );
+		}
+	}
+
+	return data;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::Handle LinearLooseOctree<T, DVS, A>::insert( const T& data, const DataCuboid& cuboid ) {
+	assert( cuboid.width > 0 && cuboid.height > 0 && cuboid.depth > 0 );
+	assert( cuboid.width <= static_cast<DVS>( m_size ) && cuboid.height <= static_cast<DVS>( m_size ) && cuboid.depth <= static_cast<DVS>( m_size ) );
+
+	NodeCode code = calc_location_code( cuboid, Vector( 0, 0, 0 ), m_size );
+	uint32_t node_idx = find_or_create_node( code );
+	uint32_t slot = acquire_slot();
+	ItemArray& items = m_nodes[node_idx].items;
+
+	items.push_back( Item( data, cuboid, slot ) );
+
+	m_slots[slot].code = code;
+	m_slots[slot].index = static_cast<uint32_t>( items.size() - 1 );
+
+	Handle handle;
+	handle.index = slot;
+	handle.generation = m_slots[slot].generation;
+
+	return handle;
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::is_valid( const Handle& handle ) const {
+	return (
+		handle.index < m_slots.size() &&
+		m_slots[handle.index].code != 0 &&
+		m_slots[handle.index].generation == handle.generation
+	);
+}
+
+template <class T, class DVS, class A>
+T& LinearLooseOctree<T, DVS, A>::get( const Handle& handle ) {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_slots[handle.index];
+	return m_nodes[find_node( info.code )].items[info.index].data;
+}
+
+template <class T, class DVS, class A>
+const T& LinearLooseOctree<T, DVS, A>::get( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_slots[handle.index];
+	return m_nodes[find_node( info.code )].items[info.index].data;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::DataCuboid LinearLooseOctree<T, DVS, A>::get_cuboid( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_slots[handle.index];
+	return m_nodes[find_node( info.code )].items[info.index].cuboid;
+}
+
+template <class T, class DVS, class A>
+typename LinearLooseOctree<T, DVS, A>::NodeCode LinearLooseOctree<T, DVS, A>::get_node_code( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+	return m_slots[handle.index].code;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, DataArray& results ) const {
+	search(
+		cuboid,
+		[&results]( const T& data, const DataCuboid& /*data_cuboid*/ ) -> bool {
+			results.push_back( data );
+			return true;
+		}
+	);
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LinearLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, Visitor&& visitor ) const {
+	return search_node( find_node( get_root_code() ), cuboid, visitor );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LinearLooseOctree<T, DVS, A>::search_node( uint32_t node_idx, const DataCuboid& cuboid, Visitor& visitor ) const {
+	const Node& node = m_nodes[node_idx];
+	bool covered = false;
+
+	if( !overlaps_loosely( node.code, cuboid, covered ) ) {
+		return true;
+	}
+
+	// All data of the subtree lies within the loose bounds.
+	if( covered ) {
+		return visit_all( node_idx, visitor );
+	}
+
+	for( std::size_t item_idx = 0; item_idx < node.items.size(); ++item_idx ) {
+		const Item& item = node.items[item_idx];
+
+		if( intersects( item.cuboid, cuboid ) && !visitor( item.data, item.cuboid ) ) {
+			return false;
+		}
+	}
+
+	for( uint32_t octant = 0; octant < 8; ++octant ) {
+		if(
+			(node.children & (1u << octant)) &&
+			!search_node( find_node( get_child_code( node.code, octant ) ), cuboid, visitor )
+		) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LinearLooseOctree<T, DVS, A>::visit_all( uint32_t node_idx, Visitor& visitor ) const {
+	const Node& node = m_nodes[node_idx];
+
+	for( std::size_t item_idx = 0; item_idx < node.items.size(); ++item_idx ) {
+		if( !visitor( node.items[item_idx].data, node.items[item_idx].cuboid ) ) {
+			return false;
+		}
+	}
+
+	for( uint32_t octant = 0; octant < 8; ++octant ) {
+		if(
+			(node.children & (1u << octant)) &&
+			!visit_all( find_node( get_child_code( node.code, octant ) ), visitor )
+		) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+std::size_t LinearLooseOctree<T, DVS, A>::count_all() const {
+	std::size_t num_data = 0;
+
+	for( std::size_t node_idx = 0; node_idx < m_nodes.size(); ++node_idx ) {
+		num_data += m_nodes[node_idx].items.size();
+	}
+
+	return num_data;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::erase( const T& data, const DataCuboid& cuboid ) {
+	erase_node( get_root_code(), data, cuboid );
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::erase_node( NodeCode code, const T& data, const DataCuboid& cuboid ) {
+	bool covered = false;
+
+	if( !overlaps_loosely( code, cuboid, covered ) ) {
+		return;
+	}
+
+	// Children first, removing nodes moves others in the node array.
+	uint32_t children = m_nodes[find_node( code )].children;
+
+	for( uint32_t octant = 0; octant < 8; ++octant ) {
+		if( children & (1u << octant) ) {
+			erase_node( get_child_code( code, octant ), data, cuboid );
+		}
+	}
+
+	uint32_t node_idx = find_node( code );
+	std::size_t item_idx = 0;
+
+	while( item_idx < m_nodes[node_idx].items.size() ) {
+		const Item& item = m_nodes[node_idx].items[item_idx];
+
+		if( item.data == data && intersects( item.cuboid, cuboid ) ) {
+			// The last entry is moved here, so test the same index again.
+			remove_item( node_idx, item_idx );
+		}
+		else {
+			++item_idx;
+		}
+	}
+
+	// Parents are checked after their children, when returning.
+	remove_unused_node( code );
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::erase( const Handle& handle ) {
+	if( !is_valid( handle ) ) {
+		return;
+	}
+
+	NodeCode code = m_slots[handle.index].code;
+
+	remove_item( find_node( code ), m_slots[handle.index].index );
+
+	// Remove the node and all ancestors left empty.
+	while( remove_unused_node( code ) ) {
+		code = get_parent_code( code );
+	}
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::intersects( const DataCuboid& first, const DataCuboid& second ) {
+	// Same boundary semantics as Cuboid::calc_intersection().
+	return (
+		std::max( first.x, second.x ) < std::min( first.x + first.width, second.x + second.width ) &&
+		std::max( first.y, second.y ) < std::min( first.y + first.height, second.y + second.height ) &&
+		std::max( first.z, second.z ) < std::min( first.z + first.depth, second.z + second.depth )
+	);
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::overlaps_loosely( NodeCode code, const DataCuboid& cuboid, bool& covered ) const {
+	DVS size = static_cast<DVS>( get_node_size( code ) );
+	Vector position = get_node_position( code );
+	DataCuboid loose(
+		static_cast<DVS>( position.x ) - size / DVS( 2 ),
+		static_cast<DVS>( position.y ) - size / DVS( 2 ),
+		static_cast<DVS>( position.z ) - size / DVS( 2 ),
+		size * DVS( 2 ),
+		size * DVS( 2 ),
+		size * DVS( 2 )
+	);
+
+	covered = (
+		cuboid.x <= loose.x &&
+		cuboid.y <= loose.y &&
+		cuboid.z <= loose.z &&
+		cuboid.x + cuboid.width >= loose.x + loose.width &&
+		cuboid.y + cuboid.height >= loose.y + loose.height &&
+		cuboid.z + cuboid.depth >= loose.z + loose.depth
+	);
+
+	return intersects( loose, cuboid );
+}
+
+template <class T, class DVS, class A>
+uint32_t LinearLooseOctree<T, DVS, A>::find_node( NodeCode code ) const {
+	std::size_t entry_idx = find_entry( code );
+	return entry_idx != m_entries.size() ? m_entries[entry_idx].node : INVALID_NODE;
+}
+
+template <class T, class DVS, class A>
+uint32_t LinearLooseOctree<T, DVS, A>::find_or_create_node( NodeCode code ) {
+	uint32_t node_idx = find_node( code );
+
+	if( node_idx != INVALID_NODE ) {
+		return node_idx;
+	}
+
+	assert( m_nodes.size() < INVALID_NODE );
+
+	node_idx = static_cast<uint32_t>( m_nodes.size() );
+	m_nodes.push_back( Node( code, m_allocator ) );
+	insert_entry( code, node_idx );
+
+	// Link to the parent, creating only missing ancestors.
+	if( code != get_root_code() ) {
+		NodeCode parent_code = get_parent_code( code );
+		uint32_t parent_idx = find_or_create_node( parent_code );
+
+		m_nodes[parent_idx].children |= 1u << (code & 7);
+	}
+
+	return node_idx;
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::remove_unused_node( NodeCode code ) {
+	const Node& node = m_nodes[find_node( code )];
+
+	if( code == get_root_code() || node.children != 0 || !node.items.empty() ) {
+		return false;
+	}
+
+	remove_node( code );
+
+	NodeCode parent_code = get_parent_code( code );
+	m_nodes[find_node( parent_code )].children &= ~(1u << (code & 7));
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::remove_node( NodeCode code ) {
+	std::size_t entry_idx = find_entry( code );
+	assert( entry_idx != m_entries.size() );
+
+	uint32_t node_idx = m_entries[entry_idx].node;
+	uint32_t last_idx = static_cast<uint32_t>( m_nodes.size() - 1 );
+
+	remove_entry( entry_idx );
+
+	// Move the last node into the gap.
+	if( node_idx != last_idx ) {
+		m_nodes[node_idx] = std::move( m_nodes[last_idx] );
+		m_entries[find_entry( m_nodes[node_idx].code )].node = node_idx;
+	}
+
+	m_nodes.pop_back();
+}
+
+template <class T, class DVS, class A>
+std::size_t LinearLooseOctree<T, DVS, A>::find_entry( NodeCode code ) const {
+	std::size_t mask = m_entries.size() - 1;
+	std::size_t entry_idx = static_cast<std::size_t>( (code * 0x9e3779b97f4a7c15ull) >> 32 ) & mask;
+
+	// Linear probing, the map is never full.
+	while( m_entries[entry_idx].code != 0 ) {
+		if( m_entries[entry_idx].code == code ) {
+			return entry_idx;
+		}
+
+		entry_idx = (entry_idx + 1) & mask;
+	}
+
+	return m_entries.size();
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::insert_entry( NodeCode code, uint32_t node ) {
+	// Keep the load factor <= 1/2.
+	if( m_nodes.size() * 2 > m_entries.size() ) {
+		grow_entries();
+	}
+
+	std::size_t mask = m_entries.size() - 1;
+	std::size_t entry_idx = static_cast<std::size_t>( (code * 0x9e3779b97f4a7c15ull) >> 32 ) & mask;
+
+	while( m_entries[entry_idx].code != 0 ) {
+		entry_idx = (entry_idx + 1) & mask;
+	}
+
+	m_entries[entry_idx].code = code;
+	m_entries[entry_idx].node = node;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::remove_entry( std::size_t entry_idx ) {
+	std::size_t mask = m_entries.size() - 1;
+	std::size_t gap_idx = entry_idx;
+
+	m_entries[gap_idx].code = 0;
+
+	// Shift following entries back into the gap if their probe sequence passes
+	// it, so lookups never stop early.
+	for( std::size_t next_idx = (gap_idx + 1) & mask; m_entries[next_idx].code != 0; next_idx = (next_idx + 1) & mask ) {
+		std::size_t home_idx = static_cast<std::size_t>( (m_entries[next_idx].code * 0x9e3779b97f4a7c15ull) >> 32 ) & mask;
+
+		if( ((next_idx - home_idx) & mask) >= ((next_idx - gap_idx) & mask) ) {
+			m_entries[gap_idx] = m_entries[next_idx];
+			m_entries[next_idx].code = 0;
+			gap_idx = next_idx;
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::grow_entries() {
+	std::vector<Entry, EntryAllocator> old_entries( m_entries.size() * 2, Entry(), m_allocator );
+	std::size_t mask = old_entries.size() - 1;
+
+	old_entries.swap( m_entries );
+
+	for( std::size_t old_idx = 0; old_idx < old_entries.size(); ++old_idx ) {
+		if( old_entries[old_idx].code == 0 ) {
+			continue;
+		}
+
+		std::size_t entry_idx = static_cast<std::size_t>( (old_entries[old_idx].code * 0x9e3779b97f4a7c15ull) >> 32 ) & mask;
+
+		while( m_entries[entry_idx].code != 0 ) {
+			entry_idx = (entry_idx + 1) & mask;
+		}
+
+		m_entries[entry_idx] = old_entries[old_idx];
+	}
+}
+
+template <class T, class DVS, class A>
+uint32_t LinearLooseOctree<T, DVS, A>::acquire_slot() {
+	uint32_t slot = m_free_slot;
+
+	if( slot != std::numeric_limits<uint32_t>::max() ) {
+		m_free_slot = m_slots[slot].index;
+	}
+	else {
+		assert( m_slots.size() < std::numeric_limits<uint32_t>::max() );
+
+		slot = static_cast<uint32_t>( m_slots.size() );
+		m_slots.push_back( Slot() );
+		m_slots.back().generation = 0;
+	}
+
+	m_slots[slot].code = 0;
+	m_slots[slot].index = 0;
+
+	return slot;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::release_slot( uint32_t slot ) {
+	Slot& info = m_slots[slot];
+
+	// Bumping the generation invalidates all handles to the slot.
+	info.code = 0;
+	info.index = m_free_slot;
+	++info.generation;
+
+	m_free_slot = slot;
+}
+
+template <class T, class DVS, class A>
+void LinearLooseOctree<T, DVS, A>::remove_item( uint32_t node_idx, std::size_t item_idx ) {
+	ItemArray& items = m_nodes[node_idx].items;
+	assert( item_idx < items.size() );
+
+	release_slot( items[item_idx].slot );
+
+	if( item_idx != items.size() - 1 ) {
+		items[item_idx] = std::move( items.back() );
+		m_slots[items[item_idx].slot].index = static_cast<uint32_t>( item_idx );
+	}
+
+	items.pop_back();
+}
+
+///// Handle //////
+
+template <class T, class DVS, class A>
+LinearLooseOctree<T, DVS, A>::Handle::Handle() :
+	index( std::numeric_limits<uint32_t>::max() ),
+	generation( 0 )
+{
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::Handle::operator==( const Handle& other ) const {
+	return index == other.index && generation == other.generation;
+}
+
+template <class T, class DVS, class A>
+bool LinearLooseOctree<T, DVS, A>::Handle::operator!=( const Handle& other ) const {
+	return index != other.index || generation != other.generation;
+}
+
+///// Item //////
+
+template <class T, class DVS, class A>
+LinearLooseOctree<T, DVS, A>::Item::Item( const T& data_, const DataCuboid& cuboid_, uint32_t slot_ ) :
+	data( data_ ),
+	cuboid( cuboid_ ),
+	slot( slot_ )
+{
+}
+
+///// Node //////
+
+template <class T, class DVS, class A>
+LinearLooseOctree<T, DVS, A>::Node::Node( NodeCode code_, const A& allocator ) :
+	code( code_ ),
+	items( allocator ),
+	children( 0 )
+{
+}
+
+}
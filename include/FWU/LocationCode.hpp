@@ -0,0 +1,33 @@
+#pragma once
+
+#include <FWU/Cuboid.hpp>
+#include <FWU/Morton.hpp>
+
+#include <SFML/System/Vector3.hpp>
+#include <cstdint>
+
+namespace util {
+
+/** Calculate the location code of the loose octree node a cuboid belongs to.
+ * The node is the smallest one not smaller than the cuboid's largest
+ * dimension, its cell is the one containing the cuboid's center. The code
+ * consists of a marker bit at position 3 * depth followed by the Morton code of
+ * the cell, so codes of all depths are unique and the parent's code is code >>
+ * 3.
+ * @param cuboid Cuboid (not empty, center inside the tree).
+ * @param position Tree position.
+ * @param size Tree size (power of two, at most 2^21).
+ * @return Location code.
+ */
+template <class DVS>
+uint64_t calc_location_code( const Cuboid<DVS>& cuboid, const sf::Vector3<uint32_t>& position, uint32_t size );
+
+/** Get depth of a location code.
+ * @param code Location code.
+ * @return Depth (0 for the root).
+ */
+uint32_t calc_location_depth( uint64_t code );
+
+}
+
+#include "LocationCode.inl"
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace util {
+
+template <class DVS>
+inline uint32_t calc_location_cell( DVS center, uint32_t position, uint32_t cell_size, uint32_t num_cells ) {
+	DVS offset = center - static_cast<DVS>( position );
+
+	if( offset <= DVS( 0 ) ) {
+		return 0;
+	}
+
+	// A center on the upper boundary belongs to the last cell, like in
+	// LooseOctree::determine_quadrant().
+	uint32_t cell = static_cast<uint32_t>( offset / static_cast<DVS>( cell_size ) );
+	return std::min( cell, num_cells - 1 );
+}
+
+template <class DVS>
+uint64_t calc_location_code( const Cuboid<DVS>& cuboid, const sf::Vector3<uint32_t>& position, uint32_t size ) {
+	assert( size > 0 && size <= (static_cast<uint32_t>( 1 ) << MORTON_BITS) );
+
+	// Nodes hold cuboids that don't fit into half of them, so the target is the
+	// smallest power of two >= the largest dimension.
+	DVS max_dimension = std::max( cuboid.width, std::max( cuboid.height, cuboid.depth ) );
+	uint32_t root_level = floor_log2( size );
+	uint32_t level = 0;
+
+	if( max_dimension > DVS( 1 ) ) {
+		level = std::min( ceil_log2( static_cast<uint64_t>( std::ceil( max_dimension ) ) ), root_level );
+	}
+
+	uint32_t depth = root_level - level;
+	uint32_t cell_size = static_cast<uint32_t>( 1 ) << level;
+	uint32_t num_cells = size / cell_size;
+
+	uint64_t morton = morton_encode(
+		calc_location_cell( cuboid.x + cuboid.width / 2, position.x, cell_size, num_cells ),
+		calc_location_cell( cuboid.y + cuboid.height / 2, position.y, cell_size, num_cells ),
+		calc_location_cell( cuboid.z + cuboid.depth / 2, position.z, cell_size, num_cells )
+	);
+
+	return (static_cast<uint64_t>( 1 ) << (3 * depth)) | morton;
+}
+
+inline uint32_t calc_location_depth( uint64_t code ) {
+	assert( code > 0 );
+
+	// Every level adds three bits below the marker bit.
+	return floor_log2( code ) / 3;
+}
+
+}
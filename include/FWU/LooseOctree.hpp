@@ -1,9 +1,17 @@
 #pragma once
 
+#include <FWU/ChangeJournal.hpp>
 #include <FWU/Cuboid.hpp>
+#include <FWU/Distance.hpp>
+#include <FWU/Frustum.hpp>
+#include <FWU/FrozenLooseOctree.hpp>
+#include <FWU/LocationCode.hpp>
+#include <FWU/ObjectPool.hpp>
+#include <FWU/QueryCounters.hpp>
+#include <FWU/ThreadPool.hpp>
 
 #include <SFML/System/Vector3.hpp>
-#include <list>
+#include <memory>
 #include <vector>
 #include <cstdint>
 
@@ -20,10 +28,18 @@ namespace util {
  * copied into the tree. If you're storing complex data using pointers to the
  * data may be easier on the memory footprint.
  *
+ * Nodes, child arrays and data blocks are allocated from pools owned by the
+ * root node. Storage released by cleanup() is recycled by later insertions and
+ * only handed back to the allocator when the tree is destroyed.
+ *
+ * Const member functions don't modify the tree, so any number of threads may
+ * search the same tree concurrently as long as no thread modifies it.
+ *
  *   * T: Data type.
  *   * DVS: Data vector scalar.
+ *   * Allocator: Allocator used for pool pages and data buffers (rebound).
  */
-template <class T, class DVS = float>
+template <class T, class DVS = float, class Allocator = std::allocator<T>>
 class LooseOctree {
 	public:
 		/** Quadrant.
@@ -47,11 +63,71 @@ class LooseOctree {
 		typedef sf::Vector3<DVS> DataVector; ///< Data vector.
 		typedef std::vector<T> DataArray; ///< Data array.
 
+		/** Handle of inserted data.
+		 * Handles are slot indices checked against a generation counter, so a
+		 * handle of erased data is detected as invalid even if its slot has been
+		 * reused.
+		 */
+		struct Handle {
+			/** Ctor.
+			 * Initializes an invalid handle.
+			 */
+			Handle();
+
+			/** Equality.
+			 * @param other Other handle.
+			 * @return true if equal.
+			 */
+			bool operator==( const Handle& other ) const;
+
+			/** Unequality.
+			 * @param other Other handle.
+			 * @return true if not equal.
+			 */
+			bool operator!=( const Handle& other ) const;
+
+			uint32_t index; ///< Slot index.
+			uint32_t generation; ///< Slot generation.
+		};
+
+		/** Ray cast hit.
+		 */
+		struct RayHit {
+			T data; ///< Data.
+			DataCuboid cuboid; ///< Cuboid of the data.
+			DVS distance; ///< Distance from the ray origin, in units of the ray direction.
+		};
+
+		/** Result of nearest().
+		 */
+		struct Neighbour {
+			T data; ///< Data.
+			DataCuboid cuboid; ///< Cuboid of the data.
+			DVS distance; ///< Distance between the query point and the cuboid.
+		};
+
+		/** Shape and memory usage of a tree, see collect_stats().
+		 */
+		struct Stats {
+			std::vector<std::size_t> num_nodes_per_depth; ///< Number of nodes per depth, relative to the collecting node.
+			std::vector<std::size_t> data_histogram; ///< Number of nodes by number of data: index 0 counts nodes without data, index i > 0 nodes with 2^(i-1) to 2^i - 1 data.
+			std::size_t num_nodes; ///< Number of nodes.
+			std::size_t num_empty_nodes; ///< Number of nodes without data.
+			std::size_t num_data; ///< Number of data.
+			std::size_t max_data_per_node; ///< Maximum number of data of a node.
+			float empty_node_ratio; ///< num_empty_nodes / num_nodes.
+			std::size_t node_bytes; ///< Bytes used by nodes.
+			std::size_t children_bytes; ///< Bytes used by child arrays.
+			std::size_t data_bytes; ///< Bytes used by data lists, including reserved capacity (excludes memory owned by T).
+			std::size_t slot_bytes; ///< Bytes used by handle slots of the whole tree.
+		};
+
 		/** Ctor.
 		 * Position is initialized to 0, 0, 0.
 		 * @param size Size (must be power of two).
+		 * @param allocator Allocator.
 		 */
-		LooseOctree( Size size );
+		LooseOctree( Size size, const Allocator& allocator = Allocator() );
 
 		/** Dtor.
 		 */
@@ -67,6 +143,23 @@ class LooseOctree {
 		 */
 		const Vector& get_position() const;
 
+		/** Get minimum corner of the node's loose bounds.
+		 * @return Minimum corner.
+		 */
+		const DataVector& get_loose_min() const;
+
+		/** Get maximum corner of the node's loose bounds.
+		 * @return Maximum corner.
+		 */
+		const DataVector& get_loose_max() const;
+
+		/** Check if a cuboid overlaps the node's loose bounds.
+		 * Uses the same boundary rules as Cuboid::calc_intersection().
+		 * @param cuboid Cuboid.
+		 * @return true if overlapping.
+		 */
+		bool overlaps_loosely( const DataCuboid& cuboid ) const;
+
 		/** Check if node is subdivided.
 		 * @return true if subdivided.
 		 */
@@ -89,7 +182,7 @@ class LooseOctree {
 		 * @return Child.
 		 * @see has_child
 		 */
-		LooseOctree<T, DVS>& get_child( Quadrant quadrant ) const;
+		LooseOctree& get_child( Quadrant quadrant ) const;
 
 		/** Get data.
 		 * @return Data.
@@ -98,12 +191,133 @@ class LooseOctree {
 		DataArray get_data() const;
 
 		/** Insert data.
-		 * Undefined behaviour if cuboid is invalid (out of bounds, too big etc.).
+		 * The target node follows directly from the cuboid's largest dimension
+		 * and center, so only the path down to it is walked and missing nodes on
+		 * it are created. Undefined behaviour if cuboid is invalid (out of bounds,
+		 * too big, empty etc.).
 		 * @param data Data.
 		 * @param cuboid Cuboid.
-		 * @return Node the data has been added to.
+		 * @return Handle of the inserted data.
+		 */
+		Handle insert( const T& data, const DataCuboid& cuboid );
+
+		/** Insert many data at once.
+		 * Every element of the range provides the data as first and its cuboid as
+		 * second member, like std::pair<T, DataCuboid>. The target node of each
+		 * element is computed directly and encoded as level and Morton key. The
+		 * keys are sorted and the nodes are created level by level, each node only
+		 * once. The resulting tree equals the tree of inserting the elements one
+		 * by one in range order, including the handles. Undefined behaviour if any
+		 * cuboid is invalid (see insert()).
+		 * @param begin Range begin (random access iterator).
+		 * @param end Range end.
+		 * @param handles Array receiving one handle per element in range order (may be nullptr).
+		 */
+		template <class Iterator>
+		void build( Iterator begin, Iterator end, Handle* handles = nullptr );
+
+		/** Insert many data at once, using a thread pool.
+		 * Computing and sorting the keys and filling the nodes is spread over the
+		 * pool's threads. Creating the nodes happens on the calling thread.
+		 * @param begin Range begin (random access iterator).
+		 * @param end Range end.
+		 * @param pool Thread pool.
+		 * @param handles Array receiving one handle per element in range order (may be nullptr).
+		 * @see build( Iterator, Iterator, Handle* )
+		 */
+		template <class Iterator>
+		void build( Iterator begin, Iterator end, ThreadPool& pool, Handle* handles = nullptr );
+
+		/** Replace all nodes and data with a copy of another tree.
+		 * Only valid for root nodes of equal size. The copy has the same nodes,
+		 * data order and handles as the other tree. Nodes and data blocks
+		 * previously held by this tree are recycled for the copy.
+		 * @param other Other tree.
+		 */
+		void assign( const LooseOctree& other );
+
+		/** Serialize the tree into a compact binary buffer.
+		 * Only valid for root nodes and trivially copyable T. The buffer holds a
+		 * versioned header, the nodes flattened depth-first with relative child
+		 * offsets, the cuboids, a contiguous payload region and the handle slots.
+		 * It can be written to a file and queried in place with FrozenLooseOctree,
+		 * e.g. after memory-mapping the file. Data is stored in node order, not in
+		 * the order of this tree's nodes, handles are kept.
+		 * @param buffer Buffer (replaced).
+		 */
+		void serialize( std::vector<char>& buffer ) const;
+
+		/** Replace all nodes and data with a serialized tree.
+		 * Only valid for root nodes of equal size. The tree gets the same nodes,
+		 * data order and handles as the serialized tree, including the order in
+		 * which erased handle slots are reused. Nodes and data blocks previously
+		 * held by this tree are recycled.
+		 * @param frozen Loaded serialized tree.
+		 * @see serialize
+		 */
+		void assign( const FrozenLooseOctree<T, DVS>& frozen );
+
+		/** Set journal recording changes.
+		 * insert(), build(), erase() and update() append one record per changed
+		 * data. Replacing the tree with assign() isn't recorded, take a new
+		 * snapshot afterwards. Only valid for root nodes and trivially copyable T.
+		 * @param journal Journal (nullptr to stop recording, must outlive the tree otherwise).
+		 */
+		void set_journal( ChangeJournal<T, DVS>* journal );
+
+		/** Get journal recording changes.
+		 * @return Journal, nullptr if none.
+		 */
+		ChangeJournal<T, DVS>* get_journal() const;
+
+		/** Check if a handle refers to data in the tree.
+		 * Handles can be checked at any node of the tree.
+		 * @param handle Handle.
+		 * @return true if valid, false if erased or invalid.
+		 */
+		bool is_valid( const Handle& handle ) const;
+
+		/** Get data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Data.
+		 * @see is_valid
+		 */
+		T& get( const Handle& handle );
+
+		/** Get data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Data.
+		 * @see is_valid
+		 */
+		const T& get( const Handle& handle ) const;
+
+		/** Get cuboid of data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Cuboid.
+		 * @see is_valid
+		 */
+		DataCuboid get_cuboid( const Handle& handle ) const;
+
+		/** Get node holding data.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Node.
+		 * @see is_valid
+		 */
+		LooseOctree& get_node( const Handle& handle ) const;
+
+		/** Move data to a new cuboid.
+		 * If the new cuboid still fits into the loose bounds of the node holding
+		 * the data, only the cuboid is updated. Otherwise the data is relocated
+		 * starting at the nearest ancestor that can hold it. The handle stays
+		 * valid. Undefined behaviour if handle or cuboid is invalid.
+		 * @param handle Handle.
+		 * @param cuboid New cuboid.
 		 */
-		LooseOctree& insert( const T& data, const DataCuboid& cuboid );
+		void update( const Handle& handle, const DataCuboid& cuboid );
 
 		/** Search the tree for data in a specific cuboid.
 		 * @param cuboid Cuboid (may be out of bounds).
@@ -111,6 +325,213 @@ class LooseOctree {
 		 */
 		void search( const DataCuboid& cuboid, DataArray& results ) const;
 
+		/** Search the tree for data in a specific cuboid without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 */
+		template <class Visitor>
+		bool search( const DataCuboid& cuboid, Visitor&& visitor ) const;
+
+		/** Search the tree for multiple cuboids in one traversal.
+		 * Each node is visited once per batch instead of once per query. Only
+		 * queries overlapping a node's loose bounds are carried down to it.
+		 * @param cuboids Query cuboids (may be out of bounds).
+		 * @param num_cuboids Number of query cuboids.
+		 * @param results Result arrays, one per query cuboid (not cleared).
+		 */
+		void search( const DataCuboid* cuboids, std::size_t num_cuboids, DataArray* results ) const;
+
+		/** Search the tree for multiple cuboids in parallel.
+		 * The queries are split into chunks which are searched as batches by the
+		 * pool's threads. Every chunk only writes to the result arrays of its own
+		 * queries.
+		 * @param cuboids Query cuboids (may be out of bounds).
+		 * @param num_cuboids Number of query cuboids.
+		 * @param results Result arrays, one per query cuboid (not cleared).
+		 * @param pool Thread pool.
+		 * @see search( const DataCuboid*, std::size_t, DataArray* ) const
+		 */
+		void search( const DataCuboid* cuboids, std::size_t num_cuboids, DataArray* results, ThreadPool& pool ) const;
+
+		/** Search the tree for multiple cuboids in one traversal.
+		 * @param cuboids Query cuboids (may be out of bounds).
+		 * @param results Result arrays, resized to the number of queries (not cleared).
+		 * @see search( const DataCuboid*, std::size_t, DataArray* ) const
+		 */
+		void search( const std::vector<DataCuboid>& cuboids, std::vector<DataArray>& results ) const;
+
+		/** Count data in a specific cuboid.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @return Number of data intersecting the cuboid.
+		 */
+		std::size_t count( const DataCuboid& cuboid ) const;
+
+		/** Count data of this node and all its descendants.
+		 * @return Number of data.
+		 */
+		std::size_t count_all() const;
+
+		/** Collect shape and memory usage of this node and all its descendants.
+		 * Walks the whole subtree, meant for diagnostics rather than per frame use.
+		 * Per query counters are collected separately, see QueryCounters.
+		 * @return Stats.
+		 */
+		Stats collect_stats() const;
+
+		/** Search the tree for data inside a view frustum.
+		 * Each node's loose bounds are classified against the frustum. Subtrees
+		 * completely inside are accepted without further tests, subtrees outside
+		 * are skipped. Planes a node is completely in front of aren't tested again
+		 * for its children and data. Data near frustum corners may be reported
+		 * although outside (see Frustum::classify()).
+		 * @param frustum Frustum.
+		 * @param results Array for results (not cleared).
+		 */
+		void search_frustum( const Frustum<DVS>& frustum, DataArray& results ) const;
+
+		/** Search the tree for data inside a view frustum without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param frustum Frustum.
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 * @see search_frustum( const Frustum<DVS>&, DataArray& ) const
+		 */
+		template <class Visitor>
+		bool search_frustum( const Frustum<DVS>& frustum, Visitor&& visitor ) const;
+
+		/** Search the tree for data touching a sphere.
+		 * Nodes and data are tested by the exact distance between the sphere's
+		 * center and their (loose) boxes. Subtrees completely inside the sphere
+		 * are accepted without further tests.
+		 * @param center Center (may be out of bounds).
+		 * @param radius Radius.
+		 * @param results Array for results (not cleared).
+		 */
+		void search_sphere( const DataVector& center, DVS radius, DataArray& results ) const;
+
+		/** Search the tree for data touching a sphere without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param center Center (may be out of bounds).
+		 * @param radius Radius.
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 * @see search_sphere( const DataVector&, DVS, DataArray& ) const
+		 */
+		template <class Visitor>
+		bool search_sphere( const DataVector& center, DVS radius, Visitor&& visitor ) const;
+
+		/** Search the tree for data touching a capsule.
+		 * The capsule is the set of points within radius of the segment from
+		 * start to end. Nodes and data are tested by the exact distance between
+		 * the segment and their (loose) boxes (see
+		 * calc_squared_distance_segment_box()). Subtrees completely inside the
+		 * capsule are accepted without further tests.
+		 * @param start Start of segment (may be out of bounds).
+		 * @param end End of segment (may be out of bounds, may equal start).
+		 * @param radius Radius.
+		 * @param results Array for results (not cleared).
+		 */
+		void search_capsule( const DataVector& start, const DataVector& end, DVS radius, DataArray& results ) const;
+
+		/** Search the tree for data touching a capsule without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit. Returning false stops the search immediately.
+		 * @param start Start of segment (may be out of bounds).
+		 * @param end End of segment (may be out of bounds, may equal start).
+		 * @param radius Radius.
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 * @see search_capsule( const DataVector&, const DataVector&, DVS, DataArray& ) const
+		 */
+		template <class Visitor>
+		bool search_capsule( const DataVector& start, const DataVector& end, DVS radius, Visitor&& visitor ) const;
+
+		/** Find the nearest data hit by a ray.
+		 * Nodes are traversed front to back with slab tests against their loose
+		 * bounds, and nodes that can't contain a hit closer than the nearest one
+		 * found so far are skipped. Requires a floating point DVS.
+		 * @param origin Ray origin (may be out of bounds).
+		 * @param direction Ray direction (not zero). Distances are measured in units of its length.
+		 * @param max_distance Maximum distance.
+		 * @param hit Receives the nearest hit.
+		 * @return true if anything has been hit.
+		 */
+		bool raycast( const DataVector& origin, const DataVector& direction, DVS max_distance, RayHit& hit ) const;
+
+		/** Find all data hit by a ray.
+		 * @param origin Ray origin (may be out of bounds).
+		 * @param direction Ray direction (not zero). Distances are measured in units of its length.
+		 * @param max_distance Maximum distance.
+		 * @param hits Array for hits, the appended hits are sorted by distance (not cleared).
+		 * @see raycast( const DataVector&, const DataVector&, DVS, RayHit& ) const
+		 */
+		void raycast( const DataVector& origin, const DataVector& direction, DVS max_distance, std::vector<RayHit>& hits ) const;
+
+		/** Find the data nearest to a point.
+		 * Distances are measured between the point and the data's cuboid, 0 if
+		 * the point is inside. Nodes are visited best first by the distance to
+		 * their loose bounds. Once k data have been found, the search radius
+		 * shrinks to the distance of the farthest of them, and nodes and data
+		 * beyond it are skipped. Requires a floating point DVS.
+		 * @param point Point (may be out of bounds).
+		 * @param k Maximum number of data to find.
+		 * @param max_distance Maximum distance.
+		 * @param neighbours Array for results, the appended results are sorted by distance, ties in no particular order (not cleared).
+		 */
+		void nearest( const DataVector& point, std::size_t k, DVS max_distance, std::vector<Neighbour>& neighbours ) const;
+
+		/** Enumerate all pairs of overlapping data.
+		 * Overlaps use the same boundary rules as search(). Each pair is
+		 * reported exactly once, in no particular order. Data of a node is
+		 * paired with the data of the same node and of its descendants. As the
+		 * loose bounds of siblings overlap, pairs of sibling subtrees are found
+		 * by traversing both subtrees simultaneously, skipping node pairs whose
+		 * loose bounds don't overlap.
+		 *
+		 * The callback is called as bool callback( const T& first, const
+		 * DataCuboid& first_cuboid, const T& second, const DataCuboid&
+		 * second_cuboid ). Returning false stops immediately.
+		 * @param callback Callback.
+		 * @return false if the callback stopped the enumeration, true otherwise.
+		 */
+		template <class Callback>
+		bool for_each_overlapping_pair( Callback&& callback ) const;
+
+		/** Enumerate all pairs of overlapping data in parallel.
+		 * The upper levels of the tree are split into independent tasks (pairs
+		 * within a subtree, between two subtrees, or between a node's data and a
+		 * subtree), which are processed by the pool. The callback is called
+		 * concurrently and must be thread-safe. Returning false stops the task it
+		 * has been called from and prevents further tasks from starting, other
+		 * running tasks may still report pairs.
+		 * @param callback Callback.
+		 * @param pool Thread pool.
+		 * @return false if the callback stopped the enumeration, true otherwise.
+		 * @see for_each_overlapping_pair( Callback&& ) const
+		 */
+		template <class Callback>
+		bool for_each_overlapping_pair( Callback&& callback, ThreadPool& pool ) const;
+
+		/** Enumerate all pairs of overlapping data of this and another tree.
+		 * Both trees are traversed simultaneously, skipping node pairs whose
+		 * loose bounds don't overlap. The trees may differ in size, data type
+		 * and allocator. Roots are always at 0, 0, 0, so their positions match.
+		 *
+		 * The callback is called as bool callback( const T& data, const
+		 * DataCuboid& cuboid, const OtherT& other_data, const DataCuboid&
+		 * other_cuboid ). Returning false stops immediately.
+		 * @param other Other tree.
+		 * @param callback Callback.
+		 * @return false if the callback stopped the enumeration, true otherwise.
+		 */
+		template <class OtherT, class OtherAllocator, class Callback>
+		bool for_each_overlapping_pair( const LooseOctree<OtherT, DVS, OtherAllocator>& other, Callback&& callback ) const;
+
 		/** Erase all data occurences in a specific cuboid.
 		 * @param data Data.
 		 * @param cuboid Cuboid.
@@ -124,6 +545,12 @@ class LooseOctree {
 		 */
 		void erase( const T& data );
 
+		/** Erase data by handle.
+		 * The tree isn't traversed. If the handle is invalid, nothing happens.
+		 * @param handle Handle.
+		 */
+		void erase( const Handle& handle );
+
 		/** Deletes empty children.
 		 * Called internally.
 		 * @param recursive If cleaning up, proceed at parent.
@@ -131,27 +558,232 @@ class LooseOctree {
 		void cleanup( bool recursive );
 
 	private:
-		struct DataInfo {
-			DataInfo();
+		template <class, class, class>
+		friend class LooseOctree;
 
-			T data;
-			DataCuboid cuboid;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<T> PayloadAllocator;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<DVS> ComponentAllocator;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<uint32_t> SlotIndexAllocator;
+
+		/** Contiguous data storage of a node.
+		 * The six cuboid components are stored as separate arrays in a single
+		 * buffer, next to parallel payload and slot arrays. Entries are removed by
+		 * swapping them with the last entry.
+		 */
+		struct DataBlock {
+			enum Component {
+				X = 0,
+				Y,
+				Z,
+				WIDTH,
+				HEIGHT,
+				DEPTH,
+				NUM_COMPONENTS
+			};
+
+			DataBlock( const Allocator& allocator );
+
+			std::size_t size() const;
+			const DVS* get_component( Component component ) const;
+			DataCuboid get_cuboid( std::size_t index ) const;
+
+			void set_cuboid( std::size_t index, const DataCuboid& cuboid );
+			void reserve( std::size_t new_capacity );
+			void push_back( const T& data, const DataCuboid& cuboid, uint32_t slot );
+			void swap_and_pop( std::size_t index );
+			void clear();
+
+			std::vector<DVS, ComponentAllocator> components;
+			std::vector<T, PayloadAllocator> payload;
+			std::vector<uint32_t, SlotIndexAllocator> slots;
+			std::size_t capacity;
 		};
 
-		typedef std::list<DataInfo> DataList;
+		struct Children {
+			LooseOctree* nodes[8];
+		};
 
-		LooseOctree( const Vector& position, Size size, LooseOctree<T, DVS>* parent = nullptr );
+		struct DataAppender {
+			bool operator()( const T& data, const DataCuboid& cuboid ) const;
+
+			DataArray& results;
+		};
+
+		/** Per-depth lists of query indices used by batched searches.
+		 */
+		struct BatchScratch {
+			std::vector<std::vector<uint32_t>> active;
+			std::vector<std::vector<uint32_t>> pending;
+		};
+
+		/** Item of bulk loading: location code of the target node and index into
+		 * the input range.
+		 */
+		struct BuildItem {
+			bool operator<( const BuildItem& other ) const;
+
+			uint64_t code;
+			uint32_t index;
+			uint32_t slot;
+		};
+
+		/** Candidate of nearest(). Data is only copied for the final results.
+		 */
+		struct NeighbourCandidate {
+			bool operator<( const NeighbourCandidate& other ) const;
+
+			DVS squared_distance;
+			const LooseOctree* node;
+			std::size_t data_idx;
+		};
+
+		/** Independent part of for_each_overlapping_pair().
+		 */
+		struct PairTask {
+			enum Type {
+				WITHIN_SUBTREE = 0, ///< Pairs within first's subtree.
+				OWN_DATA, ///< Pairs within first's data.
+				DATA_WITH_SUBTREE, ///< Pairs of first's data and second's subtree.
+				BETWEEN_SUBTREES ///< Pairs of first's and second's subtrees.
+			};
+
+			Type type;
+			const LooseOctree* first;
+			const LooseOctree* second;
+		};
+
+		/** Ray with precomputed inverse direction for slab tests.
+		 */
+		struct Ray {
+			Ray( const DataVector& origin_, const DataVector& direction_ );
+
+			DataVector origin;
+			DataVector direction;
+			DataVector inv_direction;
+		};
+
+		/** Sphere query shape, see search_shape().
+		 */
+		struct Sphere {
+			bool touches( const DataVector& box_min, const DataVector& box_max ) const;
+			bool contains( const DataVector& box_min, const DataVector& box_max ) const;
+
+			DataVector center;
+			DVS squared_radius;
+		};
+
+		/** Capsule query shape, see search_shape().
+		 */
+		struct Capsule {
+			bool touches( const DataVector& box_min, const DataVector& box_max ) const;
+			bool contains( const DataVector& box_min, const DataVector& box_max ) const;
+
+			DataVector start;
+			DataVector end;
+			DVS squared_radius;
+		};
+
+		struct Slot {
+			LooseOctree* node; ///< Node holding the data, nullptr if free.
+			uint32_t index; ///< Data index if used, next free slot if free.
+			uint32_t generation;
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Slot> SlotAllocator;
+
+		struct Shared {
+			typedef std::vector<Slot, SlotAllocator> SlotArray;
+
+			Shared( const Allocator& allocator_ );
+			~Shared();
+
+			Allocator allocator;
+			ObjectPool<LooseOctree, Allocator> node_pool;
+			ObjectPool<Children, Allocator> children_pool;
+			ObjectPool<DataBlock, Allocator> data_pool;
+			std::vector<DataBlock*> spare_data;
+			SlotArray slots;
+			uint32_t free_slot;
+			ChangeJournal<T, DVS>* journal;
+		};
+
+		LooseOctree( const Vector& position, Size size, LooseOctree* parent );
+		LooseOctree( const LooseOctree& ) = delete;
+		LooseOctree& operator=( const LooseOctree& ) = delete;
 
 		Quadrant determine_quadrant( const DataCuboid& cuboid );
+		uint64_t calc_location_code( const DataCuboid& cuboid ) const;
+		LooseOctree& get_or_create_child( Quadrant quadrant );
+		void copy_node( const LooseOctree& other );
+		void copy_node( const FrozenLooseOctree<T, DVS>& frozen, const FrozenOctreeNode& node );
+		void clear_nodes();
+		uint32_t flatten( std::vector<FrozenOctreeNode>& nodes, std::vector<const LooseOctree*>& sources, uint32_t& num_data ) const;
+
+		template <class Iterator>
+		void bulk_insert( Iterator begin, Iterator end, ThreadPool* pool, Handle* handles );
+		bool holds_loosely( const DataCuboid& cuboid ) const;
+		bool accepts( const DataCuboid& cuboid ) const;
+		bool is_loosely_inside( const DataCuboid& cuboid ) const;
+
+		void search_batch(
+			const DataCuboid* cuboids,
+			DataArray* results,
+			BatchScratch& scratch,
+			std::size_t depth
+		) const;
+
+		template <class Visitor>
+		bool search_frustum( const Frustum<DVS>& frustum, uint32_t plane_mask, Visitor& visitor ) const;
+
+		template <class Shape, class Visitor>
+		bool search_shape( const Shape& shape, Visitor& visitor ) const;
+
+		void collect_pair_tasks( std::vector<PairTask>& tasks, std::size_t depth ) const;
+
+		template <class Callback>
+		bool run_pair_task( const PairTask& task, Callback& callback ) const;
+
+		template <class Callback>
+		bool pair_within_subtree( Callback& callback ) const;
+
+		template <class Callback>
+		bool pair_own_data( Callback& callback ) const;
+
+		template <class OtherT, class OtherAllocator, class Callback>
+		bool pair_data_with_subtree( const LooseOctree<OtherT, DVS, OtherAllocator>& other, Callback& callback ) const;
+
+		template <class OtherT, class OtherAllocator, class Callback>
+		bool pair_between_subtrees( const LooseOctree<OtherT, DVS, OtherAllocator>& other, Callback& callback ) const;
+
+		void raycast_nearest( const Ray& ray, DVS& max_distance, RayHit& hit, bool& found ) const;
+		void raycast_all( const Ray& ray, DVS max_distance, std::vector<RayHit>& hits ) const;
+		std::size_t sort_children_along_ray( const Ray& ray, DVS max_distance, std::pair<DVS, const LooseOctree*>* children ) const;
+
+		void add_stats( Stats& stats, std::size_t depth ) const;
+
+		template <class Visitor>
+		bool visit_all( Visitor& visitor ) const;
+		bool visit_all( DataAppender& appender ) const;
+		LooseOctree& find_node( const DataCuboid& cuboid );
+		uint32_t acquire_slot();
+		void release_slot( uint32_t slot );
+		void add_data( const T& data, const DataCuboid& cuboid, uint32_t slot );
+		void remove_data( std::size_t data_idx, bool keep_slot = false );
 		void ensure_data();
+		void release_data();
 		void subdivide();
 		void create_child( Quadrant quadrant );
+		void destroy_child( std::size_t child_idx );
+		void init_loose_bounds();
 
 		Vector m_position;
+		DataVector m_loose_min;
+		DataVector m_loose_max;
 
-		DataList* m_data;
+		DataBlock* m_data;
 		LooseOctree* m_parent;
-		LooseOctree** m_children;
+		Children* m_children;
+		Shared* m_shared;
 
 		Size m_size;
 };
@@ -1,484 +1,2302 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace util {
 
-template <class T, class DVS>
-inline void continue_search(
-	const LooseOctree<T, DVS>* child,
-	const typename LooseOctree<T, DVS>::DataCuboid& cuboid,
-	typename LooseOctree<T, DVS>::DataArray& results
-) {
-	if( !child ) {
-		return;
+template <class DVS>
+inline bool intersects_axis( DVS first_min, DVS first_size, DVS second_min, DVS second_size ) {
+	// Same boundary semantics as Cuboid::calc_intersection().
+	return std::max( first_min, second_min ) < std::min( first_min + first_size, second_min + second_size );
+}
+
+template <class DVS>
+inline bool clip_ray_slab( DVS origin, DVS direction, DVS inv_direction, DVS slab_min, DVS slab_max, DVS& t_near, DVS& t_far ) {
+	// Parallel to the slab, either always or never inside.
+	if( direction == DVS( 0 ) ) {
+		return origin >= slab_min && origin <= slab_max;
+	}
+
+	DVS t_min = (slab_min - origin) * inv_direction;
+	DVS t_max = (slab_max - origin) * inv_direction;
+
+	if( t_min > t_max ) {
+		std::swap( t_min, t_max );
 	}
 
+	t_near = std::max( t_near, t_min );
+	t_far = std::min( t_far, t_max );
+
+	return t_near <= t_far;
+}
+
+template <class DVS>
+inline bool intersect_ray_box(
+	const sf::Vector3<DVS>& origin,
+	const sf::Vector3<DVS>& direction,
+	const sf::Vector3<DVS>& inv_direction,
+	const sf::Vector3<DVS>& box_min,
+	const sf::Vector3<DVS>& box_max,
+	DVS max_distance,
+	DVS& distance
+) {
+	DVS t_near = DVS( 0 );
+	DVS t_far = max_distance;
+
 	if(
-		LooseOctree<T, DVS>::DataCuboid::calc_intersection(
-			typename LooseOctree<T, DVS>::DataCuboid(
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().x ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().y ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().z ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 ),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 ),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 )
-			),
-			cuboid
-		).width > 0
+		!clip_ray_slab( origin.x, direction.x, inv_direction.x, box_min.x, box_max.x, t_near, t_far ) ||
+		!clip_ray_slab( origin.y, direction.y, inv_direction.y, box_min.y, box_max.y, t_near, t_far ) ||
+		!clip_ray_slab( origin.z, direction.z, inv_direction.z, box_min.z, box_max.z, t_near, t_far )
 	) {
-		child->search( cuboid, results );
+		return false;
+	}
+
+	distance = t_near;
+	return true;
+}
+
+template <class T, class DVS, class A, class Visitor>
+inline bool continue_search(
+	const LooseOctree<T, DVS, A>* child,
+	const typename LooseOctree<T, DVS, A>::DataCuboid& cuboid,
+	Visitor& visitor
+) {
+	if( !child || !child->overlaps_loosely( cuboid ) ) {
+		return true;
 	}
+
+	return child->search( cuboid, visitor );
 }
 
-template <class T, class DVS>
+template <class T, class DVS, class A>
 inline void continue_erase(
-	LooseOctree<T, DVS>* child,
+	LooseOctree<T, DVS, A>* child,
 	const T& data,
-	const typename LooseOctree<T, DVS>::DataCuboid& cuboid
+	const typename LooseOctree<T, DVS, A>::DataCuboid& cuboid
 ) {
-	if( !child ) {
+	if( !child || !child->overlaps_loosely( cuboid ) ) {
 		return;
 	}
 
-	if(
-		LooseOctree<T, DVS>::DataCuboid::calc_intersection(
-			typename LooseOctree<T, DVS>::DataCuboid(
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().x ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().y ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				(
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_position().z ) -
-					static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() / 2 )
-				),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 ),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 ),
-				static_cast<typename LooseOctree<T, DVS>::DataCuboid::Type>( child->get_size() * 2 )
-			),
-			cuboid
-		).width > 0
-	) {
-		child->erase( data, cuboid );
+	child->erase( data, cuboid );
+}
+
+inline uint32_t calc_location_quadrant( uint64_t code ) {
+	// Morton bits are x, y, z, quadrants are ordered by x, z, -y.
+	return static_cast<uint32_t>( (code & 1) | ((code >> 1) & 2) | ((~code << 1) & 4) );
+}
+
+template <class Item>
+void sort_parallel( std::vector<Item>& items, ThreadPool& pool ) {
+	std::size_t num_items = items.size();
+	std::size_t num_chunks = pool.get_num_threads() * 2;
+	std::size_t chunk_size = std::max( (num_items + num_chunks - 1) / num_chunks, static_cast<std::size_t>( 1 ) );
+
+	pool.parallel_for(
+		0,
+		num_items,
+		chunk_size,
+		[&items]( std::size_t begin, std::size_t end ) {
+			std::sort(
+				items.begin() + static_cast<std::ptrdiff_t>( begin ),
+				items.begin() + static_cast<std::ptrdiff_t>( end )
+			);
+		}
+	);
+
+	// Merge neighbouring sorted runs until a single run is left.
+	for( std::size_t run_size = chunk_size; run_size < num_items; run_size *= 2 ) {
+		std::size_t num_pairs = (num_items + 2 * run_size - 1) / (2 * run_size);
+
+		pool.parallel_for(
+			0,
+			num_pairs,
+			1,
+			[&items, run_size, num_items]( std::size_t begin, std::size_t end ) {
+				for( std::size_t pair_idx = begin; pair_idx < end; ++pair_idx ) {
+					std::size_t first = pair_idx * 2 * run_size;
+					std::size_t middle = std::min( first + run_size, num_items );
+					std::size_t last = std::min( first + 2 * run_size, num_items );
+
+					std::inplace_merge(
+						items.begin() + static_cast<std::ptrdiff_t>( first ),
+						items.begin() + static_cast<std::ptrdiff_t>( middle ),
+						items.begin() + static_cast<std::ptrdiff_t>( last )
+					);
+				}
+			}
+		);
 	}
 }
 
-template <class T, class DVS>
-LooseOctree<T, DVS>::LooseOctree( Size size ) :
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::LooseOctree( Size size, const A& allocator ) :
 	m_position( 0, 0, 0 ),
 	m_data( nullptr ),
 	m_parent( nullptr ),
 	m_children( nullptr ),
+	m_shared( new Shared( allocator ) ),
 	m_size( size )
 {
+	init_loose_bounds();
 }
 
-template <class T, class DVS>
-LooseOctree<T, DVS>::LooseOctree( const Vector& position, Size size, LooseOctree<T, DVS>* parent ) :
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::LooseOctree( const Vector& position, Size size, LooseOctree<T, DVS, A>* parent ) :
 	m_position( position ),
 	m_data( nullptr ),
 	m_parent( parent ),
 	m_children( nullptr ),
+	m_shared( parent->m_shared ),
 	m_size( size )
 {
+	init_loose_bounds();
 }
 
-template <class T, class DVS>
-LooseOctree<T, DVS>::~LooseOctree() {
-	delete m_data;
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::init_loose_bounds() {
+	DVS size = static_cast<DVS>( m_size );
+
+	m_loose_min.x = static_cast<DVS>( m_position.x ) - size / DVS( 2 );
+	m_loose_min.y = static_cast<DVS>( m_position.y ) - size / DVS( 2 );
+	m_loose_min.z = static_cast<DVS>( m_position.z ) - size / DVS( 2 );
+
+	m_loose_max.x = m_loose_min.x + size * DVS( 2 );
+	m_loose_max.y = m_loose_min.y + size * DVS( 2 );
+	m_loose_max.z = m_loose_min.z + size * DVS( 2 );
+}
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::~LooseOctree() {
+	release_data();
 
 	if( m_children ) {
 		for( std::size_t child_idx = 0; child_idx < 8; ++child_idx ) {
-			delete m_children[child_idx];
+			destroy_child( child_idx );
 		}
+
+		m_shared->children_pool.destroy( m_children );
 	}
 
-	delete[] m_children;
+	// The root node owns the pools.
+	if( !m_parent ) {
+		delete m_shared;
+	}
 }
 
-template <class T, class DVS>
-typename LooseOctree<T, DVS>::Size LooseOctree<T, DVS>::get_size() const {
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::Size LooseOctree<T, DVS, A>::get_size() const {
 	return m_size;
 }
 
-template <class T, class DVS>
-const typename LooseOctree<T, DVS>::Vector& LooseOctree<T, DVS>::get_position() const {
+template <class T, class DVS, class A>
+const typename LooseOctree<T, DVS, A>::Vector& LooseOctree<T, DVS, A>::get_position() const {
 	return m_position;
 }
 
-template <class T, class DVS>
-bool LooseOctree<T, DVS>::is_subdivided() const {
-	return m_children != nullptr;
-}
-
-template <class T, class DVS>
-std::size_t LooseOctree<T, DVS>::get_num_data() const {
-	return m_data != nullptr ? m_data->size() : 0;
+template <class T, class DVS, class A>
+const typename LooseOctree<T, DVS, A>::DataVector& LooseOctree<T, DVS, A>::get_loose_min() const {
+	return m_loose_min;
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::ensure_data() {
-	if( !m_data ) {
-		m_data = new DataList;
-	}
+template <class T, class DVS, class A>
+const typename LooseOctree<T, DVS, A>::DataVector& LooseOctree<T, DVS, A>::get_loose_max() const {
+	return m_loose_max;
 }
 
-template <class T, class DVS>
-LooseOctree<T, DVS>& LooseOctree<T, DVS>::insert( const T& data, const DataCuboid& cuboid ) {
-#if !defined( NDEBUG )
-	FloatCuboid node_cuboid(
-		static_cast<float>( m_position.x ) - (static_cast<float>( m_size ) / 2.0f),
-		static_cast<float>( m_position.y ) - (static_cast<float>( m_size ) / 2.0f),
-		static_cast<float>( m_position.z ) - (static_cast<float>( m_size ) / 2.0f),
-		static_cast<float>( m_position.x ) + (static_cast<float>( m_size ) * 2.0f),
-		static_cast<float>( m_position.y ) + (static_cast<float>( m_size ) * 2.0f),
-		static_cast<float>( m_position.z ) + (static_cast<float>( m_size ) * 2.0f)
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::overlaps_loosely( const DataCuboid& cuboid ) const {
+	return (
+		std::max( m_loose_min.x, cuboid.x ) < std::min( m_loose_max.x, cuboid.x + cuboid.width ) &&
+		std::max( m_loose_min.y, cuboid.y ) < std::min( m_loose_max.y, cuboid.y + cuboid.height ) &&
+		std::max( m_loose_min.z, cuboid.z ) < std::min( m_loose_max.z, cuboid.z + cuboid.depth )
 	);
+}
 
-	assert( cuboid.width <= m_size );
-	assert( cuboid.height <= m_size );
-	assert( cuboid.depth <= m_size );
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::is_subdivided() const {
+	return m_children != nullptr;
+}
 
-	assert( cuboid.x >= node_cuboid.x );
-	assert( cuboid.y >= node_cuboid.y );
-	assert( cuboid.z >= node_cuboid.z );
+template <class T, class DVS, class A>
+std::size_t LooseOctree<T, DVS, A>::get_num_data() const {
+	return m_data != nullptr ? m_data->size() : 0;
+}
 
-	assert( cuboid.x + cuboid.width <= node_cuboid.x + node_cuboid.width );
-	assert( cuboid.y + cuboid.height <= node_cuboid.y + node_cuboid.height );
-	assert( cuboid.z + cuboid.depth <= node_cuboid.z + node_cuboid.depth );
-#endif
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::ensure_data() {
+	if( m_data ) {
+		return;
+	}
 
-	// Determine which quadrant the data belongs to.
-	Quadrant quadrant = determine_quadrant( cuboid );
-	assert( quadrant != INVALID_QUADRANT );
+	// Prefer recycled blocks, they have already allocated their buffers.
+	if( !m_shared->spare_data.empty() ) {
+		m_data = m_shared->spare_data.back();
+		m_shared->spare_data.pop_back();
+	}
+	else {
+		m_data = m_shared->data_pool.create( m_shared->allocator );
+	}
+}
 
-	// If same quadrant, just add data to list.
-	if( quadrant == SAME_QUADRANT ) {
-		ensure_data();
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::release_data() {
+	if( !m_data ) {
+		return;
+	}
 
-		// Push back first so data doesn't get copied 2 times.
-		m_data->push_back( DataInfo() );
+	m_data->clear();
+	m_shared->spare_data.push_back( m_data );
+	m_data = nullptr;
+}
 
-		m_data->back().cuboid = cuboid;
-		m_data->back().data = data;
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::Handle LooseOctree<T, DVS, A>::insert( const T& data, const DataCuboid& cuboid ) {
+	// Empty cuboids never intersect anything, which the containment shortcut in
+	// search() relies on.
+	assert( cuboid.width > 0 && cuboid.height > 0 && cuboid.depth > 0 );
 
-		return *this;
-	}
+	uint32_t slot = acquire_slot();
+	find_node( cuboid ).add_data( data, cuboid, slot );
 
-	// Subdivide if needed.
-	if( !is_subdivided() ) {
-		subdivide();
-	}
+	Handle handle;
+	handle.index = slot;
+	handle.generation = m_shared->slots[slot].generation;
 
-	// Create child node if needed.
-	if( m_children[quadrant] == nullptr ) {
-		create_child( quadrant );
+	if( m_shared->journal ) {
+		m_shared->journal->record_insert( handle, data, cuboid );
 	}
 
-	// Insert data at child.
-	return m_children[quadrant]->insert( data, cuboid );
+	return handle;
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::subdivide() {
-	assert( !is_subdivided() );
-	assert( m_size > 1 );
+template <class T, class DVS, class A>
+template <class Iterator>
+void LooseOctree<T, DVS, A>::build( Iterator begin, Iterator end, Handle* handles ) {
+	bulk_insert( begin, end, nullptr, handles );
+}
 
-	m_children = new LooseOctree<T, DVS>*[8];
-	std::memset( m_children, 0, 8 * sizeof( LooseOctree<T, DVS>* ) );
+template <class T, class DVS, class A>
+template <class Iterator>
+void LooseOctree<T, DVS, A>::build( Iterator begin, Iterator end, ThreadPool& pool, Handle* handles ) {
+	bulk_insert( begin, end, &pool, handles );
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::create_child( Quadrant quadrant ) {
-	assert( quadrant < SAME_QUADRANT );
-	assert( is_subdivided() );
-	assert( m_size > 1 );
-	assert( m_children[quadrant] == nullptr );
+template <class T, class DVS, class A>
+template <class Iterator>
+void LooseOctree<T, DVS, A>::bulk_insert( Iterator begin, Iterator end, ThreadPool* pool, Handle* handles ) {
+	assert( end - begin >= 0 );
+	std::size_t num_items = static_cast<std::size_t>( end - begin );
 
-	Vector position = m_position;
-	Size size = m_size / 2;
+	// Location codes of deeper trees don't fit into 64 bits.
+	if( m_size > (static_cast<Size>( 1 ) << MORTON_BITS) ) {
+		for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+			Handle handle = insert( begin[item_idx].first, begin[item_idx].second );
 
-	switch( quadrant ) {
-		case LEFT_BOTTOM_FAR:
-			break;
+			if( handles ) {
+				handles[item_idx] = handle;
+			}
+		}
 
-		case RIGHT_BOTTOM_FAR:
-			position.x += size;
-			break;
+		return;
+	}
 
-		case LEFT_BOTTOM_NEAR:
-			position.z += size;
-			break;
+	assert( num_items < std::numeric_limits<uint32_t>::max() );
 
-		case RIGHT_BOTTOM_NEAR:
-			position.x += size;
-			position.z += size;
-			break;
+	// Slots are acquired in range order, so handles match those of insert().
+	std::vector<BuildItem> items( num_items );
 
-		case LEFT_TOP_FAR:
-			position.y += size;
-			break;
+	for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+		Handle handle;
 
-		case RIGHT_TOP_FAR:
-			position.x += size;
-			position.y += size;
-			break;
+		items[item_idx].index = static_cast<uint32_t>( item_idx );
+		items[item_idx].slot = acquire_slot();
 
-		case LEFT_TOP_NEAR:
-			position.z += size;
-			position.y += size;
-			break;
+		handle.index = items[item_idx].slot;
+		handle.generation = m_shared->slots[items[item_idx].slot].generation;
 
-		case RIGHT_TOP_NEAR:
-			position.x += size;
-			position.y += size;
-			position.z += size;
-			break;
+		if( handles ) {
+			handles[item_idx] = handle;
+		}
 
-		default:
-			assert( 0 && "Invalid quadrant." );
-			break;
+		if( m_shared->journal ) {
+			m_shared->journal->record_insert( handle, begin[item_idx].first, begin[item_idx].second );
+		}
 	}
 
-	m_children[quadrant] = new LooseOctree<T, DVS>( position, size, this );
-}
+	ThreadPool::RangeFunction calc_codes = [this, &items, begin]( std::size_t first, std::size_t last ) {
+		for( std::size_t item_idx = first; item_idx < last; ++item_idx ) {
+			items[item_idx].code = calc_location_code( begin[item_idx].second );
+		}
+	};
 
-template <class T, class DVS>
-typename LooseOctree<T, DVS>::Quadrant LooseOctree<T, DVS>::determine_quadrant( const DataCuboid& cuboid ) {
-	assert( cuboid.width <= m_size );
-	assert( cuboid.height <= m_size );
-	assert( cuboid.depth <= m_size );
+	if( pool ) {
+		pool->parallel_for( 0, num_items, 0, calc_codes );
+		sort_parallel( items, *pool );
+	}
+	else {
+		calc_codes( 0, num_items );
+		std::sort( items.begin(), items.end() );
+	}
 
-	// Calculate center point.
-	DataVector center(
-		cuboid.x + cuboid.width / 2,
-		cuboid.y + cuboid.height / 2,
-		cuboid.z + cuboid.depth / 2
-	);
+	// Collect the node codes per level: nodes holding data, then bottom-up all
+	// their ancestors.
+	std::vector<std::vector<uint64_t>> levels( 1 );
 
-	assert( center.x >= m_position.x );
-	assert( center.y >= m_position.y );
-	assert( center.z >= m_position.z );
-	assert( center.x <= m_position.x + m_size );
-	assert( center.y <= m_position.y + m_size );
-	assert( center.z <= m_position.z + m_size );
+	for( std::size_t item_idx = 0; item_idx < num_items; ++item_idx ) {
+		uint64_t code = items[item_idx].code;
+		uint32_t depth = calc_location_depth( code );
 
-	// If size is higher than half of any dimension, it belongs to the same node.
-	if(
-		cuboid.width > m_size / 2 ||
-		cuboid.height > m_size / 2 ||
-		cuboid.depth > m_size / 2
-	) {
-		return SAME_QUADRANT;
+		if( depth >= levels.size() ) {
+			levels.resize( depth + 1 );
+		}
+
+		if( levels[depth].empty() || levels[depth].back() != code ) {
+			levels[depth].push_back( code );
+		}
 	}
 
-	Size half_x = m_position.x + m_size / 2;
-	Size half_y = m_position.y + m_size / 2;
-	Size half_z = m_position.z + m_size / 2;
+	std::vector<uint64_t> parents;
+	std::vector<uint64_t> merged;
 
-	if( center.x < half_x ) { // Left quadrants.
-		if( center.y < half_y ) { // Bottom quadrants.
-			if( center.z < half_z ) { // Far quadrants.
-				return LEFT_BOTTOM_FAR;
-			}
-			else { // Near quadrants.
-				return LEFT_BOTTOM_NEAR;
-			}
-		}
-		else { // Top quadrants.
-			if( center.z < half_z ) { // Far quadrants.
-				return LEFT_TOP_FAR;
-			}
-			else { // Near quadrants.
-				return LEFT_TOP_NEAR;
+	for( std::size_t depth = levels.size() - 1; depth > 0; --depth ) {
+		parents.clear();
+
+		for( std::size_t node_idx = 0; node_idx < levels[depth].size(); ++node_idx ) {
+			uint64_t parent = levels[depth][node_idx] >> 3;
+
+			if( parents.empty() || parents.back() != parent ) {
+				parents.push_back( parent );
 			}
 		}
+
+		merged.clear();
+		std::set_union(
+			levels[depth - 1].begin(), levels[depth - 1].end(),
+			parents.begin(), parents.end(),
+			std::back_inserter( merged )
+		);
+		levels[depth - 1].swap( merged );
 	}
-	else { // Right quadrants.
-		if( center.y < half_y ) { // Bottom quadrants.
-			if( center.z < half_z ) { // Far quadrants.
-				return RIGHT_BOTTOM_FAR;
-			}
-			else { // Near quadrants.
-				return RIGHT_BOTTOM_NEAR;
-			}
-		}
-		else { // Top quadrants.
-			if( center.z < half_z ) { // Far quadrants.
-				return RIGHT_TOP_FAR;
-			}
-			else { // Near quadrants.
-				return RIGHT_TOP_NEAR;
+
+	// Create the nodes top-down, each one only once. Codes ascend over all
+	// levels, so the nodes array is sorted by code, too.
+	std::vector<std::pair<uint64_t, LooseOctree<T, DVS, A>*>> nodes;
+	std::size_t level_begin = 0;
+
+	nodes.push_back( std::make_pair( static_cast<uint64_t>( 1 ), this ) );
+
+	for( std::size_t depth = 1; depth < levels.size(); ++depth ) {
+		std::size_t parent_idx = level_begin;
+		level_begin = nodes.size();
+
+		for( std::size_t node_idx = 0; node_idx < levels[depth].size(); ++node_idx ) {
+			uint64_t code = levels[depth][node_idx];
+
+			while( nodes[parent_idx].first != code >> 3 ) {
+				++parent_idx;
 			}
+
+			Quadrant quadrant = static_cast<Quadrant>( calc_location_quadrant( code ) );
+
+			nodes.push_back( std::make_pair( code, &nodes[parent_idx].second->get_or_create_child( quadrant ) ) );
 		}
 	}
 
-	return INVALID_QUADRANT;
-}
+	// Reserve storage per target node, then fill.
+	struct Range {
+		LooseOctree<T, DVS, A>* node;
+		std::size_t begin;
+		std::size_t end;
+	};
 
-template <class T, class DVS>
-bool LooseOctree<T, DVS>::has_child( Quadrant quadrant ) const {
-	assert( quadrant < SAME_QUADRANT );
+	std::vector<Range> ranges;
+	std::size_t node_idx = 0;
 
-	if( !is_subdivided() ) {
-		return false;
-	}
+	for( std::size_t item_idx = 0; item_idx < num_items; ) {
+		uint64_t code = items[item_idx].code;
+		Range range;
 
-	return m_children[quadrant] != nullptr;
-}
+		while( nodes[node_idx].first != code ) {
+			++node_idx;
+		}
 
-template <class T, class DVS>
-LooseOctree<T, DVS>& LooseOctree<T, DVS>::get_child( Quadrant quadrant ) const {
-	assert( quadrant < SAME_QUADRANT );
-	assert( has_child( quadrant ) );
+		range.node = nodes[node_idx].second;
+		range.begin = item_idx;
 
-	return *m_children[quadrant];
-}
+		while( item_idx < num_items && items[item_idx].code == code ) {
+			++item_idx;
+		}
 
-template <class T, class DVS>
-typename LooseOctree<T, DVS>::DataArray LooseOctree<T, DVS>::get_data() const {
-	if( !m_data ) {
-		return DataArray();
-	}
+		range.end = item_idx;
 
-	DataArray data;
+		range.node->ensure_data();
+		range.node->m_data->reserve( range.node->m_data->size() + range.end - range.begin );
 
-	typename DataList::const_iterator data_iter( m_data->begin() );
-	typename DataList::const_iterator data_iter_end( m_data->end() );
-	
-	for( ; data_iter != data_iter_end; ++data_iter ) {
-		data.push_back( data_iter->data );
+		ranges.push_back( range );
 	}
 
-	return data;
-}
-
-template <class T, class DVS>
-void LooseOctree<T, DVS>::search( const DataCuboid& cuboid, DataArray& results ) const {
-	// No checks for cuboid needed here, as we're testing for intersections anyways.
-
-	// If this node contains data, check for collision.
-	if( m_data && m_data->size() > 0 ) {
-		typename DataList::const_iterator data_iter( (*m_data).begin() );
-		typename DataList::const_iterator data_iter_end( (*m_data).end() );
-		
-		// Check each data entry for collision with the cuboid.
-		for( ; data_iter != data_iter_end; ++data_iter ) {
-			const DataInfo& info = *data_iter;
-			DataCuboid intersection = DataCuboid::calc_intersection( info.cuboid, cuboid );
+	// Ranges write to distinct nodes and slots only.
+	ThreadPool::RangeFunction fill = [&ranges, &items, begin]( std::size_t first, std::size_t last ) {
+		for( std::size_t range_idx = first; range_idx < last; ++range_idx ) {
+			const Range& range = ranges[range_idx];
 
-			if(
-				intersection.width > 0 &&
-				intersection.height > 0 &&
-				intersection.depth > 0
-			) {
-				results.push_back( info.data );
+			for( std::size_t item_idx = range.begin; item_idx < range.end; ++item_idx ) {
+				const BuildItem& item = items[item_idx];
+				range.node->add_data( begin[item.index].first, begin[item.index].second, item.slot );
 			}
 		}
-	}
+	};
 
-	// Find out which children the cuboid intersects with. Continue searching for
-	// data in those nodes.
-	if( !m_children ) {
-		// No children, nothing to do.
-		return;
+	if( pool ) {
+		pool->parallel_for( 0, ranges.size(), 0, fill );
+	}
+	else {
+		fill( 0, ranges.size() );
 	}
-
-	continue_search( m_children[LEFT_BOTTOM_FAR], cuboid, results );
-	continue_search( m_children[RIGHT_BOTTOM_FAR], cuboid, results );
-	continue_search( m_children[LEFT_BOTTOM_NEAR], cuboid, results );
-	continue_search( m_children[RIGHT_BOTTOM_NEAR], cuboid, results );
-	continue_search( m_children[LEFT_TOP_FAR], cuboid, results );
-	continue_search( m_children[RIGHT_TOP_FAR], cuboid, results );
-	continue_search( m_children[LEFT_TOP_NEAR], cuboid, results );
-	continue_search( m_children[RIGHT_TOP_NEAR], cuboid, results );
 }
 
-///// DataInfo //////
+template <class T, class DVS, class A>
+uint64_t LooseOctree<T, DVS, A>::calc_location_code( const DataCuboid& cuboid ) const {
+	// Same placement as determine_quadrant() applied level by level.
+	assert( cuboid.width > 0 && cuboid.height > 0 && cuboid.depth > 0 );
+	assert( holds_loosely( cuboid ) );
 
-template <class T, class DVS>
-LooseOctree<T, DVS>::DataInfo::DataInfo() :
-	cuboid( 0, 0, 0, 0, 0, 0 )
-{
+	return util::calc_location_code( cuboid, m_position, m_size );
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::erase( const T& data, const DataCuboid& cuboid ) {
-	// Traverse to children at first.
-	if( m_children ) {
-		continue_erase( m_children[LEFT_BOTTOM_FAR], data, cuboid );
-		continue_erase( m_children[RIGHT_BOTTOM_FAR], data, cuboid );
-		continue_erase( m_children[LEFT_BOTTOM_NEAR], data, cuboid );
-		continue_erase( m_children[RIGHT_BOTTOM_NEAR], data, cuboid );
-		continue_erase( m_children[LEFT_TOP_FAR], data, cuboid );
-		continue_erase( m_children[RIGHT_TOP_FAR], data, cuboid );
-		continue_erase( m_children[LEFT_TOP_NEAR], data, cuboid );
-		continue_erase( m_children[RIGHT_TOP_NEAR], data, cuboid );
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>& LooseOctree<T, DVS, A>::get_or_create_child( Quadrant quadrant ) {
+	if( !is_subdivided() ) {
+		subdivide();
 	}
 
-	// If this node contains data, check for collision.
-	if( m_data && m_data->size() > 0 ) {
-		typename DataList::iterator data_iter( m_data->begin() );
-		
-		// Check each data entry for collision with the cuboid.
-		while( data_iter != m_data->end() ) {
-			const DataInfo& info = *data_iter;
-			DataCuboid intersection = DataCuboid::calc_intersection( info.cuboid, cuboid );
-
-			if(
-				intersection.width > 0 &&
-				intersection.height > 0 &&
-				intersection.depth > 0 &&
-				info.data == data
-			) {
-				// Hit, erase.
-				data_iter = m_data->erase( data_iter );
-			}
-			else {
-				++data_iter;
-			}
-		}
+	if( m_children->nodes[quadrant] == nullptr ) {
+		create_child( quadrant );
 	}
 
-	cleanup( false );
+	return *m_children->nodes[quadrant];
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::erase( const T& data ) {
-	if( !m_data || m_data->size() < 1 ) {
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::assign( const LooseOctree<T, DVS, A>& other ) {
+	assert( !m_parent && !other.m_parent );
+	assert( m_size == other.m_size );
+
+	if( &other == this ) {
 		return;
 	}
 
-	typename DataList::iterator data_iter( m_data->begin() );
-	
+	clear_nodes();
+
+	// Slots keep generations and the free list, copy_node() points used slots
+	// to the new nodes.
+	m_shared->slots = other.m_shared->slots;
+	m_shared->free_slot = other.m_shared->free_slot;
+
+	copy_node( other );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::assign( const FrozenLooseOctree<T, DVS>& frozen ) {
+	assert( !m_parent );
+	assert( frozen.is_loaded() && m_size == frozen.get_size() );
+
+	clear_nodes();
+
+	const FrozenOctreeHeader& header = *frozen.m_header;
+
+	// Used slots are pointed to the new nodes by add_data().
+	m_shared->slots.resize( header.num_slots );
+	m_shared->free_slot = header.free_slot;
+
+	for( std::size_t slot_idx = 0; slot_idx < header.num_slots; ++slot_idx ) {
+		m_shared->slots[slot_idx].node = nullptr;
+		m_shared->slots[slot_idx].index = frozen.m_slots[slot_idx].next_free;
+		m_shared->slots[slot_idx].generation = frozen.m_slots[slot_idx].generation;
+	}
+
+	copy_node( frozen, frozen.m_nodes[0] );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::clear_nodes() {
+	release_data();
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			destroy_child( child_idx );
+		}
+
+		m_shared->children_pool.destroy( m_children );
+		m_children = nullptr;
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::copy_node( const LooseOctree<T, DVS, A>& other ) {
+	std::size_t num_data = other.get_num_data();
+
+	if( num_data > 0 ) {
+		ensure_data();
+		m_data->reserve( num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			add_data( other.m_data->payload[data_idx], other.m_data->get_cuboid( data_idx ), other.m_data->slots[data_idx] );
+		}
+	}
+
+	if( !other.m_children ) {
+		return;
+	}
+
+	subdivide();
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		if( other.m_children->nodes[child_idx] ) {
+			create_child( static_cast<Quadrant>( child_idx ) );
+			m_children->nodes[child_idx]->copy_node( *other.m_children->nodes[child_idx] );
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::copy_node( const FrozenLooseOctree<T, DVS>& frozen, const FrozenOctreeNode& node ) {
+	if( node.num_data > 0 ) {
+		ensure_data();
+		m_data->reserve( node.num_data );
+
+		for( std::size_t data_idx = node.first_data; data_idx < node.first_data + node.num_data; ++data_idx ) {
+			add_data( frozen.m_payload[data_idx], frozen.get_data_cuboid( data_idx ), frozen.m_data_slots[data_idx] );
+		}
+	}
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		if( node.children[child_idx] != 0 ) {
+			if( !m_children ) {
+				subdivide();
+			}
+
+			create_child( static_cast<Quadrant>( child_idx ) );
+			m_children->nodes[child_idx]->copy_node( frozen, (&node)[node.children[child_idx]] );
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::serialize( std::vector<char>& buffer ) const {
+	static_assert( std::is_trivially_copyable<T>::value, "Serialized data must be trivially copyable." );
+	assert( !m_parent );
+	assert( m_shared->slots.size() <= std::numeric_limits<uint32_t>::max() );
+
+	std::vector<FrozenOctreeNode> nodes;
+	std::vector<const LooseOctree*> sources;
+	uint32_t num_data = 0;
+
+	flatten( nodes, sources, num_data );
+
+	FrozenOctreeHeader header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, FROZEN_OCTREE_MAGIC, sizeof( header.magic ) );
+
+	header.version = FROZEN_OCTREE_VERSION;
+	header.byte_order = FROZEN_OCTREE_BYTE_ORDER;
+	header.data_size = static_cast<uint32_t>( sizeof( T ) );
+	header.scalar_size = static_cast<uint32_t>( sizeof( DVS ) );
+	header.scalar_is_float = std::is_floating_point<DVS>::value ? 1 : 0;
+	header.size = m_size;
+	header.num_nodes = static_cast<uint32_t>( nodes.size() );
+	header.num_data = num_data;
+	header.num_slots = static_cast<uint32_t>( m_shared->slots.size() );
+	header.free_slot = m_shared->free_slot;
+
+	// Every section is aligned, so it can be used in place.
+	const uint64_t alignment = std::max( FROZEN_OCTREE_ALIGNMENT, std::alignment_of<T>::value );
+	uint64_t offset = sizeof( FrozenOctreeHeader );
+
+	header.nodes_offset = append_frozen_section( offset, nodes.size() * sizeof( FrozenOctreeNode ), alignment );
+	header.components_offset = append_frozen_section( offset, uint64_t( num_data ) * DataBlock::NUM_COMPONENTS * sizeof( DVS ), alignment );
+	header.payload_offset = append_frozen_section( offset, uint64_t( num_data ) * sizeof( T ), alignment );
+	header.data_slots_offset = append_frozen_section( offset, uint64_t( num_data ) * sizeof( uint32_t ), alignment );
+	header.slots_offset = append_frozen_section( offset, m_shared->slots.size() * sizeof( FrozenOctreeSlot ), alignment );
+	header.total_size = append_frozen_section( offset, 0, alignment );
+
+	// Zero padding, so equal trees give equal buffers.
+	buffer.assign( static_cast<std::size_t>( header.total_size ), 0 );
+
+	char* bytes = buffer.data();
+	DVS* components = reinterpret_cast<DVS*>( bytes + header.components_offset );
+	T* payload = reinterpret_cast<T*>( bytes + header.payload_offset );
+	uint32_t* data_slots = reinterpret_cast<uint32_t*>( bytes + header.data_slots_offset );
+	FrozenOctreeSlot* slots = reinterpret_cast<FrozenOctreeSlot*>( bytes + header.slots_offset );
+
+	std::memcpy( bytes, &header, sizeof( header ) );
+	std::memcpy( bytes + header.nodes_offset, nodes.data(), nodes.size() * sizeof( FrozenOctreeNode ) );
+
+	for( std::size_t node_idx = 0; node_idx < nodes.size(); ++node_idx ) {
+		const DataBlock* data = sources[node_idx]->m_data;
+		std::size_t first = nodes[node_idx].first_data;
+		std::size_t num = nodes[node_idx].num_data;
+
+		if( num == 0 ) {
+			continue;
+		}
+
+		for( std::size_t component = 0; component < DataBlock::NUM_COMPONENTS; ++component ) {
+			std::memcpy(
+				components + component * num_data + first,
+				data->get_component( static_cast<typename DataBlock::Component>( component ) ),
+				num * sizeof( DVS )
+			);
+		}
+
+		std::memcpy( payload + first, data->payload.data(), num * sizeof( T ) );
+		std::memcpy( data_slots + first, data->slots.data(), num * sizeof( uint32_t ) );
+	}
+
+	// Free slots keep the free list, so restored trees hand out the same handles.
+	for( std::size_t slot_idx = 0; slot_idx < m_shared->slots.size(); ++slot_idx ) {
+		const Slot& info = m_shared->slots[slot_idx];
+
+		slots[slot_idx].data_idx = FROZEN_OCTREE_INVALID_INDEX;
+		slots[slot_idx].generation = info.generation;
+		slots[slot_idx].next_free = info.node ? FROZEN_OCTREE_INVALID_INDEX : info.index;
+	}
+
+	for( uint32_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+		slots[data_slots[data_idx]].data_idx = data_idx;
+	}
+}
+
+template <class T, class DVS, class A>
+uint32_t LooseOctree<T, DVS, A>::flatten(
+	std::vector<FrozenOctreeNode>& nodes,
+	std::vector<const LooseOctree*>& sources,
+	uint32_t& num_data
+) const {
+	assert( get_num_data() <= std::numeric_limits<uint32_t>::max() - num_data );
+
+	// Nodes may be reallocated by children, so only keep the index.
+	uint32_t node_idx = static_cast<uint32_t>( nodes.size() );
+	FrozenOctreeNode node;
+
+	std::memset( &node, 0, sizeof( node ) );
+	node.position[0] = m_position.x;
+	node.position[1] = m_position.y;
+	node.position[2] = m_position.z;
+	node.size = m_size;
+	node.first_data = num_data;
+	node.num_data = static_cast<uint32_t>( get_num_data() );
+
+	nodes.push_back( node );
+	sources.push_back( this );
+	num_data += node.num_data;
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			if( m_children->nodes[child_idx] ) {
+				nodes[node_idx].children[child_idx] = m_children->nodes[child_idx]->flatten( nodes, sources, num_data ) - node_idx;
+			}
+		}
+	}
+
+	nodes[node_idx].num_subtree_data = num_data - node.first_data;
+	return node_idx;
+}
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>& LooseOctree<T, DVS, A>::find_node( const DataCuboid& cuboid ) {
+#if !defined( NDEBUG )
+	FloatCuboid node_cuboid(
+		static_cast<float>( m_position.x ) - (static_cast<float>( m_size ) / 2.0f),
+		static_cast<float>( m_position.y ) - (static_cast<float>( m_size ) / 2.0f),
+		static_cast<float>( m_position.z ) - (static_cast<float>( m_size ) / 2.0f),
+		static_cast<float>( m_position.x ) + (static_cast<float>( m_size ) * 2.0f),
+		static_cast<float>( m_position.y ) + (static_cast<float>( m_size ) * 2.0f),
+		static_cast<float>( m_position.z ) + (static_cast<float>( m_size ) * 2.0f)
+	);
+
+	assert( cuboid.width <= m_size );
+	assert( cuboid.height <= m_size );
+	assert( cuboid.depth <= m_size );
+
+	assert( cuboid.x >= node_cuboid.x );
+	assert( cuboid.y >= node_cuboid.y );
+	assert( cuboid.z >= node_cuboid.z );
+
+	assert( cuboid.x + cuboid.width <= node_cuboid.x + node_cuboid.width );
+	assert( cuboid.y + cuboid.height <= node_cuboid.y + node_cuboid.height );
+	assert( cuboid.z + cuboid.depth <= node_cuboid.z + node_cuboid.depth );
+#endif
+
+	// Compute the target node in closed form and only walk down the path,
+	// creating missing nodes. Location codes of larger nodes don't fit into 64
+	// bits, those descend level by level until they're small enough.
+	if( m_size <= (static_cast<Size>( 1 ) << MORTON_BITS) ) {
+		uint64_t code = calc_location_code( cuboid );
+		LooseOctree<T, DVS, A>* node = this;
+
+		for( uint32_t depth = calc_location_depth( code ); depth > 0; --depth ) {
+			Quadrant quadrant = static_cast<Quadrant>( calc_location_quadrant( code >> (3 * (depth - 1)) ) );
+			node = &node->get_or_create_child( quadrant );
+		}
+
+		return *node;
+	}
+
+	// Determine which quadrant the data belongs to.
+	Quadrant quadrant = determine_quadrant( cuboid );
+	assert( quadrant != INVALID_QUADRANT );
+
+	// If same quadrant, data belongs to this node.
+	if( quadrant == SAME_QUADRANT ) {
+		return *this;
+	}
+
+	// Continue at child, subdivide and create it if needed.
+	return get_or_create_child( quadrant ).find_node( cuboid );
+}
+
+template <class T, class DVS, class A>
+uint32_t LooseOctree<T, DVS, A>::acquire_slot() {
+	typename Shared::SlotArray& slots = m_shared->slots;
+	uint32_t slot = m_shared->free_slot;
+
+	if( slot != std::numeric_limits<uint32_t>::max() ) {
+		m_shared->free_slot = slots[slot].index;
+	}
+	else {
+		assert( slots.size() < std::numeric_limits<uint32_t>::max() );
+
+		slot = static_cast<uint32_t>( slots.size() );
+		slots.push_back( Slot() );
+		slots.back().generation = 0;
+	}
+
+	slots[slot].node = nullptr;
+	slots[slot].index = 0;
+
+	return slot;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::release_slot( uint32_t slot ) {
+	Slot& info = m_shared->slots[slot];
+
+	// Bumping the generation invalidates all handles to the slot.
+	info.node = nullptr;
+	info.index = m_shared->free_slot;
+	++info.generation;
+
+	m_shared->free_slot = slot;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::add_data( const T& data, const DataCuboid& cuboid, uint32_t slot ) {
+	ensure_data();
+	m_data->push_back( data, cuboid, slot );
+
+	Slot& info = m_shared->slots[slot];
+	info.node = this;
+	info.index = static_cast<uint32_t>( m_data->size() - 1 );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::remove_data( std::size_t data_idx, bool keep_slot ) {
+	assert( m_data && data_idx < m_data->size() );
+
+	uint32_t slot = m_data->slots[data_idx];
+	m_data->swap_and_pop( data_idx );
+
+	// Update the slot of the entry that has been moved into the gap.
+	if( data_idx < m_data->size() ) {
+		m_shared->slots[m_data->slots[data_idx]].index = static_cast<uint32_t>( data_idx );
+	}
+
+	if( !keep_slot ) {
+		if( m_shared->journal ) {
+			Handle handle;
+			handle.index = slot;
+			handle.generation = m_shared->slots[slot].generation;
+
+			m_shared->journal->record_erase( handle );
+		}
+
+		release_slot( slot );
+	}
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::holds_loosely( const DataCuboid& cuboid ) const {
+	DVS size = static_cast<DVS>( m_size );
+
+	return (
+		cuboid.width <= size &&
+		cuboid.height <= size &&
+		cuboid.depth <= size &&
+		cuboid.x >= m_loose_min.x &&
+		cuboid.y >= m_loose_min.y &&
+		cuboid.z >= m_loose_min.z &&
+		cuboid.x + cuboid.width <= m_loose_max.x &&
+		cuboid.y + cuboid.height <= m_loose_max.y &&
+		cuboid.z + cuboid.depth <= m_loose_max.z
+	);
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::accepts( const DataCuboid& cuboid ) const {
+	// Same conditions that insert() checks when reaching a node.
+	DVS size = static_cast<DVS>( m_size );
+	DVS x = static_cast<DVS>( m_position.x );
+	DVS y = static_cast<DVS>( m_position.y );
+	DVS z = static_cast<DVS>( m_position.z );
+	DVS center_x = cuboid.x + cuboid.width / 2;
+	DVS center_y = cuboid.y + cuboid.height / 2;
+	DVS center_z = cuboid.z + cuboid.depth / 2;
+
+	return (
+		cuboid.width <= size &&
+		cuboid.height <= size &&
+		cuboid.depth <= size &&
+		center_x >= x &&
+		center_y >= y &&
+		center_z >= z &&
+		center_x <= x + size &&
+		center_y <= y + size &&
+		center_z <= z + size
+	);
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::update( const Handle& handle, const DataCuboid& cuboid ) {
+	assert( is_valid( handle ) );
+	assert( cuboid.width > 0 && cuboid.height > 0 && cuboid.depth > 0 );
+
+	if( m_shared->journal ) {
+		m_shared->journal->record_update( handle, cuboid );
+	}
+
+	const Slot& info = m_shared->slots[handle.index];
+	LooseOctree<T, DVS, A>* node = info.node;
+
+	// Small moves usually keep the data inside the node's loose bounds.
+	if( node->holds_loosely( cuboid ) ) {
+		node->m_data->set_cuboid( info.index, cuboid );
+		return;
+	}
+
+	// Climb to the nearest ancestor the data can be inserted at.
+	LooseOctree<T, DVS, A>* ancestor = node;
+
+	while( ancestor->m_parent && !ancestor->accepts( cuboid ) ) {
+		ancestor = ancestor->m_parent;
+	}
+
+	LooseOctree<T, DVS, A>& target = ancestor->find_node( cuboid );
+
+	if( &target == node ) {
+		node->m_data->set_cuboid( info.index, cuboid );
+		return;
+	}
+
+	// Add to the new node before removing from the old one, so cleaning up
+	// can't destroy the path to the target.
+	std::size_t data_idx = info.index;
+
+	target.add_data( node->m_data->payload[data_idx], cuboid, handle.index );
+	node->remove_data( data_idx, true );
+	node->cleanup( true );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::set_journal( ChangeJournal<T, DVS>* journal ) {
+	static_assert( std::is_trivially_copyable<T>::value, "Journaled data must be trivially copyable." );
+	assert( !m_parent );
+
+	m_shared->journal = journal;
+}
+
+template <class T, class DVS, class A>
+ChangeJournal<T, DVS>* LooseOctree<T, DVS, A>::get_journal() const {
+	return m_shared->journal;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::is_valid( const Handle& handle ) const {
+	return (
+		handle.index < m_shared->slots.size() &&
+		m_shared->slots[handle.index].generation == handle.generation &&
+		m_shared->slots[handle.index].node != nullptr
+	);
+}
+
+template <class T, class DVS, class A>
+T& LooseOctree<T, DVS, A>::get( const Handle& handle ) {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_shared->slots[handle.index];
+	return info.node->m_data->payload[info.index];
+}
+
+template <class T, class DVS, class A>
+const T& LooseOctree<T, DVS, A>::get( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_shared->slots[handle.index];
+	return info.node->m_data->payload[info.index];
+}
+
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::DataCuboid LooseOctree<T, DVS, A>::get_cuboid( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+
+	const Slot& info = m_shared->slots[handle.index];
+	return info.node->m_data->get_cuboid( info.index );
+}
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>& LooseOctree<T, DVS, A>::get_node( const Handle& handle ) const {
+	assert( is_valid( handle ) );
+
+	return *m_shared->slots[handle.index].node;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::subdivide() {
+	assert( !is_subdivided() );
+	assert( m_size > 1 );
+
+	m_children = m_shared->children_pool.create();
+	std::memset( m_children->nodes, 0, sizeof( m_children->nodes ) );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::create_child( Quadrant quadrant ) {
+	assert( quadrant < SAME_QUADRANT );
+	assert( is_subdivided() );
+	assert( m_size > 1 );
+	assert( m_children->nodes[quadrant] == nullptr );
+
+	Vector position = m_position;
+	Size size = m_size / 2;
+
+	switch( quadrant ) {
+		case LEFT_BOTTOM_FAR:
+			break;
+
+		case RIGHT_BOTTOM_FAR:
+			position.x += size;
+			break;
+
+		case LEFT_BOTTOM_NEAR:
+			position.z += size;
+			break;
+
+		case RIGHT_BOTTOM_NEAR:
+			position.x += size;
+			position.z += size;
+			break;
+
+		case LEFT_TOP_FAR:
+			position.y += size;
+			break;
+
+		case RIGHT_TOP_FAR:
+			position.x += size;
+			position.y += size;
+			break;
+
+		case LEFT_TOP_NEAR:
+			position.z += size;
+			position.y += size;
+			break;
+
+		case RIGHT_TOP_NEAR:
+			position.x += size;
+			position.y += size;
+			position.z += size;
+			break;
+
+		default:
+			assert( 0 && "Invalid quadrant." );
+			break;
+	}
+
+	m_children->nodes[quadrant] = new( m_shared->node_pool.allocate() ) LooseOctree<T, DVS, A>( position, size, this );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::destroy_child( std::size_t child_idx ) {
+	assert( is_subdivided() );
+	assert( child_idx < SAME_QUADRANT );
+
+	LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+	if( !child ) {
+		return;
+	}
+
+	child->~LooseOctree();
+	m_shared->node_pool.deallocate( child );
+
+	m_children->nodes[child_idx] = nullptr;
+}
+
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::Quadrant LooseOctree<T, DVS, A>::determine_quadrant( const DataCuboid& cuboid ) {
+	assert( cuboid.width <= m_size );
+	assert( cuboid.height <= m_size );
+	assert( cuboid.depth <= m_size );
+
+	// Calculate center point.
+	DataVector center(
+		cuboid.x + cuboid.width / 2,
+		cuboid.y + cuboid.height / 2,
+		cuboid.z + cuboid.depth / 2
+	);
+
+	assert( center.x >= m_position.x );
+	assert( center.y >= m_position.y );
+	assert( center.z >= m_position.z );
+	assert( center.x <= m_position.x + m_size );
+	assert( center.y <= m_position.y + m_size );
+	assert( center.z <= m_position.z + m_size );
+
+	// If size is higher than half of any dimension, it belongs to the same node.
+	if(
+		cuboid.width > m_size / 2 ||
+		cuboid.height > m_size / 2 ||
+		cuboid.depth > m_size / 2
+	) {
+		return SAME_QUADRANT;
+	}
+
+	Size half_x = m_position.x + m_size / 2;
+	Size half_y = m_position.y + m_size / 2;
+	Size half_z = m_position.z + m_size / 2;
+
+	if( center.x < half_x ) { // Left quadrants.
+		if( center.y < half_y ) { // Bottom quadrants.
+			if( center.z < half_z ) { // Far quadrants.
+				return LEFT_BOTTOM_FAR;
+			}
+			else { // Near quadrants.
+				return LEFT_BOTTOM_NEAR;
+			}
+		}
+		else { // Top quadrants.
+			if( center.z < half_z ) { // Far quadrants.
+				return LEFT_TOP_FAR;
+			}
+			else { // Near quadrants.
+				return LEFT_TOP_NEAR;
+			}
+		}
+	}
+	else { // Right quadrants.
+		if( center.y < half_y ) { // Bottom quadrants.
+			if( center.z < half_z ) { // Far quadrants.
+				return RIGHT_BOTTOM_FAR;
+			}
+			else { // Near quadrants.
+				return RIGHT_BOTTOM_NEAR;
+			}
+		}
+		else { // Top quadrants.
+			if( center.z < half_z ) { // Far quadrants.
+				return RIGHT_TOP_FAR;
+			}
+			else { // Near quadrants.
+				return RIGHT_TOP_NEAR;
+			}
+		}
+	}
+
+	return INVALID_QUADRANT;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::has_child( Quadrant quadrant ) const {
+	assert( quadrant < SAME_QUADRANT );
+
+	if( !is_subdivided() ) {
+		return false;
+	}
+
+	return m_children->nodes[quadrant] != nullptr;
+}
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>& LooseOctree<T, DVS, A>::get_child( Quadrant quadrant ) const {
+	assert( quadrant < SAME_QUADRANT );
+	assert( has_child( quadrant ) );
+
+	return *m_children->nodes[quadrant];
+}
+
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::DataArray LooseOctree<T, DVS, A>::get_data() const {
+	if( !m_data ) {
+		return DataArray();
+	}
+
+	return DataArray( m_data->payload.begin(), m_data->payload.end() );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, DataArray& results ) const {
+	search( cuboid, DataAppender{ results } );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, Visitor&& visitor ) const {
+	// No checks for cuboid needed here, as we're testing for intersections anyways.
+
+	// All data of the subtree lies within the loose bounds. If the cuboid covers
+	// them, everything is a hit.
+	if( is_loosely_inside( cuboid ) ) {
+		return visit_all( visitor );
+	}
+
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	// If this node contains data, check for collision.
+	if( m_data && m_data->size() > 0 ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		// Check each data entry for collision with the cuboid.
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			if(
+				intersects_axis( xs[data_idx], widths[data_idx], cuboid.x, cuboid.width ) &&
+				intersects_axis( ys[data_idx], heights[data_idx], cuboid.y, cuboid.height ) &&
+				intersects_axis( zs[data_idx], depths[data_idx], cuboid.z, cuboid.depth )
+			) {
+				FWU_QUERY_COUNT( hits, 1 );
+
+				if( !visitor( m_data->payload[data_idx], m_data->get_cuboid( data_idx ) ) ) {
+					return false;
+				}
+			}
+		}
+	}
+
+	// Find out which children the cuboid intersects with. Continue searching for
+	// data in those nodes.
+	if( !m_children ) {
+		// No children, nothing to do.
+		return true;
+	}
+
+	return (
+		continue_search( m_children->nodes[LEFT_BOTTOM_FAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[RIGHT_BOTTOM_FAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[LEFT_BOTTOM_NEAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[RIGHT_BOTTOM_NEAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[LEFT_TOP_FAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[RIGHT_TOP_FAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[LEFT_TOP_NEAR], cuboid, visitor ) &&
+		continue_search( m_children->nodes[RIGHT_TOP_NEAR], cuboid, visitor )
+	);
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search( const DataCuboid* cuboids, std::size_t num_cuboids, DataArray* results ) const {
+	if( num_cuboids == 0 ) {
+		return;
+	}
+
+	assert( cuboids && results );
+	assert( num_cuboids <= std::numeric_limits<uint32_t>::max() );
+
+	// One list pair per possible depth, so lists never move during traversal.
+	std::size_t max_depth = 1;
+
+	for( Size size = m_size; size > 1; size /= 2 ) {
+		++max_depth;
+	}
+
+	BatchScratch scratch;
+	scratch.active.resize( max_depth );
+	scratch.pending.resize( max_depth );
+
+	scratch.active[0].reserve( num_cuboids );
+
+	for( std::size_t query_idx = 0; query_idx < num_cuboids; ++query_idx ) {
+		scratch.active[0].push_back( static_cast<uint32_t>( query_idx ) );
+	}
+
+	search_batch( cuboids, results, scratch, 0 );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search( const DataCuboid* cuboids, std::size_t num_cuboids, DataArray* results, ThreadPool& pool ) const {
+	// Chunks are large enough to share upper levels between their queries, but
+	// small enough for stealing to balance uneven queries.
+	std::size_t grain_size = std::max(
+		num_cuboids / (pool.get_num_threads() * 8),
+		static_cast<std::size_t>( 16 )
+	);
+
+	pool.parallel_for(
+		0,
+		num_cuboids,
+		grain_size,
+		[this, cuboids, results]( std::size_t begin, std::size_t end ) {
+			search( cuboids + begin, end - begin, results + begin );
+		}
+	);
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search( const std::vector<DataCuboid>& cuboids, std::vector<DataArray>& results ) const {
+	results.resize( cuboids.size() );
+
+	if( !cuboids.empty() ) {
+		search( cuboids.data(), cuboids.size(), results.data() );
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search_batch(
+	const DataCuboid* cuboids,
+	DataArray* results,
+	BatchScratch& scratch,
+	std::size_t depth
+) const {
+	const std::vector<uint32_t>& active = scratch.active[depth];
+	std::vector<uint32_t>& pending = scratch.pending[depth];
+
+	pending.clear();
+
+	const DVS* xs = m_data ? m_data->get_component( DataBlock::X ) : nullptr;
+	const DVS* ys = m_data ? m_data->get_component( DataBlock::Y ) : nullptr;
+	const DVS* zs = m_data ? m_data->get_component( DataBlock::Z ) : nullptr;
+	const DVS* widths = m_data ? m_data->get_component( DataBlock::WIDTH ) : nullptr;
+	const DVS* heights = m_data ? m_data->get_component( DataBlock::HEIGHT ) : nullptr;
+	const DVS* depths = m_data ? m_data->get_component( DataBlock::DEPTH ) : nullptr;
+	std::size_t num_data = get_num_data();
+
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	for( std::size_t active_idx = 0; active_idx < active.size(); ++active_idx ) {
+		uint32_t query_idx = active[active_idx];
+		const DataCuboid& cuboid = cuboids[query_idx];
+
+		// Covered subtrees are collected at once and the query is finished here.
+		if( is_loosely_inside( cuboid ) ) {
+			DataAppender appender{ results[query_idx] };
+			visit_all( appender );
+			continue;
+		}
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			if(
+				intersects_axis( xs[data_idx], widths[data_idx], cuboid.x, cuboid.width ) &&
+				intersects_axis( ys[data_idx], heights[data_idx], cuboid.y, cuboid.height ) &&
+				intersects_axis( zs[data_idx], depths[data_idx], cuboid.z, cuboid.depth )
+			) {
+				FWU_QUERY_COUNT( hits, 1 );
+				results[query_idx].push_back( m_data->payload[data_idx] );
+			}
+		}
+
+		pending.push_back( query_idx );
+	}
+
+	if( !m_children || pending.empty() ) {
+		return;
+	}
+
+	// Carry down only the queries overlapping each child.
+	std::vector<uint32_t>& child_active = scratch.active[depth + 1];
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+		if( !child ) {
+			continue;
+		}
+
+		child_active.clear();
+
+		for( std::size_t pending_idx = 0; pending_idx < pending.size(); ++pending_idx ) {
+			if( child->overlaps_loosely( cuboids[pending[pending_idx]] ) ) {
+				child_active.push_back( pending[pending_idx] );
+			}
+		}
+
+		if( !child_active.empty() ) {
+			child->search_batch( cuboids, results, scratch, depth + 1 );
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::visit_all( Visitor& visitor ) const {
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( hits, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			if( !visitor( m_data->payload[data_idx], m_data->get_cuboid( data_idx ) ) ) {
+				return false;
+			}
+		}
+	}
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			if( m_children->nodes[child_idx] && !m_children->nodes[child_idx]->visit_all( visitor ) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::visit_all( DataAppender& appender ) const {
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		FWU_QUERY_COUNT( hits, m_data->size() );
+		appender.results.insert( appender.results.end(), m_data->payload.begin(), m_data->payload.end() );
+	}
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			if( m_children->nodes[child_idx] ) {
+				m_children->nodes[child_idx]->visit_all( appender );
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::is_loosely_inside( const DataCuboid& cuboid ) const {
+	return (
+		cuboid.x <= m_loose_min.x &&
+		cuboid.y <= m_loose_min.y &&
+		cuboid.z <= m_loose_min.z &&
+		cuboid.x + cuboid.width >= m_loose_max.x &&
+		cuboid.y + cuboid.height >= m_loose_max.y &&
+		cuboid.z + cuboid.depth >= m_loose_max.z
+	);
+}
+
+template <class T, class DVS, class A>
+std::size_t LooseOctree<T, DVS, A>::count( const DataCuboid& cuboid ) const {
+	if( is_loosely_inside( cuboid ) ) {
+		return count_all();
+	}
+
+	std::size_t num_hits = 0;
+
+	if( m_data ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			if(
+				intersects_axis( xs[data_idx], widths[data_idx], cuboid.x, cuboid.width ) &&
+				intersects_axis( ys[data_idx], heights[data_idx], cuboid.y, cuboid.height ) &&
+				intersects_axis( zs[data_idx], depths[data_idx], cuboid.z, cuboid.depth )
+			) {
+				++num_hits;
+			}
+		}
+	}
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+			if( child && child->overlaps_loosely( cuboid ) ) {
+				num_hits += child->count( cuboid );
+			}
+		}
+	}
+
+	return num_hits;
+}
+
+template <class T, class DVS, class A>
+std::size_t LooseOctree<T, DVS, A>::count_all() const {
+	std::size_t num_data = get_num_data();
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			if( m_children->nodes[child_idx] ) {
+				num_data += m_children->nodes[child_idx]->count_all();
+			}
+		}
+	}
+
+	return num_data;
+}
+
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::Stats LooseOctree<T, DVS, A>::collect_stats() const {
+	Stats stats = { std::vector<std::size_t>(), std::vector<std::size_t>(), 0, 0, 0, 0, 0.0f, 0, 0, 0, 0 };
+
+	add_stats( stats, 0 );
+
+	stats.empty_node_ratio = static_cast<float>( stats.num_empty_nodes ) / static_cast<float>( stats.num_nodes );
+	stats.slot_bytes = m_shared->slots.capacity() * sizeof( Slot );
+
+	return stats;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::add_stats( Stats& stats, std::size_t depth ) const {
+	std::size_t num_data = get_num_data();
+	std::size_t bucket = 0;
+
+	while( (num_data >> bucket) > 0 ) {
+		++bucket;
+	}
+
+	if( depth >= stats.num_nodes_per_depth.size() ) {
+		stats.num_nodes_per_depth.resize( depth + 1, 0 );
+	}
+
+	if( bucket >= stats.data_histogram.size() ) {
+		stats.data_histogram.resize( bucket + 1, 0 );
+	}
+
+	++stats.num_nodes_per_depth[depth];
+	++stats.data_histogram[bucket];
+	++stats.num_nodes;
+	stats.num_empty_nodes += num_data == 0 ? 1 : 0;
+	stats.num_data += num_data;
+	stats.max_data_per_node = std::max( stats.max_data_per_node, num_data );
+	stats.node_bytes += sizeof( LooseOctree<T, DVS, A> );
+
+	if( m_data ) {
+		stats.data_bytes += (
+			sizeof( DataBlock ) +
+			m_data->components.capacity() * sizeof( DVS ) +
+			m_data->payload.capacity() * sizeof( T ) +
+			m_data->slots.capacity() * sizeof( uint32_t )
+		);
+	}
+
+	if( !m_children ) {
+		return;
+	}
+
+	stats.children_bytes += sizeof( Children );
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		if( m_children->nodes[child_idx] ) {
+			m_children->nodes[child_idx]->add_stats( stats, depth + 1 );
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search_frustum( const Frustum<DVS>& frustum, DataArray& results ) const {
+	DataAppender appender = { results };
+	search_frustum( frustum, Frustum<DVS>::ALL_PLANES, appender );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::search_frustum( const Frustum<DVS>& frustum, Visitor&& visitor ) const {
+	return search_frustum( frustum, Frustum<DVS>::ALL_PLANES, visitor );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::search_frustum( const Frustum<DVS>& frustum, uint32_t plane_mask, Visitor& visitor ) const {
+	typename Frustum<DVS>::Classification classification = frustum.classify( m_loose_min, m_loose_max, plane_mask );
+
+	if( classification == Frustum<DVS>::OUTSIDE ) {
+		return true;
+	}
+
+	// All data of the subtree lies within the loose bounds.
+	if( classification == Frustum<DVS>::INSIDE ) {
+		return visit_all( visitor );
+	}
+
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			DataVector box_min( xs[data_idx], ys[data_idx], zs[data_idx] );
+			DataVector box_max( xs[data_idx] + widths[data_idx], ys[data_idx] + heights[data_idx], zs[data_idx] + depths[data_idx] );
+			uint32_t data_plane_mask = plane_mask;
+
+			if( frustum.classify( box_min, box_max, data_plane_mask ) != Frustum<DVS>::OUTSIDE ) {
+				FWU_QUERY_COUNT( hits, 1 );
+
+				if( !visitor( m_data->payload[data_idx], m_data->get_cuboid( data_idx ) ) ) {
+					return false;
+				}
+			}
+		}
+	}
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+			if( child && !child->search_frustum( frustum, plane_mask, visitor ) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search_sphere( const DataVector& center, DVS radius, DataArray& results ) const {
+	DataAppender appender = { results };
+	Sphere sphere = { center, radius * radius };
+
+	search_shape( sphere, appender );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::search_sphere( const DataVector& center, DVS radius, Visitor&& visitor ) const {
+	Sphere sphere = { center, radius * radius };
+	return search_shape( sphere, visitor );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::search_capsule( const DataVector& start, const DataVector& end, DVS radius, DataArray& results ) const {
+	DataAppender appender = { results };
+	Capsule capsule = { start, end, radius * radius };
+
+	search_shape( capsule, appender );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool LooseOctree<T, DVS, A>::search_capsule( const DataVector& start, const DataVector& end, DVS radius, Visitor&& visitor ) const {
+	Capsule capsule = { start, end, radius * radius };
+	return search_shape( capsule, visitor );
+}
+
+template <class T, class DVS, class A>
+template <class Shape, class Visitor>
+bool LooseOctree<T, DVS, A>::search_shape( const Shape& shape, Visitor& visitor ) const {
+	if( !shape.touches( m_loose_min, m_loose_max ) ) {
+		return true;
+	}
+
+	// All data of the subtree lies within the loose bounds.
+	if( shape.contains( m_loose_min, m_loose_max ) ) {
+		return visit_all( visitor );
+	}
+
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			DataVector box_min( xs[data_idx], ys[data_idx], zs[data_idx] );
+			DataVector box_max( xs[data_idx] + widths[data_idx], ys[data_idx] + heights[data_idx], zs[data_idx] + depths[data_idx] );
+
+			if( shape.touches( box_min, box_max ) ) {
+				FWU_QUERY_COUNT( hits, 1 );
+
+				if( !visitor( m_data->payload[data_idx], m_data->get_cuboid( data_idx ) ) ) {
+					return false;
+				}
+			}
+		}
+	}
+
+	if( m_children ) {
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+			if( child && !child->search_shape( shape, visitor ) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::raycast( const DataVector& origin, const DataVector& direction, DVS max_distance, RayHit& hit ) const {
+	assert( direction.x != DVS( 0 ) || direction.y != DVS( 0 ) || direction.z != DVS( 0 ) );
+
+	Ray ray( origin, direction );
+	DVS distance = DVS( 0 );
+	bool found = false;
+
+	if( intersect_ray_box( ray.origin, ray.direction, ray.inv_direction, m_loose_min, m_loose_max, max_distance, distance ) ) {
+		raycast_nearest( ray, max_distance, hit, found );
+	}
+
+	return found;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::raycast( const DataVector& origin, const DataVector& direction, DVS max_distance, std::vector<RayHit>& hits ) const {
+	assert( direction.x != DVS( 0 ) || direction.y != DVS( 0 ) || direction.z != DVS( 0 ) );
+
+	Ray ray( origin, direction );
+	DVS distance = DVS( 0 );
+	std::size_t first_hit = hits.size();
+
+	if( !intersect_ray_box( ray.origin, ray.direction, ray.inv_direction, m_loose_min, m_loose_max, max_distance, distance ) ) {
+		return;
+	}
+
+	raycast_all( ray, max_distance, hits );
+
+	std::stable_sort(
+		hits.begin() + static_cast<std::ptrdiff_t>( first_hit ),
+		hits.end(),
+		[]( const RayHit& first, const RayHit& second ) {
+			return first.distance < second.distance;
+		}
+	);
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::raycast_nearest( const Ray& ray, DVS& max_distance, RayHit& hit, bool& found ) const {
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			DataVector box_min( xs[data_idx], ys[data_idx], zs[data_idx] );
+			DataVector box_max( xs[data_idx] + widths[data_idx], ys[data_idx] + heights[data_idx], zs[data_idx] + depths[data_idx] );
+			DVS distance = DVS( 0 );
+
+			if(
+				intersect_ray_box( ray.origin, ray.direction, ray.inv_direction, box_min, box_max, max_distance, distance ) &&
+				(!found || distance < max_distance)
+			) {
+				FWU_QUERY_COUNT( hits, 1 );
+
+				hit.data = m_data->payload[data_idx];
+				hit.cuboid = m_data->get_cuboid( data_idx );
+				hit.distance = distance;
+
+				max_distance = distance;
+				found = true;
+			}
+		}
+	}
+
+	if( !m_children ) {
+		return;
+	}
+
+	std::pair<DVS, const LooseOctree<T, DVS, A>*> children[SAME_QUADRANT];
+	std::size_t num_children = sort_children_along_ray( ray, max_distance, children );
+
+	// Front to back. Once a child is entered behind the nearest hit, all
+	// following ones are, too.
+	for( std::size_t child_idx = 0; child_idx < num_children; ++child_idx ) {
+		if( children[child_idx].first > max_distance ) {
+			break;
+		}
+
+		children[child_idx].second->raycast_nearest( ray, max_distance, hit, found );
+	}
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::raycast_all( const Ray& ray, DVS max_distance, std::vector<RayHit>& hits ) const {
+	FWU_QUERY_COUNT( nodes_visited, 1 );
+
+	if( m_data ) {
+		const DVS* xs = m_data->get_component( DataBlock::X );
+		const DVS* ys = m_data->get_component( DataBlock::Y );
+		const DVS* zs = m_data->get_component( DataBlock::Z );
+		const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+		const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+		const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+		std::size_t num_data = m_data->size();
+
+		FWU_QUERY_COUNT( data_tested, num_data );
+
+		for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+			DataVector box_min( xs[data_idx], ys[data_idx], zs[data_idx] );
+			DataVector box_max( xs[data_idx] + widths[data_idx], ys[data_idx] + heights[data_idx], zs[data_idx] + depths[data_idx] );
+			DVS distance = DVS( 0 );
+
+			if( intersect_ray_box( ray.origin, ray.direction, ray.inv_direction, box_min, box_max, max_distance, distance ) ) {
+				FWU_QUERY_COUNT( hits, 1 );
+
+				RayHit hit = { m_data->payload[data_idx], m_data->get_cuboid( data_idx ), distance };
+				hits.push_back( hit );
+			}
+		}
+	}
+
+	if( !m_children ) {
+		return;
+	}
+
+	std::pair<DVS, const LooseOctree<T, DVS, A>*> children[SAME_QUADRANT];
+	std::size_t num_children = sort_children_along_ray( ray, max_distance, children );
+
+	for( std::size_t child_idx = 0; child_idx < num_children; ++child_idx ) {
+		children[child_idx].second->raycast_all( ray, max_distance, hits );
+	}
+}
+
+template <class T, class DVS, class A>
+std::size_t LooseOctree<T, DVS, A>::sort_children_along_ray(
+	const Ray& ray,
+	DVS max_distance,
+	std::pair<DVS, const LooseOctree<T, DVS, A>*>* children
+) const {
+	assert( m_children );
+
+	std::size_t num_children = 0;
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+		DVS distance = DVS( 0 );
+
+		if(
+			!child ||
+			!intersect_ray_box( ray.origin, ray.direction, ray.inv_direction, child->m_loose_min, child->m_loose_max, max_distance, distance )
+		) {
+			continue;
+		}
+
+		// Insertion sort by entry distance.
+		std::size_t insert_idx = num_children;
+
+		while( insert_idx > 0 && children[insert_idx - 1].first > distance ) {
+			children[insert_idx] = children[insert_idx - 1];
+			--insert_idx;
+		}
+
+		children[insert_idx] = std::make_pair( distance, child );
+		++num_children;
+	}
+
+	return num_children;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::nearest( const DataVector& point, std::size_t k, DVS max_distance, std::vector<Neighbour>& neighbours ) const {
+	typedef std::pair<DVS, const LooseOctree<T, DVS, A>*> NodeEntry;
+
+	if( k == 0 ) {
+		return;
+	}
+
+	// Nodes by the lower bound of their data's distances, nearest first.
+	std::vector<NodeEntry> nodes;
+	auto is_farther = []( const NodeEntry& first, const NodeEntry& second ) {
+		return first.first > second.first;
+	};
+
+	// At most k candidates, farthest first.
+	std::vector<NeighbourCandidate> candidates;
+	candidates.reserve( k );
+
+	DVS squared_radius = max_distance * max_distance;
+	DVS distance = calc_squared_distance_point_box( point, m_loose_min, m_loose_max );
+
+	if( distance <= squared_radius ) {
+		nodes.push_back( NodeEntry( distance, this ) );
+	}
+
+	while( !nodes.empty() ) {
+		std::pop_heap( nodes.begin(), nodes.end(), is_farther );
+		NodeEntry entry = nodes.back();
+		nodes.pop_back();
+
+		// All remaining nodes are at least as far away.
+		if( entry.first > squared_radius ) {
+			break;
+		}
+
+		const LooseOctree<T, DVS, A>* node = entry.second;
+
+		FWU_QUERY_COUNT( nodes_visited, 1 );
+
+		if( node->m_data ) {
+			const DVS* xs = node->m_data->get_component( DataBlock::X );
+			const DVS* ys = node->m_data->get_component( DataBlock::Y );
+			const DVS* zs = node->m_data->get_component( DataBlock::Z );
+			const DVS* widths = node->m_data->get_component( DataBlock::WIDTH );
+			const DVS* heights = node->m_data->get_component( DataBlock::HEIGHT );
+			const DVS* depths = node->m_data->get_component( DataBlock::DEPTH );
+			std::size_t num_data = node->m_data->size();
+
+			FWU_QUERY_COUNT( data_tested, num_data );
+
+			for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+				DataVector box_min( xs[data_idx], ys[data_idx], zs[data_idx] );
+				DataVector box_max( xs[data_idx] + widths[data_idx], ys[data_idx] + heights[data_idx], zs[data_idx] + depths[data_idx] );
+
+				distance = calc_squared_distance_point_box( point, box_min, box_max );
+
+				if( distance > squared_radius || (candidates.size() == k && distance >= squared_radius) ) {
+					continue;
+				}
+
+				FWU_QUERY_COUNT( hits, 1 );
+
+				if( candidates.size() == k ) {
+					std::pop_heap( candidates.begin(), candidates.end() );
+					candidates.pop_back();
+				}
+
+				NeighbourCandidate candidate = { distance, node, data_idx };
+				candidates.push_back( candidate );
+				std::push_heap( candidates.begin(), candidates.end() );
+
+				if( candidates.size() == k ) {
+					squared_radius = candidates.front().squared_distance;
+				}
+			}
+		}
+
+		if( node->m_children ) {
+			for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+				const LooseOctree<T, DVS, A>* child = node->m_children->nodes[child_idx];
+
+				if( !child ) {
+					continue;
+				}
+
+				distance = calc_squared_distance_point_box( point, child->m_loose_min, child->m_loose_max );
+
+				if( distance <= squared_radius ) {
+					nodes.push_back( NodeEntry( distance, child ) );
+					std::push_heap( nodes.begin(), nodes.end(), is_farther );
+				}
+			}
+		}
+	}
+
+	std::sort_heap( candidates.begin(), candidates.end() );
+	neighbours.reserve( neighbours.size() + candidates.size() );
+
+	for( std::size_t candidate_idx = 0; candidate_idx < candidates.size(); ++candidate_idx ) {
+		const NeighbourCandidate& candidate = candidates[candidate_idx];
+		Neighbour neighbour = {
+			candidate.node->m_data->payload[candidate.data_idx],
+			candidate.node->m_data->get_cuboid( candidate.data_idx ),
+			std::sqrt( candidate.squared_distance )
+		};
+
+		neighbours.push_back( neighbour );
+	}
+}
+
+template <class T, class DVS, class A>
+template <class Callback>
+bool LooseOctree<T, DVS, A>::for_each_overlapping_pair( Callback&& callback ) const {
+	return pair_within_subtree( callback );
+}
+
+template <class T, class DVS, class A>
+template <class Callback>
+bool LooseOctree<T, DVS, A>::for_each_overlapping_pair( Callback&& callback, ThreadPool& pool ) const {
+	// Two levels give up to 73 subtrees and a few hundred subtree pairs, enough
+	// to balance uneven subtrees.
+	static const std::size_t SPLIT_DEPTH = 2;
+
+	std::vector<PairTask> tasks;
+	collect_pair_tasks( tasks, SPLIT_DEPTH );
+
+	std::atomic<bool> stopped( false );
+
+	pool.parallel_for(
+		0,
+		tasks.size(),
+		1,
+		[this, &tasks, &callback, &stopped]( std::size_t begin, std::size_t end ) {
+			for( std::size_t task_idx = begin; task_idx < end; ++task_idx ) {
+				if( stopped.load( std::memory_order_relaxed ) ) {
+					return;
+				}
+
+				if( !run_pair_task( tasks[task_idx], callback ) ) {
+					stopped.store( true, std::memory_order_relaxed );
+				}
+			}
+		}
+	);
+
+	return !stopped.load();
+}
+
+template <class T, class DVS, class A>
+template <class OtherT, class OtherAllocator, class Callback>
+bool LooseOctree<T, DVS, A>::for_each_overlapping_pair(
+	const LooseOctree<OtherT, DVS, OtherAllocator>& other,
+	Callback&& callback
+) const {
+	return pair_between_subtrees( other, callback );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::collect_pair_tasks( std::vector<PairTask>& tasks, std::size_t depth ) const {
+	if( depth == 0 || !m_children ) {
+		PairTask task = { PairTask::WITHIN_SUBTREE, this, nullptr };
+		tasks.push_back( task );
+		return;
+	}
+
+	// Same split as pair_within_subtree().
+	if( get_num_data() > 0 ) {
+		PairTask task = { PairTask::OWN_DATA, this, nullptr };
+		tasks.push_back( task );
+
+		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+			if( m_children->nodes[child_idx] ) {
+				PairTask child_task = { PairTask::DATA_WITH_SUBTREE, this, m_children->nodes[child_idx] };
+				tasks.push_back( child_task );
+			}
+		}
+	}
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		if( m_children->nodes[child_idx] ) {
+			m_children->nodes[child_idx]->collect_pair_tasks( tasks, depth - 1 );
+		}
+	}
+
+	for( std::size_t first_idx = 0; first_idx < SAME_QUADRANT; ++first_idx ) {
+		for( std::size_t second_idx = first_idx + 1; second_idx < SAME_QUADRANT; ++second_idx ) {
+			if( m_children->nodes[first_idx] && m_children->nodes[second_idx] ) {
+				PairTask task = { PairTask::BETWEEN_SUBTREES, m_children->nodes[first_idx], m_children->nodes[second_idx] };
+				tasks.push_back( task );
+			}
+		}
+	}
+}
+
+template <class T, class DVS, class A>
+template <class Callback>
+bool LooseOctree<T, DVS, A>::run_pair_task( const PairTask& task, Callback& callback ) const {
+	switch( task.type ) {
+		case PairTask::WITHIN_SUBTREE:
+			return task.first->pair_within_subtree( callback );
+
+		case PairTask::OWN_DATA:
+			return task.first->pair_own_data( callback );
+
+		case PairTask::DATA_WITH_SUBTREE:
+			return task.first->pair_data_with_subtree( *task.second, callback );
+
+		case PairTask::BETWEEN_SUBTREES:
+			return task.first->pair_between_subtrees( *task.second, callback );
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+template <class Callback>
+bool LooseOctree<T, DVS, A>::pair_within_subtree( Callback& callback ) const {
+	if( !pair_own_data( callback ) ) {
+		return false;
+	}
+
+	if( !m_children ) {
+		return true;
+	}
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+		if( child && (!pair_data_with_subtree( *child, callback ) || !child->pair_within_subtree( callback )) ) {
+			return false;
+		}
+	}
+
+	// Loose bounds of siblings overlap, so their data may, too.
+	for( std::size_t first_idx = 0; first_idx < SAME_QUADRANT; ++first_idx ) {
+		const LooseOctree<T, DVS, A>* first = m_children->nodes[first_idx];
+
+		if( !first ) {
+			continue;
+		}
+
+		for( std::size_t second_idx = first_idx + 1; second_idx < SAME_QUADRANT; ++second_idx ) {
+			const LooseOctree<T, DVS, A>* second = m_children->nodes[second_idx];
+
+			if( second && !first->pair_between_subtrees( *second, callback ) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+template <class Callback>
+bool LooseOctree<T, DVS, A>::pair_own_data( Callback& callback ) const {
+	if( !m_data ) {
+		return true;
+	}
+
+	const DVS* xs = m_data->get_component( DataBlock::X );
+	const DVS* ys = m_data->get_component( DataBlock::Y );
+	const DVS* zs = m_data->get_component( DataBlock::Z );
+	const DVS* widths = m_data->get_component( DataBlock::WIDTH );
+	const DVS* heights = m_data->get_component( DataBlock::HEIGHT );
+	const DVS* depths = m_data->get_component( DataBlock::DEPTH );
+	std::size_t num_data = m_data->size();
+
+	for( std::size_t first_idx = 0; first_idx < num_data; ++first_idx ) {
+		for( std::size_t second_idx = first_idx + 1; second_idx < num_data; ++second_idx ) {
+			if(
+				intersects_axis( xs[first_idx], widths[first_idx], xs[second_idx], widths[second_idx] ) &&
+				intersects_axis( ys[first_idx], heights[first_idx], ys[second_idx], heights[second_idx] ) &&
+				intersects_axis( zs[first_idx], depths[first_idx], zs[second_idx], depths[second_idx] ) &&
+				!callback(
+					m_data->payload[first_idx],
+					m_data->get_cuboid( first_idx ),
+					m_data->payload[second_idx],
+					m_data->get_cuboid( second_idx )
+				)
+			) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+template <class OtherT, class OtherAllocator, class Callback>
+bool LooseOctree<T, DVS, A>::pair_data_with_subtree(
+	const LooseOctree<OtherT, DVS, OtherAllocator>& other,
+	Callback& callback
+) const {
+	if( !m_data ) {
+		return true;
+	}
+
+	std::size_t num_data = m_data->size();
+
+	for( std::size_t data_idx = 0; data_idx < num_data; ++data_idx ) {
+		const T& data = m_data->payload[data_idx];
+		DataCuboid cuboid = m_data->get_cuboid( data_idx );
+
+		if(
+			other.overlaps_loosely( cuboid ) &&
+			!other.search(
+				cuboid,
+				[&data, &cuboid, &callback]( const OtherT& other_data, const DataCuboid& other_cuboid ) -> bool {
+					return callback( data, cuboid, other_data, other_cuboid );
+				}
+			)
+		) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+template <class OtherT, class OtherAllocator, class Callback>
+bool LooseOctree<T, DVS, A>::pair_between_subtrees(
+	const LooseOctree<OtherT, DVS, OtherAllocator>& other,
+	Callback& callback
+) const {
+	// Data lies within the loose bounds, so it can only overlap if they do.
+	if(
+		std::max( m_loose_min.x, other.m_loose_min.x ) >= std::min( m_loose_max.x, other.m_loose_max.x ) ||
+		std::max( m_loose_min.y, other.m_loose_min.y ) >= std::min( m_loose_max.y, other.m_loose_max.y ) ||
+		std::max( m_loose_min.z, other.m_loose_min.z ) >= std::min( m_loose_max.z, other.m_loose_max.z )
+	) {
+		return true;
+	}
+
+	// This node's data with all of other's subtree, other's data with this
+	// node's children and the children with each other.
+	if( !pair_data_with_subtree( other, callback ) ) {
+		return false;
+	}
+
+	if( !m_children ) {
+		return true;
+	}
+
+	// Other's data comes first when searching this tree, the callback expects
+	// this tree's data first.
+	auto swapped_callback = [&callback](
+		const OtherT& other_data,
+		const DataCuboid& other_cuboid,
+		const T& data,
+		const DataCuboid& cuboid
+	) -> bool {
+		return callback( data, cuboid, other_data, other_cuboid );
+	};
+
+	for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
+		const LooseOctree<T, DVS, A>* child = m_children->nodes[child_idx];
+
+		if( !child ) {
+			continue;
+		}
+
+		if( !other.pair_data_with_subtree( *child, swapped_callback ) ) {
+			return false;
+		}
+
+		if( other.m_children ) {
+			for( std::size_t other_idx = 0; other_idx < SAME_QUADRANT; ++other_idx ) {
+				const LooseOctree<OtherT, DVS, OtherAllocator>* other_child = other.m_children->nodes[other_idx];
+
+				if( other_child && !child->pair_between_subtrees( *other_child, callback ) ) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::erase( const T& data, const DataCuboid& cuboid ) {
+	// Traverse to children at first.
+	if( m_children ) {
+		continue_erase( m_children->nodes[LEFT_BOTTOM_FAR], data, cuboid );
+		continue_erase( m_children->nodes[RIGHT_BOTTOM_FAR], data, cuboid );
+		continue_erase( m_children->nodes[LEFT_BOTTOM_NEAR], data, cuboid );
+		continue_erase( m_children->nodes[RIGHT_BOTTOM_NEAR], data, cuboid );
+		continue_erase( m_children->nodes[LEFT_TOP_FAR], data, cuboid );
+		continue_erase( m_children->nodes[RIGHT_TOP_FAR], data, cuboid );
+		continue_erase( m_children->nodes[LEFT_TOP_NEAR], data, cuboid );
+		continue_erase( m_children->nodes[RIGHT_TOP_NEAR], data, cuboid );
+	}
+
+	// If this node contains data, check for collision.
+	if( m_data && m_data->size() > 0 ) {
+		std::size_t data_idx = 0;
+
+		// Check each data entry for collision with the cuboid.
+		while( data_idx < m_data->size() ) {
+			if(
+				m_data->payload[data_idx] == data &&
+				DataCuboid::calc_intersection( m_data->get_cuboid( data_idx ), cuboid ).width > 0
+			) {
+				// Hit, erase. The last entry is moved here, so test the same index again.
+				remove_data( data_idx );
+			}
+			else {
+				++data_idx;
+			}
+		}
+	}
+
+	cleanup( false );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::erase( const T& data ) {
+	if( !m_data || m_data->size() < 1 ) {
+		return;
+	}
+
+	std::size_t data_idx = 0;
+
 	// Check each data entry if it's the one being requested to be erased.
-	while( data_iter != m_data->end() ) {
-		if( data_iter->data == data ) {
+	while( data_idx < m_data->size() ) {
+		if( m_data->payload[data_idx] == data ) {
 			// Hit, erase.
-			data_iter = m_data->erase( data_iter );
+			remove_data( data_idx );
 		}
 		else {
-			++data_iter;
+			++data_idx;
 		}
 	}
 
 	cleanup( true );
 }
 
-template <class T, class DVS>
-void LooseOctree<T, DVS>::cleanup( bool recursive ) {
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::erase( const Handle& handle ) {
+	if( !is_valid( handle ) ) {
+		return;
+	}
+
+	const Slot& info = m_shared->slots[handle.index];
+	LooseOctree<T, DVS, A>* node = info.node;
+
+	node->remove_data( info.index );
+	node->cleanup( true );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::cleanup( bool recursive ) {
 	if( m_children ) {
 		// Check each child if it isn't subdivided and doesn't hold data anymore, so
 		// it can be destroyed.
@@ -486,15 +2304,14 @@ void LooseOctree<T, DVS>::cleanup( bool recursive ) {
 		std::size_t num_total_children = 0;
 
 		for( std::size_t child_idx = 0; child_idx < SAME_QUADRANT; ++child_idx ) {
-			if( m_children[child_idx] ) {
+			if( m_children->nodes[child_idx] ) {
 				++num_total_children;
 
 				if(
-					!m_children[child_idx]->is_subdivided() &&
-					!m_children[child_idx]->get_num_data()
+					!m_children->nodes[child_idx]->is_subdivided() &&
+					!m_children->nodes[child_idx]->get_num_data()
 				) {
-					delete m_children[child_idx];
-					m_children[child_idx] = nullptr;
+					destroy_child( child_idx );
 
 					++num_empty_children;
 				}
@@ -503,7 +2320,7 @@ void LooseOctree<T, DVS>::cleanup( bool recursive ) {
 
 		// Clean up memory if all children are empty.
 		if( num_empty_children == num_total_children ) {
-			delete[] m_children;
+			m_shared->children_pool.destroy( m_children );
 			m_children = nullptr;
 		}
 	}
@@ -514,4 +2331,237 @@ void LooseOctree<T, DVS>::cleanup( bool recursive ) {
 	}
 }
 
+///// Handle //////
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::Handle::Handle() :
+	index( std::numeric_limits<uint32_t>::max() ),
+	generation( 0 )
+{
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Handle::operator==( const Handle& other ) const {
+	return index == other.index && generation == other.generation;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Handle::operator!=( const Handle& other ) const {
+	return index != other.index || generation != other.generation;
+}
+
+///// DataAppender //////
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::DataAppender::operator()( const T& data, const DataCuboid& /*cuboid*/ ) const {
+	results.push_back( data );
+	return true;
+}
+
+///// BuildItem //////
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::BuildItem::operator<( const BuildItem& other ) const {
+	// Ties keep range order, which is the order insert() would store them in.
+	return code < other.code || (code == other.code && index < other.index);
+}
+
+///// NeighbourCandidate //////
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::NeighbourCandidate::operator<( const NeighbourCandidate& other ) const {
+	return squared_distance < other.squared_distance;
+}
+
+///// Ray //////
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::Ray::Ray( const DataVector& origin_, const DataVector& direction_ ) :
+	origin( origin_ ),
+	direction( direction_ ),
+	inv_direction(
+		direction_.x != DVS( 0 ) ? DVS( 1 ) / direction_.x : DVS( 0 ),
+		direction_.y != DVS( 0 ) ? DVS( 1 ) / direction_.y : DVS( 0 ),
+		direction_.z != DVS( 0 ) ? DVS( 1 ) / direction_.z : DVS( 0 )
+	)
+{
+}
+
+///// Sphere //////
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Sphere::touches( const DataVector& box_min, const DataVector& box_max ) const {
+	return calc_squared_distance_point_box( center, box_min, box_max ) <= squared_radius;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Sphere::contains( const DataVector& box_min, const DataVector& box_max ) const {
+	// Corner farthest from the center.
+	DataVector offset(
+		std::max( center.x - box_min.x, box_max.x - center.x ),
+		std::max( center.y - box_min.y, box_max.y - center.y ),
+		std::max( center.z - box_min.z, box_max.z - center.z )
+	);
+
+	return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z <= squared_radius;
+}
+
+///// Capsule //////
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Capsule::touches( const DataVector& box_min, const DataVector& box_max ) const {
+	return calc_squared_distance_segment_box( start, end, box_min, box_max ) <= squared_radius;
+}
+
+template <class T, class DVS, class A>
+bool LooseOctree<T, DVS, A>::Capsule::contains( const DataVector& box_min, const DataVector& box_max ) const {
+	// Capsules are convex, so the box is inside if all corners are.
+	for( uint32_t corner = 0; corner < 8; ++corner ) {
+		DataVector point(
+			(corner & 1) ? box_max.x : box_min.x,
+			(corner & 2) ? box_max.y : box_min.y,
+			(corner & 4) ? box_max.z : box_min.z
+		);
+
+		if( calc_squared_distance_point_segment( point, start, end ) > squared_radius ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+///// DataBlock //////
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::DataBlock::DataBlock( const A& allocator ) :
+	components( allocator ),
+	payload( allocator ),
+	slots( allocator ),
+	capacity( 0 )
+{
+}
+
+template <class T, class DVS, class A>
+std::size_t LooseOctree<T, DVS, A>::DataBlock::size() const {
+	return payload.size();
+}
+
+template <class T, class DVS, class A>
+const DVS* LooseOctree<T, DVS, A>::DataBlock::get_component( Component component ) const {
+	assert( component < NUM_COMPONENTS );
+	return components.data() + component * capacity;
+}
+
+template <class T, class DVS, class A>
+typename LooseOctree<T, DVS, A>::DataCuboid LooseOctree<T, DVS, A>::DataBlock::get_cuboid( std::size_t index ) const {
+	assert( index < size() );
+
+	return DataCuboid(
+		components[X * capacity + index],
+		components[Y * capacity + index],
+		components[Z * capacity + index],
+		components[WIDTH * capacity + index],
+		components[HEIGHT * capacity + index],
+		components[DEPTH * capacity + index]
+	);
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::DataBlock::set_cuboid( std::size_t index, const DataCuboid& cuboid ) {
+	assert( index < size() );
+
+	components[X * capacity + index] = cuboid.x;
+	components[Y * capacity + index] = cuboid.y;
+	components[Z * capacity + index] = cuboid.z;
+	components[WIDTH * capacity + index] = cuboid.width;
+	components[HEIGHT * capacity + index] = cuboid.height;
+	components[DEPTH * capacity + index] = cuboid.depth;
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::DataBlock::reserve( std::size_t new_capacity ) {
+	if( new_capacity <= capacity ) {
+		return;
+	}
+
+	// Grow component arrays. Each component is moved to its new offset.
+	std::size_t num_entries = size();
+	std::vector<DVS, ComponentAllocator> new_components( new_capacity * NUM_COMPONENTS, DVS(), components.get_allocator() );
+
+	for( std::size_t component = 0; component < NUM_COMPONENTS; ++component ) {
+		std::copy(
+			components.begin() + static_cast<std::ptrdiff_t>( component * capacity ),
+			components.begin() + static_cast<std::ptrdiff_t>( component * capacity + num_entries ),
+			new_components.begin() + static_cast<std::ptrdiff_t>( component * new_capacity )
+		);
+	}
+
+	components.swap( new_components );
+	capacity = new_capacity;
+	payload.reserve( new_capacity );
+	slots.reserve( new_capacity );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::DataBlock::push_back( const T& data, const DataCuboid& cuboid, uint32_t slot ) {
+	std::size_t index = size();
+
+	if( index == capacity ) {
+		reserve( std::max( capacity * 2, static_cast<std::size_t>( 4 ) ) );
+	}
+
+	payload.push_back( data );
+	slots.push_back( slot );
+
+	set_cuboid( index, cuboid );
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::DataBlock::swap_and_pop( std::size_t index ) {
+	assert( index < size() );
+
+	std::size_t last = size() - 1;
+
+	if( index != last ) {
+		for( std::size_t component = 0; component < NUM_COMPONENTS; ++component ) {
+			components[component * capacity + index] = components[component * capacity + last];
+		}
+
+		payload[index] = std::move( payload[last] );
+		slots[index] = slots[last];
+	}
+
+	payload.pop_back();
+	slots.pop_back();
+}
+
+template <class T, class DVS, class A>
+void LooseOctree<T, DVS, A>::DataBlock::clear() {
+	// Keep capacity, blocks are recycled.
+	payload.clear();
+	slots.clear();
+}
+
+///// Shared //////
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::Shared::Shared( const A& allocator_ ) :
+	allocator( allocator_ ),
+	node_pool( 64, allocator_ ),
+	children_pool( 64, allocator_ ),
+	data_pool( 64, allocator_ ),
+	slots( allocator_ ),
+	free_slot( std::numeric_limits<uint32_t>::max() ),
+	journal( nullptr )
+{
+}
+
+template <class T, class DVS, class A>
+LooseOctree<T, DVS, A>::Shared::~Shared() {
+	for( std::size_t block_idx = 0; block_idx < spare_data.size(); ++block_idx ) {
+		data_pool.destroy( spare_data[block_idx] );
+	}
+}
+
 }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace util {
+
+/** Maximum number of bits per coordinate that fit into a 64 bit Morton code.
+ */
+static const uint32_t MORTON_BITS = 21;
+
+/** Calculate floor( log2( value ) ).
+ * Undefined behaviour if value is 0.
+ * @param value Value.
+ * @return Index of the highest set bit.
+ */
+uint32_t floor_log2( uint64_t value );
+
+/** Calculate ceil( log2( value ) ).
+ * Undefined behaviour if value is 0.
+ * @param value Value.
+ * @return Exponent of the smallest power of two >= value.
+ */
+uint32_t ceil_log2( uint64_t value );
+
+/** Spread the lower 21 bits of a value, so that two zero bits follow each bit.
+ * @param value Value.
+ * @return Spread value.
+ */
+uint64_t morton_spread( uint32_t value );
+
+/** Inverse of morton_spread().
+ * @param value Spread value.
+ * @return Compacted value.
+ */
+uint32_t morton_compact( uint64_t value );
+
+/** Interleave coordinates to a Morton code (Z-order curve).
+ * Bit 0 is taken from x, bit 1 from y, bit 2 from z and so on. Only the lower
+ * 21 bits of each coordinate are used. Uses BMI2 bit deposit instructions if
+ * compiled for them.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param z Z coordinate.
+ * @return Morton code.
+ */
+uint64_t morton_encode( uint32_t x, uint32_t y, uint32_t z );
+
+/** Split a Morton code into its coordinates.
+ * @param code Morton code.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param z Z coordinate.
+ */
+void morton_decode( uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z );
+
+}
+
+#include "Morton.inl"
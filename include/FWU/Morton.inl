@@ -0,0 +1,80 @@
+#include <cassert>
+
+#if defined( __BMI2__ )
+	#include <immintrin.h>
+#endif
+
+namespace util {
+
+inline uint32_t floor_log2( uint64_t value ) {
+	assert( value > 0 );
+
+#if defined( __GNUC__ )
+	return 63 - static_cast<uint32_t>( __builtin_clzll( value ) );
+#else
+	uint32_t result = 0;
+
+	while( value >>= 1 ) {
+		++result;
+	}
+
+	return result;
+#endif
+}
+
+inline uint32_t ceil_log2( uint64_t value ) {
+	assert( value > 0 );
+	return value > 1 ? floor_log2( value - 1 ) + 1 : 0;
+}
+
+inline uint64_t morton_spread( uint32_t value ) {
+#if defined( __BMI2__ )
+	return _pdep_u64( value, 0x1249249249249249ull );
+#else
+	uint64_t bits = value & 0x1fffff;
+
+	bits = (bits | bits << 32) & 0x1f00000000ffffull;
+	bits = (bits | bits << 16) & 0x1f0000ff0000ffull;
+	bits = (bits | bits << 8) & 0x100f00f00f00f00full;
+	bits = (bits | bits << 4) & 0x10c30c30c30c30c3ull;
+	bits = (bits | bits << 2) & 0x1249249249249249ull;
+
+	return bits;
+#endif
+}
+
+inline uint32_t morton_compact( uint64_t value ) {
+#if defined( __BMI2__ )
+	return static_cast<uint32_t>( _pext_u64( value, 0x1249249249249249ull ) );
+#else
+	uint64_t bits = value & 0x1249249249249249ull;
+
+	bits = (bits | bits >> 2) & 0x10c30c30c30c30c3ull;
+	bits = (bits | bits >> 4) & 0x100f00f00f00f00full;
+	bits = (bits | bits >> 8) & 0x1f0000ff0000ffull;
+	bits = (bits | bits >> 16) & 0x1f00000000ffffull;
+	bits = (bits | bits >> 32) & 0x1fffff;
+
+	return static_cast<uint32_t>( bits );
+#endif
+}
+
+inline uint64_t morton_encode( uint32_t x, uint32_t y, uint32_t z ) {
+#if defined( __BMI2__ )
+	return (
+		_pdep_u64( x, 0x1249249249249249ull ) |
+		_pdep_u64( y, 0x2492492492492492ull ) |
+		_pdep_u64( z, 0x4924924924924924ull )
+	);
+#else
+	return morton_spread( x ) | (morton_spread( y ) << 1) | (morton_spread( z ) << 2);
+#endif
+}
+
+inline void morton_decode( uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z ) {
+	x = morton_compact( code );
+	y = morton_compact( code >> 1 );
+	z = morton_compact( code >> 2 );
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+
+namespace util {
+
+/** Object pool.
+ *
+ * Hands out storage for objects of a single type from contiguous pages.
+ * Released storage is kept in a free list and recycled by later allocations,
+ * so pages are only returned to the allocator when the pool is destroyed.
+ *
+ * The pool does not track live objects: destroying the pool while objects are
+ * still allocated releases their storage without calling destructors.
+ *
+ *   * T: Object type.
+ *   * Allocator: Allocator used for acquiring pages (rebound internally).
+ */
+template <class T, class Allocator = std::allocator<T>>
+class ObjectPool {
+	public:
+		/** Ctor.
+		 * @param page_size Number of objects per page (must be > 0).
+		 * @param allocator Allocator.
+		 */
+		ObjectPool( std::size_t page_size = 64, const Allocator& allocator = Allocator() );
+
+		/** Dtor.
+		 */
+		~ObjectPool();
+
+		/** Get number of objects per page.
+		 * @return Page size.
+		 */
+		std::size_t get_page_size() const;
+
+		/** Get number of allocated pages.
+		 * @return Number of pages.
+		 */
+		std::size_t get_num_pages() const;
+
+		/** Get number of objects currently allocated.
+		 * @return Number of objects.
+		 */
+		std::size_t get_num_objects() const;
+
+		/** Allocate uninitialized storage for one object.
+		 * @return Storage (never nullptr).
+		 */
+		void* allocate();
+
+		/** Return storage to the pool.
+		 * Undefined behaviour if ptr wasn't allocated by this pool.
+		 * @param ptr Storage (nullptr is ignored).
+		 */
+		void deallocate( void* ptr );
+
+		/** Allocate and construct an object.
+		 * @param args Constructor arguments.
+		 * @return Object.
+		 */
+		template <class... Args>
+		T* create( Args&&... args );
+
+		/** Destruct and deallocate an object.
+		 * @param object Object (nullptr is ignored).
+		 */
+		void destroy( T* object );
+
+	private:
+		union Block {
+			Block* next;
+			typename std::aligned_storage<sizeof( T ), std::alignment_of<T>::value>::type storage;
+		};
+
+		struct Page {
+			Page* next;
+			Block* blocks;
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Block> BlockAllocator;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Page> PageAllocator;
+
+		ObjectPool( const ObjectPool& ) = delete;
+		ObjectPool& operator=( const ObjectPool& ) = delete;
+
+		void add_page();
+
+		BlockAllocator m_block_allocator;
+		PageAllocator m_page_allocator;
+
+		Page* m_pages;
+		Block* m_free;
+
+		std::size_t m_page_size;
+		std::size_t m_num_pages;
+		std::size_t m_num_objects;
+};
+
+}
+
+#include "ObjectPool.inl"
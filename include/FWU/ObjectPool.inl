@@ -0,0 +1,127 @@
+#include <utility>
+#include <new>
+#include <cassert>
+
+namespace util {
+
+template <class T, class Allocator>
+ObjectPool<T, Allocator>::ObjectPool( std::size_t page_size, const Allocator& allocator ) :
+	m_block_allocator( allocator ),
+	m_page_allocator( allocator ),
+	m_pages( nullptr ),
+	m_free( nullptr ),
+	m_page_size( page_size ),
+	m_num_pages( 0 ),
+	m_num_objects( 0 )
+{
+	assert( m_page_size > 0 );
+}
+
+template <class T, class Allocator>
+ObjectPool<T, Allocator>::~ObjectPool() {
+	while( m_pages ) {
+		Page* page = m_pages;
+		m_pages = page->next;
+
+		m_block_allocator.deallocate( page->blocks, m_page_size );
+		m_page_allocator.deallocate( page, 1 );
+	}
+}
+
+template <class T, class Allocator>
+std::size_t ObjectPool<T, Allocator>::get_page_size() const {
+	return m_page_size;
+}
+
+template <class T, class Allocator>
+std::size_t ObjectPool<T, Allocator>::get_num_pages() const {
+	return m_num_pages;
+}
+
+template <class T, class Allocator>
+std::size_t ObjectPool<T, Allocator>::get_num_objects() const {
+	return m_num_objects;
+}
+
+template <class T, class Allocator>
+void ObjectPool<T, Allocator>::add_page() {
+	Block* blocks = m_block_allocator.allocate( m_page_size );
+	Page* page = nullptr;
+
+	// Don't leak the blocks if the page allocation throws.
+	try {
+		page = m_page_allocator.allocate( 1 );
+	}
+	catch( ... ) {
+		m_block_allocator.deallocate( blocks, m_page_size );
+		throw;
+	}
+
+	page->blocks = blocks;
+	page->next = m_pages;
+	m_pages = page;
+
+	// Link blocks in ascending order, so consecutive allocations are adjacent in
+	// memory.
+	for( std::size_t block_idx = m_page_size; block_idx > 0; --block_idx ) {
+		page->blocks[block_idx - 1].next = m_free;
+		m_free = &page->blocks[block_idx - 1];
+	}
+
+	++m_num_pages;
+}
+
+template <class T, class Allocator>
+void* ObjectPool<T, Allocator>::allocate() {
+	if( !m_free ) {
+		add_page();
+	}
+
+	Block* block = m_free;
+	m_free = block->next;
+
+	++m_num_objects;
+	return &block->storage;
+}
+
+template <class T, class Allocator>
+void ObjectPool<T, Allocator>::deallocate( void* ptr ) {
+	if( !ptr ) {
+		return;
+	}
+
+	assert( m_num_objects > 0 );
+
+	Block* block = reinterpret_cast<Block*>( ptr );
+	block->next = m_free;
+	m_free = block;
+
+	--m_num_objects;
+}
+
+template <class T, class Allocator>
+template <class... Args>
+T* ObjectPool<T, Allocator>::create( Args&&... args ) {
+	void* storage = allocate();
+
+	// Give the storage back if the constructor throws.
+	try {
+		return new( storage ) T( std::forward<Args>( args )... );
+	}
+	catch( ... ) {
+		deallocate( storage );
+		throw;
+	}
+}
+
+template <class T, class Allocator>
+void ObjectPool<T, Allocator>::destroy( T* object ) {
+	if( !object ) {
+		return;
+	}
+
+	object->~T();
+	deallocate( object );
+}
+
+}
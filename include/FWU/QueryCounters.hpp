@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+/** Count work of tree queries if FWU_QUERY_COUNTERS is defined.
+ * Compiles to nothing otherwise. The definition must be the same for all
+ * translation units, as tree queries are templates.
+ * @param counter Member of util::QueryCounters.
+ * @param amount Amount to add.
+ */
+#if defined( FWU_QUERY_COUNTERS )
+	#define FWU_QUERY_COUNT( counter, amount ) (util::get_query_counters().counter += (amount))
+#else
+	#define FWU_QUERY_COUNT( counter, amount ) static_cast<void>( 0 )
+#endif
+
+namespace util {
+
+/** Work done by tree queries of one thread.
+ * Only counted if FWU_QUERY_COUNTERS is defined, see get_query_counters().
+ */
+struct QueryCounters {
+	/** Reset all counters to zero.
+	 */
+	void reset();
+
+	uint64_t nodes_visited; ///< Nodes whose data or children were looked at.
+	uint64_t data_tested; ///< Data tested against the query.
+	uint64_t hits; ///< Data reported or accepted as candidate.
+};
+
+/** Get query counters of the calling thread.
+ * Counters accumulate over all queries of all trees until reset. They stay zero
+ * unless FWU_QUERY_COUNTERS is defined.
+ * @return Counters.
+ */
+QueryCounters& get_query_counters();
+
+}
+
+#include "QueryCounters.inl"
@@ -0,0 +1,15 @@
+namespace util {
+
+inline void QueryCounters::reset() {
+	nodes_visited = 0;
+	data_tested = 0;
+	hits = 0;
+}
+
+inline QueryCounters& get_query_counters() {
+	// Zero-initialized.
+	static thread_local QueryCounters counters;
+	return counters;
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <FWU/LooseOctree.hpp>
+#include <FWU/WorkloadTrace.hpp>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace util {
+
+/** Loose octree wrapper recording all insertions, searches and erasures.
+ *
+ * Forwards insert(), search() and both erase() overloads to the tree and
+ * appends a record per call (per erased item when erasing by data) to a
+ * WorkloadTrace, which can be written to a file and replayed against other
+ * index implementations later (see WorkloadTrace::replay()).
+ * Everything else, e.g. get() or updates, is done on get_tree() directly and
+ * isn't recorded.
+ *
+ * Neither the tree nor the trace are owned, both must outlive the wrapper.
+ *
+ *   * T: Data type.
+ *   * DVS: Data vector scalar.
+ *   * Allocator: Allocator of the tree.
+ */
+template <class T, class DVS = float, class Allocator = std::allocator<T>>
+class RecordingLooseOctree {
+	public:
+		typedef LooseOctree<T, DVS, Allocator> Tree; ///< Tree type.
+		typedef typename Tree::Handle Handle; ///< Handle of inserted data.
+		typedef typename Tree::DataCuboid DataCuboid; ///< Data cuboid.
+		typedef typename Tree::DataArray DataArray; ///< Data array.
+		typedef WorkloadTrace<DVS> Trace; ///< Trace type.
+
+		/** Ctor.
+		 * The tree and the trace must be empty, as only data inserted through the
+		 * wrapper can be erased through it. Sets the trace's size to the tree's.
+		 * @param tree Tree.
+		 * @param trace Trace.
+		 */
+		RecordingLooseOctree( Tree& tree, Trace& trace );
+
+		/** Get tree.
+		 * @return Tree.
+		 */
+		Tree& get_tree();
+
+		/** Get tree.
+		 * @return Tree.
+		 */
+		const Tree& get_tree() const;
+
+		/** Get trace.
+		 * @return Trace.
+		 */
+		const Trace& get_trace() const;
+
+		/** Insert data and record it.
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 * @return Handle.
+		 * @see LooseOctree::insert()
+		 */
+		Handle insert( const T& data, const DataCuboid& cuboid );
+
+		/** Search data and record the query and its number of results.
+		 * @param cuboid Cuboid.
+		 * @param results Results are appended to this array.
+		 * @see LooseOctree::search( const DataCuboid&, DataArray& ) const
+		 */
+		void search( const DataCuboid& cuboid, DataArray& results );
+
+		/** Search data and record the query.
+		 * The number of results is only recorded if the visitor doesn't stop the
+		 * search.
+		 * @param cuboid Cuboid.
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 * @see LooseOctree::search( const DataCuboid&, Visitor&& ) const
+		 */
+		template <class Visitor>
+		bool search( const DataCuboid& cuboid, Visitor&& visitor );
+
+		/** Erase data and record it.
+		 * Erasing invalid handles isn't recorded.
+		 * @param handle Handle.
+		 */
+		void erase( const Handle& handle );
+
+		/** Erase all data occurences in a specific cuboid and record them.
+		 * Records one erasure per erased item. Scans all handles inserted
+		 * through the wrapper, so prefer erase( const Handle& ) where possible.
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 * @see LooseOctree::erase( const T&, const DataCuboid& )
+		 */
+		void erase( const T& data, const DataCuboid& cuboid );
+
+	private:
+		Tree& m_tree;
+		Trace& m_trace;
+		std::vector<uint32_t> m_items; // Item per handle slot index.
+		std::vector<Handle> m_handles; // Last inserted handle per slot index.
+};
+
+}
+
+#include "RecordingLooseOctree.inl"
@@ -0,0 +1,97 @@
+#include <cassert>
+
+namespace util {
+
+template <class T, class DVS, class A>
+RecordingLooseOctree<T, DVS, A>::RecordingLooseOctree( Tree& tree, Trace& trace ) :
+	m_tree( tree ),
+	m_trace( trace )
+{
+	m_trace.set_size( m_tree.get_size() );
+}
+
+template <class T, class DVS, class A>
+typename RecordingLooseOctree<T, DVS, A>::Tree& RecordingLooseOctree<T, DVS, A>::get_tree() {
+	return m_tree;
+}
+
+template <class T, class DVS, class A>
+const typename RecordingLooseOctree<T, DVS, A>::Tree& RecordingLooseOctree<T, DVS, A>::get_tree() const {
+	return m_tree;
+}
+
+template <class T, class DVS, class A>
+const typename RecordingLooseOctree<T, DVS, A>::Trace& RecordingLooseOctree<T, DVS, A>::get_trace() const {
+	return m_trace;
+}
+
+template <class T, class DVS, class A>
+typename RecordingLooseOctree<T, DVS, A>::Handle RecordingLooseOctree<T, DVS, A>::insert( const T& data, const DataCuboid& cuboid ) {
+	Handle handle = m_tree.insert( data, cuboid );
+
+	if( handle.index >= m_items.size() ) {
+		m_items.resize( handle.index + 1 );
+		m_handles.resize( handle.index + 1 );
+	}
+
+	m_items[handle.index] = m_trace.record_insert( cuboid );
+	m_handles[handle.index] = handle;
+	return handle;
+}
+
+template <class T, class DVS, class A>
+void RecordingLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, DataArray& results ) {
+	std::size_t num_results = results.size();
+
+	m_tree.search( cuboid, results );
+	m_trace.record_search( cuboid, static_cast<uint32_t>( results.size() - num_results ) );
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool RecordingLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, Visitor&& visitor ) {
+	uint32_t num_results = 0;
+
+	bool completed = m_tree.search(
+		cuboid,
+		[&num_results, &visitor]( const T& data, const DataCuboid& data_cuboid ) -> bool {
+			++num_results;
+			return visitor( data, data_cuboid );
+		}
+	);
+
+	m_trace.record_search( cuboid, completed ? num_results : WORKLOAD_TRACE_UNKNOWN_COUNT );
+	return completed;
+}
+
+template <class T, class DVS, class A>
+void RecordingLooseOctree<T, DVS, A>::erase( const Handle& handle ) {
+	if( !m_tree.is_valid( handle ) ) {
+		return;
+	}
+
+	assert( handle.index < m_items.size() );
+
+	m_trace.record_erase( m_items[handle.index] );
+	m_tree.erase( handle );
+}
+
+template <class T, class DVS, class A>
+void RecordingLooseOctree<T, DVS, A>::erase( const T& data, const DataCuboid& cuboid ) {
+	// Same criteria as LooseOctree::erase( const T&, const DataCuboid& ).
+	for( std::size_t slot_idx = 0; slot_idx < m_handles.size(); ++slot_idx ) {
+		const Handle& handle = m_handles[slot_idx];
+
+		if(
+			m_tree.is_valid( handle ) &&
+			m_tree.get( handle ) == data &&
+			DataCuboid::calc_intersection( m_tree.get_cuboid( handle ), cuboid ).width > 0
+		) {
+			m_trace.record_erase( m_items[slot_idx] );
+		}
+	}
+
+	m_tree.erase( data, cuboid );
+}
+
+}
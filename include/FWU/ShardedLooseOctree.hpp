@@ -0,0 +1,206 @@
+#pragma once
+
+#include <FWU/LooseOctree.hpp>
+#include <FWU/ThreadPool.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace util {
+
+/** Loose octree sharded by region.
+ *
+ * The world is split into cubic regions of equal size. Each region has its own
+ * tree (shard) guarded by its own mutex, so modifications in different regions
+ * run in parallel. Data is routed to the region containing its cuboid's
+ * center. Data bigger than a region in any dimension goes to an extra overflow
+ * shard instead, which keeps data of region shards within the region's loose
+ * bounds.
+ *
+ * Each shard is a tree of full world size that only holds data of its region,
+ * so data is placed at the same depth as in a single tree.
+ *
+ * Searches visit only shards whose region's loose bounds overlap the query,
+ * plus the overflow shard, and merge their results. Sequential searches lock
+ * all visited shards for the whole search, so data moved between shards by a
+ * concurrent update() is neither missed nor reported twice. Parallel searches
+ * lock one shard at a time instead (see search( const DataCuboid&, DataArray&,
+ * ThreadPool& ) const).
+ *
+ * Handles are only invalidated by erase() and by update() moving data to
+ * another shard, which returns a new handle.
+ *
+ *   * T: Data type.
+ *   * DVS: Data vector scalar.
+ *   * Allocator: Allocator used for the shards.
+ */
+template <class T, class DVS = float, class Allocator = std::allocator<T>>
+class ShardedLooseOctree {
+	public:
+		typedef LooseOctree<T, DVS, Allocator> Tree; ///< Shard tree type.
+		typedef typename Tree::Size Size; ///< Size type.
+		typedef typename Tree::DataCuboid DataCuboid; ///< Data cuboid.
+		typedef typename Tree::DataVector DataVector; ///< Data vector.
+		typedef typename Tree::DataArray DataArray; ///< Data array.
+
+		/** Handle of inserted data.
+		 */
+		struct Handle {
+			/** Ctor.
+			 * Initializes an invalid handle.
+			 */
+			Handle();
+
+			/** Equality.
+			 * @param other Other handle.
+			 * @return true if equal.
+			 */
+			bool operator==( const Handle& other ) const;
+
+			/** Unequality.
+			 * @param other Other handle.
+			 * @return true if not equal.
+			 */
+			bool operator!=( const Handle& other ) const;
+
+			uint32_t shard; ///< Shard index.
+			typename Tree::Handle handle; ///< Handle within the shard.
+		};
+
+		/** Ctor.
+		 * @param size Size (must be power of two).
+		 * @param region_size Size of regions (must be power of two, at most size).
+		 * @param allocator Allocator.
+		 */
+		ShardedLooseOctree( Size size, Size region_size, const Allocator& allocator = Allocator() );
+
+		/** Get size.
+		 * @return Size.
+		 */
+		Size get_size() const;
+
+		/** Get size of regions.
+		 * @return Region size.
+		 */
+		Size get_region_size() const;
+
+		/** Get number of shards, including the overflow shard.
+		 * @return Number of shards.
+		 */
+		std::size_t get_num_shards() const;
+
+		/** Get index of the overflow shard.
+		 * @return Shard index.
+		 */
+		std::size_t get_overflow_shard() const;
+
+		/** Get shard that data with a specific cuboid is routed to.
+		 * @param cuboid Cuboid.
+		 * @return Shard index.
+		 */
+		std::size_t get_shard( const DataCuboid& cuboid ) const;
+
+		/** Insert data.
+		 * Locks the target shard only. Undefined behaviour if cuboid is invalid
+		 * (see LooseOctree::insert()).
+		 * @param data Data.
+		 * @param cuboid Cuboid.
+		 * @return Handle.
+		 */
+		Handle insert( const T& data, const DataCuboid& cuboid );
+
+		/** Check if a handle refers to data in the tree.
+		 * @param handle Handle.
+		 * @return true if valid.
+		 */
+		bool is_valid( const Handle& handle ) const;
+
+		/** Get data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Copy of data.
+		 */
+		T get( const Handle& handle ) const;
+
+		/** Get cuboid of data by handle.
+		 * Undefined behaviour if handle is invalid.
+		 * @param handle Handle.
+		 * @return Cuboid.
+		 */
+		DataCuboid get_cuboid( const Handle& handle ) const;
+
+		/** Move data to a new cuboid.
+		 * If the new cuboid is routed to another shard, both shards are locked
+		 * and the data is moved, so searches never miss it. Undefined behaviour if
+		 * handle or cuboid is invalid.
+		 * @param handle Handle.
+		 * @param cuboid New cuboid.
+		 * @return Handle, differs from handle if the data moved to another shard.
+		 */
+		Handle update( const Handle& handle, const DataCuboid& cuboid );
+
+		/** Erase data by handle.
+		 * If the handle is invalid, nothing happens.
+		 * @param handle Handle.
+		 */
+		void erase( const Handle& handle );
+
+		/** Search for data in a specific cuboid.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param results Array for results (not cleared).
+		 */
+		void search( const DataCuboid& cuboid, DataArray& results ) const;
+
+		/** Search for data in a specific cuboid, shards in parallel.
+		 * Each shard is locked only while it is searched, so the pool may also run
+		 * tasks modifying this tree. Data moved between shards by a concurrent
+		 * update() may be missed or reported twice.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param results Array for results (not cleared).
+		 * @param pool Thread pool.
+		 */
+		void search( const DataCuboid& cuboid, DataArray& results, ThreadPool& pool ) const;
+
+		/** Search for data in a specific cuboid without collecting it.
+		 * The visitor is called as bool visitor( const T& data, const DataCuboid&
+		 * cuboid ) for each hit, while the hit's shard is locked. Returning false
+		 * stops the search immediately.
+		 * @param cuboid Cuboid (may be out of bounds).
+		 * @param visitor Visitor.
+		 * @return false if the visitor stopped the search, true otherwise.
+		 */
+		template <class Visitor>
+		bool search( const DataCuboid& cuboid, Visitor&& visitor ) const;
+
+		/** Count all data.
+		 * @return Number of data.
+		 */
+		std::size_t count_all() const;
+
+	private:
+		struct Shard {
+			Shard( Size size, const Allocator& allocator );
+
+			mutable std::mutex mutex;
+			Tree tree;
+		};
+
+		ShardedLooseOctree( const ShardedLooseOctree& ) = delete;
+		ShardedLooseOctree& operator=( const ShardedLooseOctree& ) = delete;
+
+		typedef std::vector<std::unique_lock<std::mutex>> LockArray;
+
+		void lock_shards( const std::vector<std::size_t>& shards, LockArray& locks ) const;
+		void find_shards( const DataCuboid& cuboid, std::vector<std::size_t>& shards ) const;
+
+		std::vector<std::unique_ptr<Shard>> m_shards;
+		Size m_size;
+		Size m_region_size;
+		Size m_regions_per_axis;
+};
+
+}
+
+#include "ShardedLooseOctree.inl"
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace util {
+
+template <class DVS>
+inline void calc_region_range( DVS min, DVS max, DVS region_size, DVS num_regions, DVS& first, DVS& last ) {
+	// Data of region i lies within [(i - 0.5) * region_size, (i + 1.5) *
+	// region_size], so it can only overlap [min, max] if min / region_size - 1.5
+	// < i < max / region_size + 0.5.
+	first = std::max( DVS( 0 ), std::floor( min / region_size - DVS( 1.5 ) ) );
+	last = std::min( num_regions - DVS( 1 ), std::floor( max / region_size + DVS( 0.5 ) ) );
+}
+
+template <class DVS, class Size>
+inline Size calc_region( DVS center, Size region_size, Size num_regions ) {
+	DVS region = std::floor( center / static_cast<DVS>( region_size ) );
+
+	if( region < DVS( 0 ) ) {
+		return 0;
+	}
+	else if( region >= static_cast<DVS>( num_regions ) ) {
+		return num_regions - 1;
+	}
+
+	return static_cast<Size>( region );
+}
+
+///// Handle //////
+
+template <class T, class DVS, class A>
+ShardedLooseOctree<T, DVS, A>::Handle::Handle() :
+	shard( std::numeric_limits<uint32_t>::max() )
+{
+}
+
+template <class T, class DVS, class A>
+bool ShardedLooseOctree<T, DVS, A>::Handle::operator==( const Handle& other ) const {
+	return shard == other.shard && handle == other.handle;
+}
+
+template <class T, class DVS, class A>
+bool ShardedLooseOctree<T, DVS, A>::Handle::operator!=( const Handle& other ) const {
+	return !(*this == other);
+}
+
+///// Shard //////
+
+template <class T, class DVS, class A>
+ShardedLooseOctree<T, DVS, A>::Shard::Shard( Size size, const A& allocator ) :
+	tree( size, allocator )
+{
+}
+
+///// ShardedLooseOctree //////
+
+template <class T, class DVS, class A>
+ShardedLooseOctree<T, DVS, A>::ShardedLooseOctree( Size size, Size region_size, const A& allocator ) :
+	m_size( size ),
+	m_region_size( region_size ),
+	m_regions_per_axis( size / region_size )
+{
+	assert( region_size > 0 && region_size <= size );
+	assert( size % region_size == 0 );
+
+	std::size_t num_shards = static_cast<std::size_t>( m_regions_per_axis ) * m_regions_per_axis * m_regions_per_axis + 1;
+	m_shards.reserve( num_shards );
+
+	for( std::size_t shard_idx = 0; shard_idx < num_shards; ++shard_idx ) {
+		m_shards.push_back( std::unique_ptr<Shard>( new Shard( size, allocator ) ) );
+	}
+}
+
+template <class T, class DVS, class A>
+typename ShardedLooseOctree<T, DVS, A>::Size ShardedLooseOctree<T, DVS, A>::get_size() const {
+	return m_size;
+}
+
+template <class T, class DVS, class A>
+typename ShardedLooseOctree<T, DVS, A>::Size ShardedLooseOctree<T, DVS, A>::get_region_size() const {
+	return m_region_size;
+}
+
+template <class T, class DVS, class A>
+std::size_t ShardedLooseOctree<T, DVS, A>::get_num_shards() const {
+	return m_shards.size();
+}
+
+template <class T, class DVS, class A>
+std::size_t ShardedLooseOctree<T, DVS, A>::get_overflow_shard() const {
+	return m_shards.size() - 1;
+}
+
+template <class T, class DVS, class A>
+std::size_t ShardedLooseOctree<T, DVS, A>::get_shard( const DataCuboid& cuboid ) const {
+	DVS region_size = static_cast<DVS>( m_region_size );
+
+	if( cuboid.width > region_size || cuboid.height > region_size || cuboid.depth > region_size ) {
+		return get_overflow_shard();
+	}
+
+	std::size_t x = calc_region( cuboid.x + cuboid.width / DVS( 2 ), m_region_size, m_regions_per_axis );
+	std::size_t y = calc_region( cuboid.y + cuboid.height / DVS( 2 ), m_region_size, m_regions_per_axis );
+	std::size_t z = calc_region( cuboid.z + cuboid.depth / DVS( 2 ), m_region_size, m_regions_per_axis );
+
+	return x + m_regions_per_axis * (y + m_regions_per_axis * z);
+}
+
+template <class T, class DVS, class A>
+typename ShardedLooseOctree<T, DVS, A>::Handle ShardedLooseOctree<T, DVS, A>::insert( const T& data, const DataCuboid& cuboid ) {
+	std::size_t shard_idx = get_shard( cuboid );
+	Shard& shard = *m_shards[shard_idx];
+
+	Handle handle;
+	handle.shard = static_cast<uint32_t>( shard_idx );
+
+	std::lock_guard<std::mutex> lock( shard.mutex );
+	handle.handle = shard.tree.insert( data, cuboid );
+
+	return handle;
+}
+
+template <class T, class DVS, class A>
+bool ShardedLooseOctree<T, DVS, A>::is_valid( const Handle& handle ) const {
+	if( handle.shard >= m_shards.size() ) {
+		return false;
+	}
+
+	const Shard& shard = *m_shards[handle.shard];
+	std::lock_guard<std::mutex> lock( shard.mutex );
+
+	return shard.tree.is_valid( handle.handle );
+}
+
+template <class T, class DVS, class A>
+T ShardedLooseOctree<T, DVS, A>::get( const Handle& handle ) const {
+	assert( handle.shard < m_shards.size() );
+
+	const Shard& shard = *m_shards[handle.shard];
+	std::lock_guard<std::mutex> lock( shard.mutex );
+
+	return shard.tree.get( handle.handle );
+}
+
+template <class T, class DVS, class A>
+typename ShardedLooseOctree<T, DVS, A>::DataCuboid ShardedLooseOctree<T, DVS, A>::get_cuboid( const Handle& handle ) const {
+	assert( handle.shard < m_shards.size() );
+
+	const Shard& shard = *m_shards[handle.shard];
+	std::lock_guard<std::mutex> lock( shard.mutex );
+
+	return shard.tree.get_cuboid( handle.handle );
+}
+
+template <class T, class DVS, class A>
+typename ShardedLooseOctree<T, DVS, A>::Handle ShardedLooseOctree<T, DVS, A>::update( const Handle& handle, const DataCuboid& cuboid ) {
+	assert( handle.shard < m_shards.size() );
+
+	std::size_t target_idx = get_shard( cuboid );
+	Shard& source = *m_shards[handle.shard];
+
+	if( target_idx == handle.shard ) {
+		std::lock_guard<std::mutex> lock( source.mutex );
+		source.tree.update( handle.handle, cuboid );
+
+		return handle;
+	}
+
+	Shard& target = *m_shards[target_idx];
+
+	// Lock both at once, so searches see the data in exactly one shard and
+	// crossing updates can't deadlock.
+	std::unique_lock<std::mutex> source_lock( source.mutex, std::defer_lock );
+	std::unique_lock<std::mutex> target_lock( target.mutex, std::defer_lock );
+	std::lock( source_lock, target_lock );
+
+	T data = source.tree.get( handle.handle );
+	source.tree.erase( handle.handle );
+
+	Handle moved;
+	moved.shard = static_cast<uint32_t>( target_idx );
+	moved.handle = target.tree.insert( data, cuboid );
+
+	return moved;
+}
+
+template <class T, class DVS, class A>
+void ShardedLooseOctree<T, DVS, A>::erase( const Handle& handle ) {
+	if( handle.shard >= m_shards.size() ) {
+		return;
+	}
+
+	Shard& shard = *m_shards[handle.shard];
+	std::lock_guard<std::mutex> lock( shard.mutex );
+
+	shard.tree.erase( handle.handle );
+}
+
+template <class T, class DVS, class A>
+void ShardedLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, DataArray& results ) const {
+	std::vector<std::size_t> shards;
+	find_shards( cuboid, shards );
+
+	LockArray locks;
+	lock_shards( shards, locks );
+
+	for( std::size_t idx = 0; idx < shards.size(); ++idx ) {
+		m_shards[shards[idx]]->tree.search( cuboid, results );
+	}
+}
+
+template <class T, class DVS, class A>
+void ShardedLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, DataArray& results, ThreadPool& pool ) const {
+	std::vector<std::size_t> shards;
+	find_shards( cuboid, shards );
+
+	// Each task locks its shard only. The calling thread runs queued tasks while
+	// waiting, which may lock shards themselves, so it must not hold any lock.
+	std::vector<DataArray> shard_results( shards.size() );
+
+	pool.parallel_for(
+		0,
+		shards.size(),
+		1,
+		[this, &cuboid, &shards, &shard_results]( std::size_t begin, std::size_t end ) {
+			for( std::size_t idx = begin; idx < end; ++idx ) {
+				const Shard& shard = *m_shards[shards[idx]];
+				std::lock_guard<std::mutex> lock( shard.mutex );
+
+				shard.tree.search( cuboid, shard_results[idx] );
+			}
+		}
+	);
+
+	std::size_t num_results = results.size();
+
+	for( std::size_t idx = 0; idx < shard_results.size(); ++idx ) {
+		num_results += shard_results[idx].size();
+	}
+
+	results.reserve( num_results );
+
+	for( std::size_t idx = 0; idx < shard_results.size(); ++idx ) {
+		results.insert( results.end(), shard_results[idx].begin(), shard_results[idx].end() );
+	}
+}
+
+template <class T, class DVS, class A>
+template <class Visitor>
+bool ShardedLooseOctree<T, DVS, A>::search( const DataCuboid& cuboid, Visitor&& visitor ) const {
+	std::vector<std::size_t> shards;
+	find_shards( cuboid, shards );
+
+	LockArray locks;
+	lock_shards( shards, locks );
+
+	for( std::size_t idx = 0; idx < shards.size(); ++idx ) {
+		if( !m_shards[shards[idx]]->tree.search( cuboid, visitor ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <class T, class DVS, class A>
+std::size_t ShardedLooseOctree<T, DVS, A>::count_all() const {
+	std::size_t num_data = 0;
+
+	for( std::size_t shard_idx = 0; shard_idx < m_shards.size(); ++shard_idx ) {
+		const Shard& shard = *m_shards[shard_idx];
+		std::lock_guard<std::mutex> lock( shard.mutex );
+
+		num_data += shard.tree.count_all();
+	}
+
+	return num_data;
+}
+
+template <class T, class DVS, class A>
+void ShardedLooseOctree<T, DVS, A>::lock_shards( const std::vector<std::size_t>& shards, LockArray& locks ) const {
+	// Shards are sorted, so concurrent searches lock in the same order. update()
+	// locks with std::lock(), which never waits while holding a lock.
+	locks.reserve( shards.size() );
+
+	for( std::size_t idx = 0; idx < shards.size(); ++idx ) {
+		assert( idx == 0 || shards[idx - 1] < shards[idx] );
+		locks.push_back( std::unique_lock<std::mutex>( m_shards[shards[idx]]->mutex ) );
+	}
+}
+
+template <class T, class DVS, class A>
+void ShardedLooseOctree<T, DVS, A>::find_shards( const DataCuboid& cuboid, std::vector<std::size_t>& shards ) const {
+	DVS region_size = static_cast<DVS>( m_region_size );
+	DVS num_regions = static_cast<DVS>( m_regions_per_axis );
+	DVS first_x, last_x, first_y, last_y, first_z, last_z;
+
+	calc_region_range( cuboid.x, cuboid.x + cuboid.width, region_size, num_regions, first_x, last_x );
+	calc_region_range( cuboid.y, cuboid.y + cuboid.height, region_size, num_regions, first_y, last_y );
+	calc_region_range( cuboid.z, cuboid.z + cuboid.depth, region_size, num_regions, first_z, last_z );
+
+	if( first_x <= last_x && first_y <= last_y && first_z <= last_z ) {
+		for( Size z = static_cast<Size>( first_z ); z <= static_cast<Size>( last_z ); ++z ) {
+			for( Size y = static_cast<Size>( first_y ); y <= static_cast<Size>( last_y ); ++y ) {
+				for( Size x = static_cast<Size>( first_x ); x <= static_cast<Size>( last_x ); ++x ) {
+					shards.push_back( x + m_regions_per_axis * (y + m_regions_per_axis * static_cast<std::size_t>( z )) );
+				}
+			}
+		}
+	}
+
+	shards.push_back( get_overflow_shard() );
+}
+
+}
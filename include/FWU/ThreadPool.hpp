@@ -0,0 +1,92 @@
+#pragma once
+
+#include <functional>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace util {
+
+/** Work-stealing thread pool.
+ *
+ * Every worker owns a task queue. Workers take tasks from the back of their own
+ * queue and steal from the front of other queues when theirs runs empty. Tasks
+ * enqueued by a worker go to its own queue, tasks enqueued by other threads
+ * are distributed round-robin.
+ *
+ * Threads waiting for tasks (wait(), parallel_for()) execute queued tasks
+ * themselves instead of blocking, so parallel_for() may be nested.
+ */
+class ThreadPool {
+	public:
+		typedef std::function<void()> Task; ///< Task.
+		typedef std::function<void( std::size_t, std::size_t )> RangeFunction; ///< Range function (begin, end).
+
+		/** Ctor.
+		 * @param num_threads Number of worker threads (0 to use hardware concurrency).
+		 */
+		ThreadPool( std::size_t num_threads = 0 );
+
+		/** Dtor.
+		 * Waits for all tasks to finish.
+		 */
+		~ThreadPool();
+
+		/** Get number of worker threads.
+		 * @return Number of worker threads.
+		 */
+		std::size_t get_num_threads() const;
+
+		/** Enqueue task.
+		 * @param task Task.
+		 */
+		void enqueue( Task task );
+
+		/** Wait until all enqueued tasks have finished.
+		 * The calling thread helps executing tasks. Must not be called from within
+		 * a task.
+		 */
+		void wait();
+
+		/** Call a function for chunks of a range in parallel.
+		 * Returns when all chunks have been processed. The calling thread helps
+		 * executing tasks.
+		 * @param begin Range begin.
+		 * @param end Range end (exclusive).
+		 * @param grain_size Maximum chunk size (0 to choose automatically).
+		 * @param function Function, called with chunk begin and end.
+		 */
+		void parallel_for( std::size_t begin, std::size_t end, std::size_t grain_size, const RangeFunction& function );
+
+	private:
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		ThreadPool( const ThreadPool& ) = delete;
+		ThreadPool& operator=( const ThreadPool& ) = delete;
+
+		void run_worker( std::size_t worker_idx );
+		bool run_one( std::size_t preferred_queue );
+		void finish_task();
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_mutex;
+		std::condition_variable m_task_available;
+		std::condition_variable m_task_finished;
+
+		std::atomic<std::size_t> m_num_queued;
+		std::atomic<std::size_t> m_num_unfinished;
+		std::atomic<std::size_t> m_next_queue;
+		bool m_stop;
+};
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <FWU/Cuboid.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+/** Header of a workload trace.
+ */
+struct WorkloadTraceHeader {
+	char magic[4]; ///< WORKLOAD_TRACE_MAGIC.
+	uint32_t version; ///< WORKLOAD_TRACE_VERSION.
+	uint32_t byte_order; ///< WORKLOAD_TRACE_BYTE_ORDER in the writer's byte order.
+	uint32_t scalar_size; ///< sizeof( DVS ).
+	uint32_t size; ///< Size of the traced tree.
+	uint32_t reserved; ///< Zero.
+};
+
+static const char WORKLOAD_TRACE_MAGIC[4] = { 'F', 'W', 'W', 'T' }; ///< Magic of workload traces.
+static const uint32_t WORKLOAD_TRACE_VERSION = 1; ///< Current format version.
+static const uint32_t WORKLOAD_TRACE_BYTE_ORDER = 0x01020304; ///< Byte order marker.
+static const uint32_t WORKLOAD_TRACE_UNKNOWN_COUNT = 0xffffffff; ///< Number of search results not known.
+
+/** Compact binary log of the operations done on a spatial index.
+ *
+ * Recorded by RecordingLooseOctree from real traffic, a trace can be replayed
+ * against any index implementation to compare them on the same workload.
+ * Traces only hold cuboids: inserted data is numbered in insertion order
+ * (item), erasures refer to that number and searches keep their number of
+ * results, so replay() can detect indices returning different results.
+ *
+ * The bytes start with a WorkloadTraceHeader, followed by one record per
+ * operation:
+ *
+ *   * Insert: type, cuboid.
+ *   * Erase: type, item.
+ *   * Search: type, number of results, cuboid.
+ *
+ *   * DVS: Data vector scalar.
+ */
+template <class DVS = float>
+class WorkloadTrace {
+	public:
+		typedef Cuboid<DVS> DataCuboid; ///< Data cuboid.
+
+		/** Record type.
+		 */
+		enum RecordType {
+			INSERT = 0,
+			ERASE,
+			SEARCH
+		};
+
+		/** Result of replay().
+		 */
+		struct ReplayResult {
+			/** Ctor.
+			 * Initializes everything to zero.
+			 */
+			ReplayResult();
+
+			std::size_t num_inserts; ///< Number of replayed insertions.
+			std::size_t num_erases; ///< Number of replayed erasures.
+			std::size_t num_searches; ///< Number of replayed searches.
+			std::size_t num_mismatches; ///< Number of searches with a different number of results than recorded.
+			uint64_t insert_ns; ///< Nanoseconds spent inserting.
+			uint64_t erase_ns; ///< Nanoseconds spent erasing.
+			uint64_t search_ns; ///< Nanoseconds spent searching.
+		};
+
+		/** Ctor.
+		 * @param size Size of the traced tree.
+		 */
+		WorkloadTrace( uint32_t size = 0 );
+
+		/** Get size of the traced tree.
+		 * @return Size.
+		 */
+		uint32_t get_size() const;
+
+		/** Set size of the traced tree.
+		 * @param size Size.
+		 */
+		void set_size( uint32_t size );
+
+		/** Check if trace has no records.
+		 * @return true if empty.
+		 */
+		bool is_empty() const;
+
+		/** Get number of inserted items.
+		 * @return Number of insertion records.
+		 */
+		uint32_t get_num_items() const;
+
+		/** Get header and records, e.g. to write them to a file.
+		 * @return Pointer to first byte.
+		 */
+		const char* get_bytes() const;
+
+		/** Get size of header and records.
+		 * @return Number of bytes.
+		 */
+		std::size_t get_num_bytes() const;
+
+		/** Replace the trace by bytes returned by get_bytes(), e.g. read from a file.
+		 * The header and all records are checked.
+		 * @param bytes Bytes.
+		 * @param num_bytes Number of bytes.
+		 * @return false if invalid or truncated (trace cleared), true otherwise.
+		 */
+		bool load( const void* bytes, std::size_t num_bytes );
+
+		/** Record insertion.
+		 * @param cuboid Cuboid.
+		 * @return Item of the inserted data.
+		 */
+		uint32_t record_insert( const DataCuboid& cuboid );
+
+		/** Record erasure.
+		 * @param item Item of the erased data, as returned by record_insert().
+		 */
+		void record_erase( uint32_t item );
+
+		/** Record search.
+		 * @param cuboid Searched cuboid.
+		 * @param num_results Number of results or WORKLOAD_TRACE_UNKNOWN_COUNT.
+		 */
+		void record_search( const DataCuboid& cuboid, uint32_t num_results );
+
+		/** Remove all records.
+		 */
+		void clear();
+
+		/** Replay records on an index and time them.
+		 * The index should be empty and at least as big as get_size(). It must
+		 * provide insert( data, cuboid ) returning a handle, erase( handle ) and
+		 * search( cuboid, visitor ) like LooseOctree. Inserted data is the item
+		 * (uint32_t), so the index's data type must be constructible from it.
+		 * Stops at the first erasure of an item not in the index.
+		 * @param index Index (LooseOctree, LinearLooseOctree, ShardedLooseOctree, ...).
+		 * @param result Counts and times, added to.
+		 * @return true if all records were replayed.
+		 */
+		template <class Index>
+		bool replay( Index& index, ReplayResult& result ) const;
+
+	private:
+		struct Record {
+			RecordType type;
+			uint32_t value;
+			DataCuboid cuboid;
+		};
+
+		struct ResultCounter {
+			template <class Data>
+			bool operator()( const Data& data, const DataCuboid& cuboid );
+
+			uint32_t num_results;
+		};
+
+		static std::size_t get_record_size( RecordType type );
+		bool read_record( std::size_t& offset, Record& record ) const;
+		void write_record( RecordType type, uint32_t value, const DataCuboid* cuboid );
+		void write_header( uint32_t size );
+
+		std::vector<char> m_bytes;
+		uint32_t m_num_items;
+};
+
+}
+
+#include "WorkloadTrace.inl"
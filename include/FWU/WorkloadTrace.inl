@@ -0,0 +1,310 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace util {
+
+template <class DVS>
+WorkloadTrace<DVS>::ReplayResult::ReplayResult() :
+	num_inserts( 0 ),
+	num_erases( 0 ),
+	num_searches( 0 ),
+	num_mismatches( 0 ),
+	insert_ns( 0 ),
+	erase_ns( 0 ),
+	search_ns( 0 )
+{
+}
+
+template <class DVS>
+WorkloadTrace<DVS>::WorkloadTrace( uint32_t size ) :
+	m_num_items( 0 )
+{
+	write_header( size );
+}
+
+template <class DVS>
+uint32_t WorkloadTrace<DVS>::get_size() const {
+	uint32_t size = 0;
+	std::memcpy( &size, m_bytes.data() + offsetof( WorkloadTraceHeader, size ), sizeof( uint32_t ) );
+
+	return size;
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::set_size( uint32_t size ) {
+	std::memcpy( m_bytes.data() + offsetof( WorkloadTraceHeader, size ), &size, sizeof( uint32_t ) );
+}
+
+template <class DVS>
+bool WorkloadTrace<DVS>::is_empty() const {
+	return m_bytes.size() == sizeof( WorkloadTraceHeader );
+}
+
+template <class DVS>
+uint32_t WorkloadTrace<DVS>::get_num_items() const {
+	return m_num_items;
+}
+
+template <class DVS>
+const char* WorkloadTrace<DVS>::get_bytes() const {
+	return m_bytes.data();
+}
+
+template <class DVS>
+std::size_t WorkloadTrace<DVS>::get_num_bytes() const {
+	return m_bytes.size();
+}
+
+template <class DVS>
+bool WorkloadTrace<DVS>::load( const void* bytes, std::size_t num_bytes ) {
+	m_bytes.clear();
+	write_header( 0 );
+	m_num_items = 0;
+
+	WorkloadTraceHeader header;
+
+	if( !bytes || num_bytes < sizeof( WorkloadTraceHeader ) ) {
+		return false;
+	}
+
+	std::memcpy( &header, bytes, sizeof( WorkloadTraceHeader ) );
+
+	if(
+		std::memcmp( header.magic, WORKLOAD_TRACE_MAGIC, sizeof( WORKLOAD_TRACE_MAGIC ) ) != 0 ||
+		header.version != WORKLOAD_TRACE_VERSION ||
+		header.byte_order != WORKLOAD_TRACE_BYTE_ORDER ||
+		header.scalar_size != sizeof( DVS )
+	) {
+		return false;
+	}
+
+	const char* first = static_cast<const char*>( bytes );
+	m_bytes.assign( first, first + num_bytes );
+
+	std::size_t offset = sizeof( WorkloadTraceHeader );
+	Record record;
+
+	while( offset < m_bytes.size() ) {
+		if( !read_record( offset, record ) ) {
+			m_bytes.clear();
+			write_header( 0 );
+			m_num_items = 0;
+			return false;
+		}
+
+		if( record.type == INSERT ) {
+			++m_num_items;
+		}
+	}
+
+	return true;
+}
+
+template <class DVS>
+uint32_t WorkloadTrace<DVS>::record_insert( const DataCuboid& cuboid ) {
+	assert( m_num_items < WORKLOAD_TRACE_UNKNOWN_COUNT );
+
+	write_record( INSERT, 0, &cuboid );
+	return m_num_items++;
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::record_erase( uint32_t item ) {
+	assert( item < m_num_items );
+
+	write_record( ERASE, item, nullptr );
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::record_search( const DataCuboid& cuboid, uint32_t num_results ) {
+	write_record( SEARCH, num_results, &cuboid );
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::clear() {
+	uint32_t size = get_size();
+
+	m_bytes.clear();
+	write_header( size );
+	m_num_items = 0;
+}
+
+template <class DVS>
+template <class Index>
+bool WorkloadTrace<DVS>::replay( Index& index, ReplayResult& result ) const {
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<typename Index::Handle> handles( m_num_items );
+	std::vector<bool> inserted( m_num_items, false );
+	uint32_t num_inserted = 0;
+	std::size_t offset = sizeof( WorkloadTraceHeader );
+	Record record;
+	bool replayed = true;
+
+	// Time runs of records of the same type instead of single records, so
+	// reading the clock doesn't dominate short operations.
+	uint64_t* run_ns = nullptr;
+	Clock::time_point run_start = Clock::now();
+
+	while( offset < m_bytes.size() ) {
+		// Records were checked by load() or written by this trace.
+		read_record( offset, record );
+
+		uint64_t* record_ns = &result.search_ns;
+
+		if( record.type == INSERT ) {
+			record_ns = &result.insert_ns;
+		}
+		else if( record.type == ERASE ) {
+			record_ns = &result.erase_ns;
+		}
+
+		if( record_ns != run_ns ) {
+			Clock::time_point now = Clock::now();
+
+			if( run_ns ) {
+				*run_ns += static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now - run_start ).count() );
+			}
+
+			run_ns = record_ns;
+			run_start = now;
+		}
+
+		if( record.type == INSERT ) {
+			uint32_t item = num_inserted++;
+
+			handles[item] = index.insert( item, record.cuboid );
+			inserted[item] = true;
+			++result.num_inserts;
+		}
+		else if( record.type == ERASE ) {
+			if( record.value >= num_inserted || !inserted[record.value] ) {
+				replayed = false;
+				break;
+			}
+
+			index.erase( handles[record.value] );
+			inserted[record.value] = false;
+			++result.num_erases;
+		}
+		else {
+			ResultCounter counter = { 0 };
+			index.search( record.cuboid, counter );
+
+			if( record.value != WORKLOAD_TRACE_UNKNOWN_COUNT && record.value != counter.num_results ) {
+				++result.num_mismatches;
+			}
+
+			++result.num_searches;
+		}
+	}
+
+	if( run_ns ) {
+		*run_ns += static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - run_start ).count() );
+	}
+
+	return replayed;
+}
+
+template <class DVS>
+template <class Data>
+bool WorkloadTrace<DVS>::ResultCounter::operator()( const Data& /*data*/, const DataCuboid& /*cuboid*/ ) {
+	++num_results;
+	return true;
+}
+
+template <class DVS>
+std::size_t WorkloadTrace<DVS>::get_record_size( RecordType type ) {
+	// Type, item or number of results, cuboid.
+	std::size_t size = 1;
+
+	if( type != INSERT ) {
+		size += sizeof( uint32_t );
+	}
+
+	if( type != ERASE ) {
+		size += 6 * sizeof( DVS );
+	}
+
+	return size;
+}
+
+template <class DVS>
+bool WorkloadTrace<DVS>::read_record( std::size_t& offset, Record& record ) const {
+	assert( offset < m_bytes.size() );
+
+	unsigned char type = static_cast<unsigned char>( m_bytes[offset] );
+
+	if( type > SEARCH ) {
+		return false;
+	}
+
+	record.type = static_cast<RecordType>( type );
+
+	std::size_t size = get_record_size( record.type );
+
+	if( size > m_bytes.size() - offset ) {
+		return false;
+	}
+
+	const char* bytes = m_bytes.data() + offset + 1;
+	record.value = 0;
+
+	if( record.type != INSERT ) {
+		std::memcpy( &record.value, bytes, sizeof( uint32_t ) );
+		bytes += sizeof( uint32_t );
+	}
+
+	if( record.type != ERASE ) {
+		DVS components[6];
+		std::memcpy( components, bytes, sizeof( components ) );
+
+		record.cuboid = DataCuboid( components[0], components[1], components[2], components[3], components[4], components[5] );
+	}
+
+	offset += size;
+	return true;
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::write_record( RecordType type, uint32_t value, const DataCuboid* cuboid ) {
+	std::size_t offset = m_bytes.size();
+	m_bytes.resize( offset + get_record_size( type ) );
+
+	char* bytes = m_bytes.data() + offset;
+
+	*bytes = static_cast<char>( type );
+	++bytes;
+
+	if( type != INSERT ) {
+		std::memcpy( bytes, &value, sizeof( uint32_t ) );
+		bytes += sizeof( uint32_t );
+	}
+
+	if( type != ERASE ) {
+		assert( cuboid );
+
+		DVS components[6] = { cuboid->x, cuboid->y, cuboid->z, cuboid->width, cuboid->height, cuboid->depth };
+		std::memcpy( bytes, components, sizeof( components ) );
+	}
+}
+
+template <class DVS>
+void WorkloadTrace<DVS>::write_header( uint32_t size ) {
+	assert( m_bytes.empty() );
+
+	WorkloadTraceHeader header;
+
+	std::memcpy( header.magic, WORKLOAD_TRACE_MAGIC, sizeof( WORKLOAD_TRACE_MAGIC ) );
+	header.version = WORKLOAD_TRACE_VERSION;
+	header.byte_order = WORKLOAD_TRACE_BYTE_ORDER;
+	header.scalar_size = static_cast<uint32_t>( sizeof( DVS ) );
+	header.size = size;
+	header.reserved = 0;
+
+	const char* first = reinterpret_cast<const char*>( &header );
+	m_bytes.assign( first, first + sizeof( WorkloadTraceHeader ) );
+}
+
+}
@@ -0,0 +1,82 @@
+#include <FWU/EpochManager.hpp>
+
+#include <functional>
+#include <limits>
+#include <thread>
+#include <cassert>
+
+namespace util {
+
+EpochManager::EpochManager( std::size_t num_slots ) :
+	m_slots( new Slot[num_slots] ),
+	m_num_slots( num_slots ),
+	m_epoch( 1 )
+{
+	assert( num_slots > 0 );
+
+	for( std::size_t slot_idx = 0; slot_idx < m_num_slots; ++slot_idx ) {
+		m_slots[slot_idx].epoch.store( 0 );
+	}
+}
+
+std::size_t EpochManager::get_num_slots() const {
+	return m_num_slots;
+}
+
+uint64_t EpochManager::get_epoch() const {
+	return m_epoch.load();
+}
+
+std::size_t EpochManager::pin() {
+	// Start at a per-thread slot, so threads rarely compete for the same one.
+	std::size_t first_slot = std::hash<std::thread::id>()( std::this_thread::get_id() ) % m_num_slots;
+
+	for( ;; ) {
+		// A stale epoch is fine, it only delays reclamation. The slot must be set
+		// before the reader loads any shared pointer, which sequentially
+		// consistent operations guarantee.
+		uint64_t epoch = m_epoch.load();
+
+		for( std::size_t offset = 0; offset < m_num_slots; ++offset ) {
+			std::size_t slot_idx = (first_slot + offset) % m_num_slots;
+			uint64_t expected = 0;
+
+			if(
+				m_slots[slot_idx].epoch.load( std::memory_order_relaxed ) == 0 &&
+				m_slots[slot_idx].epoch.compare_exchange_strong( expected, epoch )
+			) {
+				return slot_idx;
+			}
+		}
+
+		std::this_thread::yield();
+	}
+}
+
+void EpochManager::unpin( std::size_t slot ) {
+	assert( slot < m_num_slots );
+	assert( m_slots[slot].epoch.load( std::memory_order_relaxed ) != 0 );
+
+	// Release: the reader's accesses happen before reclamation.
+	m_slots[slot].epoch.store( 0, std::memory_order_release );
+}
+
+uint64_t EpochManager::advance() {
+	return m_epoch.fetch_add( 1 );
+}
+
+uint64_t EpochManager::get_min_pinned_epoch() const {
+	uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+
+	for( std::size_t slot_idx = 0; slot_idx < m_num_slots; ++slot_idx ) {
+		uint64_t epoch = m_slots[slot_idx].epoch.load();
+
+		if( epoch != 0 && epoch < min_epoch ) {
+			min_epoch = epoch;
+		}
+	}
+
+	return min_epoch;
+}
+
+}
@@ -0,0 +1,203 @@
+#include <FWU/ThreadPool.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Pool and queue index of the current thread if it's a worker.
+thread_local const util::ThreadPool* current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}
+
+namespace util {
+
+ThreadPool::ThreadPool( std::size_t num_threads ) :
+	m_num_queued( 0 ),
+	m_num_unfinished( 0 ),
+	m_next_queue( 0 ),
+	m_stop( false )
+{
+	if( num_threads == 0 ) {
+		num_threads = std::max( std::thread::hardware_concurrency(), 1u );
+	}
+
+	for( std::size_t queue_idx = 0; queue_idx < num_threads; ++queue_idx ) {
+		m_queues.push_back( std::unique_ptr<Queue>( new Queue ) );
+	}
+
+	for( std::size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx ) {
+		m_threads.push_back( std::thread( &ThreadPool::run_worker, this, thread_idx ) );
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stop = true;
+	}
+
+	m_task_available.notify_all();
+
+	for( std::size_t thread_idx = 0; thread_idx < m_threads.size(); ++thread_idx ) {
+		m_threads[thread_idx].join();
+	}
+}
+
+std::size_t ThreadPool::get_num_threads() const {
+	return m_threads.size();
+}
+
+void ThreadPool::enqueue( Task task ) {
+	assert( task );
+
+	// Workers keep their own tasks local, others are distributed.
+	std::size_t queue_idx = (
+		current_pool == this ?
+		current_worker :
+		m_next_queue.fetch_add( 1 ) % m_queues.size()
+	);
+
+	++m_num_unfinished;
+
+	{
+		// Counted before the task is visible, so run_one() can't decrement first,
+		// and under the lock, so sleeping workers can't miss the task.
+		std::lock_guard<std::mutex> lock( m_mutex );
+		++m_num_queued;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_queues[queue_idx]->mutex );
+		m_queues[queue_idx]->tasks.push_back( std::move( task ) );
+	}
+
+	m_task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+	assert( current_pool != this && "Waiting for all tasks from within a task never finishes." );
+
+	while( m_num_unfinished > 0 ) {
+		if( run_one( 0 ) ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_task_finished.wait( lock, [this]() { return m_num_unfinished == 0; } );
+	}
+}
+
+void ThreadPool::parallel_for( std::size_t begin, std::size_t end, std::size_t grain_size, const RangeFunction& function ) {
+	if( begin >= end ) {
+		return;
+	}
+
+	std::size_t num_items = end - begin;
+
+	if( grain_size == 0 ) {
+		grain_size = std::max( num_items / (m_queues.size() * 4), static_cast<std::size_t>( 1 ) );
+	}
+
+	std::size_t num_chunks = (num_items + grain_size - 1) / grain_size;
+
+	if( num_chunks == 1 ) {
+		function( begin, end );
+		return;
+	}
+
+	std::atomic<std::size_t> num_remaining( num_chunks );
+
+	for( std::size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain_size ) {
+		std::size_t chunk_end = std::min( chunk_begin + grain_size, end );
+
+		enqueue(
+			[this, &function, &num_remaining, chunk_begin, chunk_end]() {
+				function( chunk_begin, chunk_end );
+
+				if( --num_remaining == 0 ) {
+					std::lock_guard<std::mutex> lock( m_mutex );
+					m_task_finished.notify_all();
+				}
+			}
+		);
+	}
+
+	// Help out until all chunks are done.
+	std::size_t preferred_queue = current_pool == this ? current_worker : 0;
+
+	while( num_remaining > 0 ) {
+		if( run_one( preferred_queue ) ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_task_finished.wait( lock, [&num_remaining]() { return num_remaining == 0; } );
+	}
+}
+
+void ThreadPool::run_worker( std::size_t worker_idx ) {
+	current_pool = this;
+	current_worker = worker_idx;
+
+	while( true ) {
+		if( run_one( worker_idx ) ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_task_available.wait( lock, [this]() { return m_stop || m_num_queued > 0; } );
+
+		if( m_stop && m_num_queued == 0 ) {
+			return;
+		}
+	}
+}
+
+bool ThreadPool::run_one( std::size_t preferred_queue ) {
+	Task task;
+	std::size_t num_queues = m_queues.size();
+
+	// Newest task of the preferred queue first, then steal the oldest task of
+	// the others.
+	for( std::size_t offset = 0; offset < num_queues && !task; ++offset ) {
+		Queue& queue = *m_queues[(preferred_queue + offset) % num_queues];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+
+		if( queue.tasks.empty() ) {
+			continue;
+		}
+
+		if( offset == 0 ) {
+			task = std::move( queue.tasks.back() );
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move( queue.tasks.front() );
+			queue.tasks.pop_front();
+		}
+	}
+
+	if( !task ) {
+		return false;
+	}
+
+	--m_num_queued;
+
+	task();
+	finish_task();
+
+	return true;
+}
+
+void ThreadPool::finish_task() {
+	if( --m_num_unfinished == 0 ) {
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_task_finished.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,291 @@
+#include <FWU/ChangeJournal.hpp>
+#include <FWU/FrozenLooseOctree.hpp>
+#include <FWU/LooseOctree.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+BOOST_AUTO_TEST_CASE( TestChangeJournal ) {
+	BOOST_MESSAGE( "Testing change journal..." );
+
+	using namespace util;
+
+	typedef LooseOctree<int> IntOctree;
+	typedef FrozenLooseOctree<int> FrozenIntOctree;
+	typedef ChangeJournal<int> IntJournal;
+
+	static const IntOctree::Size TREE_SIZE = 256;
+
+	uint32_t seed = 1234;
+
+	auto random_cuboid = [&seed]() -> IntOctree::DataCuboid {
+		seed = seed * 1664525u + 1013904223u;
+		float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 4.0f;
+		seed = seed * 1664525u + 1013904223u;
+		float x = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+		seed = seed * 1664525u + 1013904223u;
+		float y = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+		seed = seed * 1664525u + 1013904223u;
+		float z = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+
+		return IntOctree::DataCuboid( x - size / 2, y - size / 2, z - size / 2, size, size, size / 2 );
+	};
+
+	// Checks data, cuboids and handles of two trees are equal.
+	auto check_equal = []( const IntOctree& tree, const IntOctree& other, const std::vector<IntOctree::Handle>& handles ) {
+		BOOST_REQUIRE( tree.count_all() == other.count_all() );
+
+		for( std::size_t handle_idx = 0; handle_idx < handles.size(); ++handle_idx ) {
+			const IntOctree::Handle& handle = handles[handle_idx];
+
+			BOOST_REQUIRE( tree.is_valid( handle ) == other.is_valid( handle ) );
+
+			if( tree.is_valid( handle ) ) {
+				BOOST_REQUIRE( tree.get( handle ) == other.get( handle ) );
+				BOOST_REQUIRE( tree.get_cuboid( handle ) == other.get_cuboid( handle ) );
+			}
+		}
+
+		IntOctree::DataArray results;
+		IntOctree::DataArray expected;
+
+		other.search( IntOctree::DataCuboid( 10, 20, 30, 100, 100, 100 ), results );
+		tree.search( IntOctree::DataCuboid( 10, 20, 30, 100, 100, 100 ), expected );
+
+		std::sort( results.begin(), results.end() );
+		std::sort( expected.begin(), expected.end() );
+
+		BOOST_CHECK( results == expected );
+	};
+
+	// Modifies the tree and returns all handles ever returned.
+	auto churn = [&random_cuboid]( IntOctree& tree, std::vector<IntOctree::Handle>& handles, int first_data ) {
+		for( int data = first_data; data < first_data + 500; ++data ) {
+			handles.push_back( tree.insert( data, random_cuboid() ) );
+		}
+
+		for( std::size_t handle_idx = 0; handle_idx < handles.size(); handle_idx += 4 ) {
+			tree.erase( handles[handle_idx] );
+		}
+
+		for( std::size_t handle_idx = 1; handle_idx < handles.size(); handle_idx += 3 ) {
+			if( tree.is_valid( handles[handle_idx] ) ) {
+				tree.update( handles[handle_idx], random_cuboid() );
+				tree.update( handles[handle_idx], random_cuboid() );
+			}
+		}
+
+		// Erasing by data records the erased handles, too.
+		tree.erase( first_data + 1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ) );
+
+		// Reuses erased slots.
+		std::vector<std::pair<int, IntOctree::DataCuboid>> items;
+
+		for( int data = first_data + 500; data < first_data + 700; ++data ) {
+			items.push_back( std::make_pair( data, random_cuboid() ) );
+		}
+
+		std::size_t num_handles = handles.size();
+		handles.resize( num_handles + items.size() );
+		tree.build( items.begin(), items.end(), &handles[num_handles] );
+	};
+
+	// Record types.
+	{
+		IntOctree tree( TREE_SIZE );
+		IntJournal journal;
+
+		BOOST_CHECK( tree.get_journal() == nullptr );
+		BOOST_CHECK( journal.is_empty() );
+
+		tree.set_journal( &journal );
+		BOOST_CHECK( tree.get_journal() == &journal );
+
+		IntOctree::Handle handle = tree.insert( 5, IntOctree::DataCuboid( 1, 2, 3, 4, 5, 6 ) );
+		std::size_t insert_size = journal.get_num_bytes();
+
+		tree.update( handle, IntOctree::DataCuboid( 100, 2, 3, 4, 5, 6 ) );
+		std::size_t update_size = journal.get_num_bytes() - insert_size;
+
+		tree.erase( handle );
+		std::size_t erase_size = journal.get_num_bytes() - insert_size - update_size;
+
+		BOOST_CHECK( insert_size == 9 + 6 * sizeof( float ) + sizeof( int ) );
+		BOOST_CHECK( update_size == 9 + 6 * sizeof( float ) );
+		BOOST_CHECK( erase_size == 9 );
+
+		// Erasing invalid handles isn't recorded.
+		tree.erase( handle );
+		BOOST_CHECK( journal.get_num_bytes() == insert_size + update_size + erase_size );
+
+		// Stops recording.
+		tree.set_journal( nullptr );
+		IntOctree::Handle unrecorded = tree.insert( 6, IntOctree::DataCuboid( 1, 2, 3, 4, 5, 6 ) );
+		BOOST_CHECK( journal.get_num_bytes() == insert_size + update_size + erase_size );
+
+		IntOctree other( TREE_SIZE );
+
+		BOOST_CHECK( journal.replay( other ) );
+		BOOST_CHECK( other.count_all() == 0 );
+		BOOST_CHECK( other.insert( 6, IntOctree::DataCuboid( 1, 2, 3, 4, 5, 6 ) ) == unrecorded );
+
+		journal.clear();
+		BOOST_CHECK( journal.is_empty() );
+	}
+
+	// Snapshot plus journal restores the tree.
+	{
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+
+		churn( tree, handles, 0 );
+
+		std::vector<char> snapshot;
+		tree.serialize( snapshot );
+
+		IntJournal journal;
+		tree.set_journal( &journal );
+
+		churn( tree, handles, 1000 );
+
+		FrozenIntOctree frozen;
+		IntOctree restored( TREE_SIZE );
+
+		BOOST_REQUIRE( frozen.load( snapshot.data(), snapshot.size() ) );
+		restored.assign( frozen );
+
+		// Applies to the snapshot's state only.
+		IntOctree empty( TREE_SIZE );
+		BOOST_CHECK( journal.replay( empty ) == false );
+
+		BOOST_REQUIRE( journal.replay( restored ) );
+		check_equal( tree, restored, handles );
+
+		// Both trees hand out the same handles.
+		for( int data = 0; data < 100; ++data ) {
+			IntOctree::DataCuboid cuboid = random_cuboid();
+			BOOST_CHECK( tree.insert( data, cuboid ) == restored.insert( data, cuboid ) );
+		}
+
+		// Truncated records are detected.
+		IntJournal truncated;
+		truncated.append( journal.get_bytes(), journal.get_num_bytes() - 1 );
+
+		restored.assign( frozen );
+		BOOST_CHECK( truncated.replay( restored ) == false );
+		BOOST_CHECK( truncated.compact() == false );
+		BOOST_CHECK( truncated.get_num_bytes() == journal.get_num_bytes() - 1 );
+	}
+
+	// Concatenated journals.
+	{
+		IntOctree tree( TREE_SIZE );
+		IntOctree restored( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		IntJournal first;
+		IntJournal second;
+
+		tree.set_journal( &first );
+		churn( tree, handles, 0 );
+
+		tree.set_journal( &second );
+		churn( tree, handles, 1000 );
+
+		IntJournal loaded;
+		loaded.append( first.get_bytes(), first.get_num_bytes() );
+		loaded.append( second.get_bytes(), second.get_num_bytes() );
+
+		BOOST_REQUIRE( loaded.replay( restored ) );
+		check_equal( tree, restored, handles );
+	}
+
+	// Compaction.
+	{
+		IntOctree tree( TREE_SIZE );
+		IntOctree restored( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		IntJournal journal;
+
+		tree.set_journal( &journal );
+		churn( tree, handles, 0 );
+
+		// Many updates of the same data.
+		for( int update_idx = 0; update_idx < 100; ++update_idx ) {
+			for( std::size_t handle_idx = 0; handle_idx < 10; ++handle_idx ) {
+				if( tree.is_valid( handles[handle_idx] ) ) {
+					tree.update( handles[handle_idx], random_cuboid() );
+				}
+			}
+		}
+
+		std::size_t num_bytes = journal.get_num_bytes();
+
+		BOOST_CHECK( journal.compact() );
+		BOOST_CHECK( journal.get_num_bytes() < num_bytes );
+
+		// Compacting again changes nothing.
+		num_bytes = journal.get_num_bytes();
+		BOOST_CHECK( journal.compact() );
+		BOOST_CHECK( journal.get_num_bytes() == num_bytes );
+
+		BOOST_REQUIRE( journal.replay( restored ) );
+		check_equal( tree, restored, handles );
+	}
+
+	// Checkpointing in the background while the tree keeps changing.
+	{
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		std::vector<char> snapshot;
+		IntJournal journal;
+
+		tree.serialize( snapshot );
+		tree.set_journal( &journal );
+
+		for( int round = 0; round < 3; ++round ) {
+			churn( tree, handles, round * 1000 );
+
+			// Detach the records, recording continues into the emptied journal.
+			IntJournal pending;
+			pending.swap( journal );
+
+			std::vector<char> next_snapshot;
+			bool checkpointed = false;
+
+			std::thread checkpoint(
+				[&snapshot, &pending, &next_snapshot, &checkpointed]() {
+					FrozenIntOctree frozen;
+					IntOctree restored( TREE_SIZE );
+
+					if( !pending.compact() || !frozen.load( snapshot.data(), snapshot.size() ) ) {
+						return;
+					}
+
+					restored.assign( frozen );
+
+					if( pending.replay( restored ) ) {
+						restored.serialize( next_snapshot );
+						checkpointed = true;
+					}
+				}
+			);
+
+			churn( tree, handles, round * 1000 + 500 );
+			checkpoint.join();
+
+			BOOST_REQUIRE( checkpointed );
+			snapshot.swap( next_snapshot );
+		}
+
+		FrozenIntOctree frozen;
+		IntOctree restored( TREE_SIZE );
+
+		BOOST_REQUIRE( frozen.load( snapshot.data(), snapshot.size() ) );
+		restored.assign( frozen );
+
+		BOOST_REQUIRE( journal.replay( restored ) );
+		check_equal( tree, restored, handles );
+	}
+}
@@ -0,0 +1,151 @@
+#include <FWU/ConcurrentLooseOctree.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestConcurrentLooseOctree ) {
+	BOOST_MESSAGE( "Testing concurrent loose octree..." );
+
+	using namespace util;
+
+	typedef ConcurrentLooseOctree<int> IntOctree;
+
+	// Changes are visible after publishing.
+	{
+		IntOctree tree( 64 );
+
+		BOOST_CHECK( tree.read()->count_all() == 0 );
+
+		IntOctree::Tree::Handle handle = tree.get_tree().insert( 5, IntOctree::Tree::DataCuboid( 1, 2, 3, 4, 4, 4 ) );
+		tree.get_tree().insert( 6, IntOctree::Tree::DataCuboid( 40, 40, 40, 1, 1, 1 ) );
+
+		BOOST_CHECK( tree.read()->count_all() == 0 );
+
+		tree.publish();
+
+		IntOctree::ReadGuard guard = tree.read();
+
+		BOOST_CHECK( guard->count_all() == 2 );
+		BOOST_CHECK( guard->is_valid( handle ) );
+		BOOST_CHECK( guard->get( handle ) == 5 );
+		BOOST_CHECK( guard.get_tree().get_cuboid( handle ) == IntOctree::Tree::DataCuboid( 1, 2, 3, 4, 4, 4 ) );
+
+		IntOctree::Tree::DataArray results;
+		guard->search( IntOctree::Tree::DataCuboid( 0, 0, 0, 10, 10, 10 ), results );
+
+		BOOST_CHECK( results == IntOctree::Tree::DataArray( 1, 5 ) );
+	}
+
+	// Snapshots stay alive while pinned.
+	{
+		IntOctree tree( 64 );
+
+		{
+			IntOctree::ReadGuard guard = tree.read();
+
+			tree.get_tree().insert( 1, IntOctree::Tree::DataCuboid( 1, 1, 1, 1, 1, 1 ) );
+			tree.publish();
+			tree.get_tree().insert( 2, IntOctree::Tree::DataCuboid( 2, 2, 2, 1, 1, 1 ) );
+			tree.publish();
+
+			BOOST_CHECK( tree.get_num_retired() == 2 );
+			BOOST_CHECK( guard->count_all() == 0 );
+
+			// Moved guards keep the pin.
+			IntOctree::ReadGuard moved( std::move( guard ) );
+			tree.publish();
+
+			BOOST_CHECK( tree.get_num_retired() == 3 );
+			BOOST_CHECK( moved->count_all() == 0 );
+			BOOST_CHECK( tree.read()->count_all() == 2 );
+		}
+
+		tree.publish();
+
+		BOOST_CHECK( tree.get_num_retired() == 1 );
+		BOOST_CHECK( tree.read()->count_all() == 2 );
+	}
+
+	// Readers search while the writer modifies and publishes.
+	{
+		static const std::size_t NUM_READERS = 4;
+		static const int NUM_ROUNDS = 200;
+
+		IntOctree tree( 128 );
+		std::atomic<bool> stop( false );
+		std::atomic<std::size_t> num_errors( 0 );
+		std::atomic<std::size_t> num_reads( 0 );
+		std::vector<std::thread> readers;
+
+		for( std::size_t reader_idx = 0; reader_idx < NUM_READERS; ++reader_idx ) {
+			readers.push_back(
+				std::thread(
+					[&tree, &stop, &num_errors, &num_reads]() {
+						std::size_t last_count = 0;
+
+						while( !stop ) {
+							IntOctree::ReadGuard guard = tree.read();
+							IntOctree::Tree::DataArray results;
+
+							guard->search( IntOctree::Tree::DataCuboid( 0, 0, 0, 128, 128, 128 ), results );
+
+							// Every round adds 5 data, nothing is seen half done.
+							if( results.size() % 5 != 0 || results.size() < last_count || results.size() != guard->count_all() ) {
+								++num_errors;
+							}
+
+							last_count = results.size();
+							++num_reads;
+						}
+					}
+				)
+			);
+		}
+
+		std::vector<IntOctree::Tree::Handle> handles;
+		uint32_t seed = 42;
+
+		for( int round = 0; round < NUM_ROUNDS; ++round ) {
+			for( int data = 0; data < 10; ++data ) {
+				seed = seed * 1664525u + 1013904223u;
+				float x = static_cast<float>( (seed >> 8) % 120 );
+				seed = seed * 1664525u + 1013904223u;
+				float y = static_cast<float>( (seed >> 8) % 120 );
+				seed = seed * 1664525u + 1013904223u;
+				float z = static_cast<float>( (seed >> 8) % 120 );
+
+				handles.push_back( tree.get_tree().insert( round * 10 + data, IntOctree::Tree::DataCuboid( x, y, z, 2, 2, 2 ) ) );
+			}
+
+			// Erasing cleans up nodes readers of older snapshots might be in.
+			for( int data = 0; data < 5; ++data ) {
+				tree.get_tree().erase( handles.back() );
+				handles.pop_back();
+			}
+
+			tree.publish();
+		}
+
+		// Let readers see the final state.
+		while( num_reads < NUM_READERS * 10 ) {
+			std::this_thread::yield();
+		}
+
+		stop = true;
+
+		for( std::size_t reader_idx = 0; reader_idx < NUM_READERS; ++reader_idx ) {
+			readers[reader_idx].join();
+		}
+
+		BOOST_CHECK( num_errors == 0 );
+		BOOST_CHECK( tree.read()->count_all() == NUM_ROUNDS * 5 );
+
+		// Preempted readers may have held any number of snapshots. Without
+		// readers, publishing recycles all but the one just replaced.
+		tree.publish();
+
+		BOOST_CHECK( tree.get_num_retired() == 1 );
+	}
+}
@@ -0,0 +1,83 @@
+#include <FWU/Distance.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+
+BOOST_AUTO_TEST_CASE( TestDistance ) {
+	BOOST_MESSAGE( "Testing distance..." );
+
+	using namespace util;
+
+	static const float TOLERANCE = 0.0001f;
+
+	sf::Vector3f box_min( 0, 0, 0 );
+	sf::Vector3f box_max( 2, 4, 6 );
+
+	// Point and box.
+	{
+		BOOST_CHECK( calc_squared_distance_point_box( sf::Vector3f( 1, 2, 3 ), box_min, box_max ) == 0 );
+		BOOST_CHECK( calc_squared_distance_point_box( sf::Vector3f( 2, 4, 6 ), box_min, box_max ) == 0 );
+		BOOST_CHECK( calc_squared_distance_point_box( sf::Vector3f( -3, 2, 3 ), box_min, box_max ) == 9 );
+		BOOST_CHECK( calc_squared_distance_point_box( sf::Vector3f( 3, 5, 7 ), box_min, box_max ) == 3 );
+		BOOST_CHECK( calc_squared_distance_point_box( sf::Vector3f( -1, 6, 3 ), box_min, box_max ) == 5 );
+	}
+
+	// Point and segment.
+	{
+		sf::Vector3f start( 0, 0, 0 );
+		sf::Vector3f end( 10, 0, 0 );
+
+		BOOST_CHECK( calc_squared_distance_point_segment( sf::Vector3f( 5, 3, 0 ), start, end ) == 9 );
+		BOOST_CHECK( calc_squared_distance_point_segment( sf::Vector3f( -2, 0, 0 ), start, end ) == 4 );
+		BOOST_CHECK( calc_squared_distance_point_segment( sf::Vector3f( 13, 4, 0 ), start, end ) == 25 );
+		BOOST_CHECK( calc_squared_distance_point_segment( sf::Vector3f( 1, 2, 2 ), start, start ) == 9 );
+	}
+
+	// Segment and box.
+	{
+		// Through the box.
+		BOOST_CHECK( calc_squared_distance_segment_box( sf::Vector3f( -5, 2, 3 ), sf::Vector3f( 5, 2, 3 ), box_min, box_max ) == 0 );
+
+		// Parallel to a face.
+		BOOST_CHECK( calc_squared_distance_segment_box( sf::Vector3f( -5, 6, 3 ), sf::Vector3f( 5, 6, 3 ), box_min, box_max ) == 4 );
+
+		// Passing an edge diagonally: closest at x = 3, y = 5.
+		BOOST_CHECK( std::abs( calc_squared_distance_segment_box( sf::Vector3f( 0, 8, 3 ), sf::Vector3f( 6, 2, 3 ), box_min, box_max ) - 2 ) < TOLERANCE );
+
+		// Ending before the box.
+		BOOST_CHECK( calc_squared_distance_segment_box( sf::Vector3f( -10, 2, 3 ), sf::Vector3f( -3, 2, 3 ), box_min, box_max ) == 9 );
+
+		// Degenerate segment.
+		BOOST_CHECK( calc_squared_distance_segment_box( sf::Vector3f( 3, 5, 7 ), sf::Vector3f( 3, 5, 7 ), box_min, box_max ) == 3 );
+	}
+
+	// Segment and box, against dense sampling.
+	{
+		uint32_t seed = 4711;
+
+		for( int segment_idx = 0; segment_idx < 500; ++segment_idx ) {
+			float coords[6];
+
+			for( std::size_t coord_idx = 0; coord_idx < 6; ++coord_idx ) {
+				seed = seed * 1664525u + 1013904223u;
+				coords[coord_idx] = static_cast<float>( (seed >> 8) % 2000 ) / 100.0f - 7.0f;
+			}
+
+			sf::Vector3f start( coords[0], coords[1], coords[2] );
+			sf::Vector3f end( coords[3], coords[4], coords[5] );
+
+			float distance = calc_squared_distance_segment_box( start, end, box_min, box_max );
+			float sampled = calc_squared_distance_point_box( start, box_min, box_max );
+
+			for( int step = 1; step <= 2000; ++step ) {
+				float t = static_cast<float>( step ) / 2000.0f;
+				sampled = std::min( sampled, calc_squared_distance_point_box( start + (end - start) * t, box_min, box_max ) );
+			}
+
+			// Never above the sampled minimum, and not much below.
+			BOOST_CHECK( distance <= sampled + TOLERANCE );
+			BOOST_CHECK( std::sqrt( sampled ) - std::sqrt( distance ) < 0.02f );
+		}
+	}
+}
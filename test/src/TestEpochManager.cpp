@@ -0,0 +1,111 @@
+#include <FWU/EpochManager.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+BOOST_AUTO_TEST_CASE( TestEpochManager ) {
+	BOOST_MESSAGE( "Testing epoch manager..." );
+
+	using namespace util;
+
+	static const uint64_t NOTHING_PINNED = std::numeric_limits<uint64_t>::max();
+
+	// Initial state.
+	{
+		EpochManager epochs( 8 );
+
+		BOOST_CHECK( epochs.get_num_slots() == 8 );
+		BOOST_CHECK( epochs.get_epoch() == 1 );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == NOTHING_PINNED );
+	}
+
+	// Pin, advance and unpin.
+	{
+		EpochManager epochs( 8 );
+
+		std::size_t first = epochs.pin();
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == 1 );
+
+		BOOST_CHECK( epochs.advance() == 1 );
+		BOOST_CHECK( epochs.get_epoch() == 2 );
+
+		std::size_t second = epochs.pin();
+		BOOST_CHECK( second != first );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == 1 );
+
+		epochs.unpin( first );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == 2 );
+
+		epochs.unpin( second );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == NOTHING_PINNED );
+	}
+
+	// Readers wait for a free slot.
+	{
+		EpochManager epochs( 1 );
+		std::atomic<bool> pinned( false );
+
+		std::size_t slot = epochs.pin();
+
+		std::thread reader(
+			[&epochs, &pinned]() {
+				std::size_t reader_slot = epochs.pin();
+				pinned = true;
+				epochs.unpin( reader_slot );
+			}
+		);
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+		BOOST_CHECK( pinned == false );
+
+		epochs.unpin( slot );
+		reader.join();
+
+		BOOST_CHECK( pinned == true );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == NOTHING_PINNED );
+	}
+
+	// Pinned epochs never exceed the current one.
+	{
+		static const std::size_t NUM_READERS = 4;
+
+		EpochManager epochs( 4 );
+		std::atomic<bool> stop( false );
+		std::atomic<std::size_t> num_errors( 0 );
+		std::vector<std::thread> readers;
+
+		for( std::size_t reader_idx = 0; reader_idx < NUM_READERS; ++reader_idx ) {
+			readers.push_back(
+				std::thread(
+					[&epochs, &stop, &num_errors]() {
+						while( !stop ) {
+							std::size_t slot = epochs.pin();
+
+							if( epochs.get_min_pinned_epoch() > epochs.get_epoch() ) {
+								++num_errors;
+							}
+
+							epochs.unpin( slot );
+						}
+					}
+				)
+			);
+		}
+
+		for( int advance_idx = 0; advance_idx < 10000; ++advance_idx ) {
+			epochs.advance();
+		}
+
+		stop = true;
+
+		for( std::size_t reader_idx = 0; reader_idx < NUM_READERS; ++reader_idx ) {
+			readers[reader_idx].join();
+		}
+
+		BOOST_CHECK( num_errors == 0 );
+		BOOST_CHECK( epochs.get_epoch() == 10001 );
+		BOOST_CHECK( epochs.get_min_pinned_epoch() == NOTHING_PINNED );
+	}
+}
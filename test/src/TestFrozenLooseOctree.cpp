@@ -0,0 +1,195 @@
+#include <FWU/FrozenLooseOctree.hpp>
+#include <FWU/LooseOctree.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstring>
+
+BOOST_AUTO_TEST_CASE( TestFrozenLooseOctree ) {
+	BOOST_MESSAGE( "Testing frozen loose octree..." );
+
+	using namespace util;
+
+	typedef LooseOctree<int> IntOctree;
+	typedef FrozenLooseOctree<int> FrozenIntOctree;
+
+	// Empty view.
+	{
+		FrozenIntOctree frozen;
+		FrozenIntOctree::DataArray results;
+
+		BOOST_CHECK( frozen.is_loaded() == false );
+		BOOST_CHECK( frozen.get_size() == 0 );
+		BOOST_CHECK( frozen.count_all() == 0 );
+		BOOST_CHECK( frozen.is_valid( IntOctree::Handle() ) == false );
+		frozen.search( FrozenIntOctree::DataCuboid( 0, 0, 0, 10, 10, 10 ), results );
+		BOOST_CHECK( results.empty() );
+	}
+
+	// Empty tree.
+	{
+		IntOctree tree( 64 );
+		std::vector<char> buffer;
+
+		tree.serialize( buffer );
+
+		FrozenIntOctree frozen;
+
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() ) );
+		BOOST_CHECK( frozen.is_loaded() );
+		BOOST_CHECK( frozen.get_size() == 64 );
+		BOOST_CHECK( frozen.get_num_nodes() == 1 );
+		BOOST_CHECK( frozen.count_all() == 0 );
+	}
+
+	// Same search results and handles as the serialized tree.
+	{
+		static const IntOctree::Size TREE_SIZE = 256;
+		static const int NUM_DATA = 3000;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 4711;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+
+			cuboids.push_back( IntOctree::DataCuboid( x - size / 2, y - size / 2, z - size / 2, size, size, size / 2 ) );
+			handles.push_back( tree.insert( data, cuboids.back() ) );
+		}
+
+		// Erase every third entry, so there are free slots.
+		for( int data = 0; data < NUM_DATA; data += 3 ) {
+			tree.erase( handles[static_cast<std::size_t>( data )] );
+		}
+
+		std::vector<char> buffer;
+		tree.serialize( buffer );
+
+		// Serializing is deterministic.
+		std::vector<char> other_buffer;
+		tree.serialize( other_buffer );
+		BOOST_CHECK( buffer == other_buffer );
+
+		FrozenIntOctree frozen;
+
+		BOOST_REQUIRE( frozen.load( buffer.data(), buffer.size() ) );
+		BOOST_CHECK( frozen.get_size() == TREE_SIZE );
+		BOOST_CHECK( frozen.count_all() == tree.count_all() );
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			const IntOctree::Handle& handle = handles[static_cast<std::size_t>( data )];
+
+			BOOST_REQUIRE( frozen.is_valid( handle ) == tree.is_valid( handle ) );
+
+			if( tree.is_valid( handle ) ) {
+				BOOST_CHECK( frozen.get( handle ) == data );
+				BOOST_CHECK( frozen.get_cuboid( handle ) == cuboids[static_cast<std::size_t>( data )] );
+			}
+		}
+
+		for( int query_idx = 0; query_idx < 100; ++query_idx ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 128 );
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+
+			IntOctree::DataCuboid query( x, y, z, size, size, size );
+			FrozenIntOctree::DataArray results;
+			IntOctree::DataArray expected;
+
+			frozen.search( query, results );
+			tree.search( query, expected );
+
+			std::sort( results.begin(), results.end() );
+			std::sort( expected.begin(), expected.end() );
+
+			BOOST_CHECK( results == expected );
+		}
+
+		// Whole tree.
+		FrozenIntOctree::DataArray results;
+		frozen.search( FrozenIntOctree::DataCuboid( -256, -256, -256, 1024, 1024, 1024 ), results );
+		BOOST_CHECK( results.size() == tree.count_all() );
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		bool completed = frozen.search(
+			FrozenIntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+			[&num_visited]( const int& /*data*/, const FrozenIntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+				return ++num_visited < 10;
+			}
+		);
+
+		BOOST_CHECK( completed == false );
+		BOOST_CHECK( num_visited == 10 );
+
+		// Works on a copy, e.g. read from a file, and in a bigger buffer.
+		std::vector<char> copy( buffer.size() + 100 );
+		std::memcpy( copy.data(), buffer.data(), buffer.size() );
+		std::vector<char>().swap( buffer );
+
+		BOOST_REQUIRE( frozen.load( copy.data(), copy.size() ) );
+		BOOST_CHECK( frozen.count_all() == tree.count_all() );
+	}
+
+	// Mismatching or broken buffers are rejected.
+	{
+		IntOctree tree( 64 );
+		tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		std::vector<char> buffer;
+		tree.serialize( buffer );
+
+		FrozenIntOctree frozen;
+		FrozenLooseOctree<int, double> other_scalar;
+		FrozenLooseOctree<uint64_t> other_data;
+
+		BOOST_CHECK( other_scalar.load( buffer.data(), buffer.size() ) == false );
+		BOOST_CHECK( other_data.load( buffer.data(), buffer.size() ) == false );
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() - 1 ) == false );
+		BOOST_CHECK( frozen.load( buffer.data(), 10 ) == false );
+		BOOST_CHECK( frozen.load( nullptr, buffer.size() ) == false );
+
+		// Misaligned.
+		std::vector<char> shifted( buffer.size() + 1 );
+		std::memcpy( shifted.data() + 1, buffer.data(), buffer.size() );
+		BOOST_CHECK( frozen.load( shifted.data() + 1, buffer.size() ) == false );
+
+		FrozenOctreeHeader header;
+		std::memcpy( &header, buffer.data(), sizeof( header ) );
+
+		FrozenOctreeHeader broken = header;
+		broken.magic[0] = 'X';
+		std::memcpy( buffer.data(), &broken, sizeof( broken ) );
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() ) == false );
+
+		broken = header;
+		broken.version = FROZEN_OCTREE_VERSION + 1;
+		std::memcpy( buffer.data(), &broken, sizeof( broken ) );
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() ) == false );
+
+		broken = header;
+		broken.slots_offset = header.total_size;
+		std::memcpy( buffer.data(), &broken, sizeof( broken ) );
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() ) == false );
+		BOOST_CHECK( frozen.is_loaded() == false );
+
+		std::memcpy( buffer.data(), &header, sizeof( header ) );
+		BOOST_CHECK( frozen.load( buffer.data(), buffer.size() ) );
+		BOOST_CHECK( frozen.count_all() == 1 );
+	}
+}
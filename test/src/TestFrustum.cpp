@@ -0,0 +1,85 @@
+#include <FWU/Frustum.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+static const float TOLERANCE = 0.0001f;
+
+BOOST_AUTO_TEST_CASE( TestFrustum ) {
+	BOOST_MESSAGE( "Testing frustum..." );
+
+	using namespace util;
+
+	// Orthographic projection of the box from -1 to 1 (identity matrix).
+	{
+		FloatFrustum frustum{ FloatMatrix() };
+
+		BOOST_CHECK( frustum.planes[FloatFrustum::LEFT_PLANE].normal == sf::Vector3f( 1, 0, 0 ) );
+		BOOST_CHECK( frustum.planes[FloatFrustum::RIGHT_PLANE].normal == sf::Vector3f( -1, 0, 0 ) );
+		BOOST_CHECK( frustum.planes[FloatFrustum::BOTTOM_PLANE].normal == sf::Vector3f( 0, 1, 0 ) );
+		BOOST_CHECK( frustum.planes[FloatFrustum::TOP_PLANE].normal == sf::Vector3f( 0, -1, 0 ) );
+		BOOST_CHECK( frustum.planes[FloatFrustum::NEAR_PLANE].normal == sf::Vector3f( 0, 0, 1 ) );
+		BOOST_CHECK( frustum.planes[FloatFrustum::FAR_PLANE].normal == sf::Vector3f( 0, 0, -1 ) );
+
+		for( std::size_t plane_idx = 0; plane_idx < FloatFrustum::NUM_PLANES; ++plane_idx ) {
+			BOOST_CHECK( frustum.planes[plane_idx].distance == 1 );
+		}
+
+		uint32_t mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( -0.5f, -0.5f, -0.5f ), sf::Vector3f( 0.5f, 0.5f, 0.5f ), mask ) == FloatFrustum::INSIDE );
+		BOOST_CHECK( mask == 0 );
+
+		mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( 0.5f, -0.5f, -0.5f ), sf::Vector3f( 1.5f, 0.5f, 0.5f ), mask ) == FloatFrustum::INTERSECTING );
+		BOOST_CHECK( mask == (1u << FloatFrustum::RIGHT_PLANE) );
+
+		mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( 2, 0, 0 ), sf::Vector3f( 3, 1, 1 ), mask ) == FloatFrustum::OUTSIDE );
+
+		// Planes not in the mask aren't tested.
+		mask = FloatFrustum::ALL_PLANES & ~(1u << FloatFrustum::RIGHT_PLANE);
+		BOOST_CHECK( frustum.classify( sf::Vector3f( 2, 0, 0 ), sf::Vector3f( 3, 0.5f, 0.5f ), mask ) == FloatFrustum::INSIDE );
+
+		// Touching counts as inside.
+		mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( 1, 0, 0 ), sf::Vector3f( 2, 0.5f, 0.5f ), mask ) == FloatFrustum::INTERSECTING );
+	}
+
+	// Perspective projection looking down -z.
+	{
+		float near = 1.0f;
+		float far = 100.0f;
+
+		// 90 degrees field of view, aspect 1.
+		FloatMatrix projection(
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, (far + near) / (near - far), 2 * far * near / (near - far),
+			0, 0, -1, 0
+		);
+
+		FloatFrustum frustum( projection );
+
+		const Plane<float>& near_plane = frustum.planes[FloatFrustum::NEAR_PLANE];
+		const Plane<float>& far_plane = frustum.planes[FloatFrustum::FAR_PLANE];
+		const Plane<float>& left_plane = frustum.planes[FloatFrustum::LEFT_PLANE];
+
+		BOOST_CHECK( std::abs( near_plane.normal.z + 1 ) < TOLERANCE );
+		BOOST_CHECK( std::abs( near_plane.distance + near ) < TOLERANCE );
+		BOOST_CHECK( std::abs( far_plane.normal.z - 1 ) < TOLERANCE );
+		BOOST_CHECK( std::abs( far_plane.distance - far ) < far * TOLERANCE );
+		BOOST_CHECK( std::abs( left_plane.normal.x - std::sqrt( 0.5f ) ) < TOLERANCE );
+		BOOST_CHECK( std::abs( left_plane.normal.z + std::sqrt( 0.5f ) ) < TOLERANCE );
+		BOOST_CHECK( std::abs( left_plane.distance ) < TOLERANCE );
+
+		uint32_t mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( -1, -1, -20 ), sf::Vector3f( 1, 1, -10 ), mask ) == FloatFrustum::INSIDE );
+
+		mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( -1, -1, 5 ), sf::Vector3f( 1, 1, 10 ), mask ) == FloatFrustum::OUTSIDE );
+
+		mask = FloatFrustum::ALL_PLANES;
+		BOOST_CHECK( frustum.classify( sf::Vector3f( -1, -1, -200 ), sf::Vector3f( 1, 1, -50 ), mask ) == FloatFrustum::INTERSECTING );
+		BOOST_CHECK( mask == (1u << FloatFrustum::FAR_PLANE) );
+	}
+}
@@ -0,0 +1,235 @@
+#include <FWU/LinearLooseOctree.hpp>
+#include <FWU/LooseOctree.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+
+BOOST_AUTO_TEST_CASE( TestLinearLooseOctree ) {
+	BOOST_MESSAGE( "Testing linear loose octree..." );
+
+	using namespace util;
+
+	typedef LinearLooseOctree<int> IntOctree;
+
+	// Initial state.
+	{
+		IntOctree tree( 64 );
+
+		BOOST_CHECK( tree.get_size() == 64 );
+		BOOST_CHECK( tree.get_num_nodes() == 1 );
+		BOOST_CHECK( tree.has_node( IntOctree::get_root_code() ) );
+		BOOST_CHECK( tree.get_num_data( IntOctree::get_root_code() ) == 0 );
+		BOOST_CHECK( tree.count_all() == 0 );
+	}
+
+	// Node code arithmetic.
+	{
+		IntOctree tree( 64 );
+		IntOctree::NodeCode root = IntOctree::get_root_code();
+		IntOctree::NodeCode child = IntOctree::get_child_code( root, 5 );
+		IntOctree::NodeCode grandchild = IntOctree::get_child_code( child, 2 );
+
+		BOOST_CHECK( IntOctree::get_depth( root ) == 0 );
+		BOOST_CHECK( IntOctree::get_depth( child ) == 1 );
+		BOOST_CHECK( IntOctree::get_depth( grandchild ) == 2 );
+		BOOST_CHECK( IntOctree::get_parent_code( grandchild ) == child );
+		BOOST_CHECK( IntOctree::get_parent_code( child ) == root );
+
+		BOOST_CHECK( tree.get_node_size( root ) == 64 );
+		BOOST_CHECK( tree.get_node_size( child ) == 32 );
+		BOOST_CHECK( tree.get_node_size( grandchild ) == 16 );
+
+		BOOST_CHECK( tree.get_node_position( root ) == IntOctree::Vector( 0, 0, 0 ) );
+		BOOST_CHECK( tree.get_node_position( child ) == IntOctree::Vector( 32, 0, 32 ) );
+		BOOST_CHECK( tree.get_node_position( grandchild ) == IntOctree::Vector( 32, 16, 32 ) );
+
+		IntOctree::NodeCode neighbour = 0;
+
+		BOOST_CHECK( tree.get_neighbour_code( grandchild, 1, -1, 0, neighbour ) );
+		BOOST_CHECK( tree.get_node_position( neighbour ) == IntOctree::Vector( 48, 0, 32 ) );
+		BOOST_CHECK( IntOctree::get_depth( neighbour ) == 2 );
+
+		BOOST_CHECK( tree.get_neighbour_code( grandchild, 0, 0, 1, neighbour ) );
+		BOOST_CHECK( tree.get_node_position( neighbour ) == IntOctree::Vector( 32, 16, 48 ) );
+
+		BOOST_CHECK( tree.get_neighbour_code( grandchild, 0, 0, 2, neighbour ) == false );
+		BOOST_CHECK( tree.get_neighbour_code( grandchild, -3, 0, 0, neighbour ) == false );
+		BOOST_CHECK( tree.get_neighbour_code( root, 1, 0, 0, neighbour ) == false );
+	}
+
+	// Insert creates the target node and missing ancestors only.
+	{
+		IntOctree tree( 64 );
+
+		IntOctree::Handle first = tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		IntOctree::NodeCode first_code = tree.get_node_code( first );
+
+		BOOST_CHECK( IntOctree::get_depth( first_code ) == 6 );
+		BOOST_CHECK( tree.get_node_size( first_code ) == 1 );
+		BOOST_CHECK( tree.get_node_position( first_code ) == IntOctree::Vector( 0, 0, 0 ) );
+		BOOST_CHECK( tree.get_num_nodes() == 7 );
+
+		IntOctree::Handle second = tree.insert( 2, IntOctree::DataCuboid( 1, 0, 0, 1, 1, 1 ) );
+
+		BOOST_CHECK( IntOctree::get_parent_code( tree.get_node_code( second ) ) == IntOctree::get_parent_code( first_code ) );
+		BOOST_CHECK( tree.get_num_nodes() == 8 );
+
+		IntOctree::Handle third = tree.insert( 3, IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ) );
+
+		BOOST_CHECK( tree.get_node_code( third ) == IntOctree::get_root_code() );
+		BOOST_CHECK( tree.get_num_nodes() == 8 );
+
+		BOOST_CHECK( tree.get( first ) == 1 );
+		BOOST_CHECK( tree.get( second ) == 2 );
+		BOOST_CHECK( tree.get( third ) == 3 );
+		BOOST_CHECK( tree.get_cuboid( second ) == IntOctree::DataCuboid( 1, 0, 0, 1, 1, 1 ) );
+		BOOST_CHECK( tree.get_data( IntOctree::get_root_code() ) == IntOctree::DataArray( 1, 3 ) );
+		BOOST_CHECK( tree.count_all() == 3 );
+	}
+
+	// Erase by handle removes empty nodes.
+	{
+		IntOctree tree( 64 );
+
+		IntOctree::Handle first = tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		IntOctree::Handle second = tree.insert( 2, IntOctree::DataCuboid( 40, 40, 40, 4, 4, 4 ) );
+
+		tree.erase( first );
+
+		BOOST_CHECK( tree.is_valid( first ) == false );
+		BOOST_CHECK( tree.is_valid( second ) );
+		BOOST_CHECK( tree.get_num_nodes() == 5 );
+		BOOST_CHECK( tree.get( second ) == 2 );
+
+		// Erasing again does nothing.
+		tree.erase( first );
+		BOOST_CHECK( tree.get_num_nodes() == 5 );
+
+		// Reused slot, old handle stays invalid.
+		IntOctree::Handle third = tree.insert( 3, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		BOOST_CHECK( third.index == first.index );
+		BOOST_CHECK( tree.is_valid( first ) == false );
+		BOOST_CHECK( tree.is_valid( third ) );
+
+		tree.erase( second );
+		tree.erase( third );
+
+		BOOST_CHECK( tree.get_num_nodes() == 1 );
+		BOOST_CHECK( tree.count_all() == 0 );
+	}
+
+	// Erase by data and cuboid.
+	{
+		IntOctree tree( 64 );
+
+		tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		tree.insert( 1, IntOctree::DataCuboid( 2, 0, 0, 1, 1, 1 ) );
+		tree.insert( 1, IntOctree::DataCuboid( 50, 50, 50, 1, 1, 1 ) );
+		IntOctree::Handle other = tree.insert( 2, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		tree.erase( 1, IntOctree::DataCuboid( 0, 0, 0, 10, 10, 10 ) );
+
+		BOOST_CHECK( tree.count_all() == 2 );
+		BOOST_CHECK( tree.is_valid( other ) );
+
+		IntOctree::DataArray results;
+		tree.search( IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ), results );
+		std::sort( results.begin(), results.end() );
+
+		BOOST_CHECK( results.size() == 2 );
+		BOOST_CHECK( results[0] == 1 );
+		BOOST_CHECK( results[1] == 2 );
+
+		tree.erase( 2, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		tree.erase( 1, IntOctree::DataCuboid( 50, 50, 50, 1, 1, 1 ) );
+
+		BOOST_CHECK( tree.get_num_nodes() == 1 );
+	}
+
+	// Same placement and search results as LooseOctree.
+	{
+		typedef LooseOctree<int> PointerOctree;
+
+		static const IntOctree::Size TREE_SIZE = 256;
+		static const int NUM_DATA = 3000;
+
+		IntOctree tree( TREE_SIZE );
+		PointerOctree reference( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 815;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE * 2) ) / 2.0f;
+
+			cuboids.push_back( IntOctree::DataCuboid( x - size / 2, y - size / 2, z - size / 2, size, size, size / 2 ) );
+			handles.push_back( tree.insert( data, cuboids.back() ) );
+
+			PointerOctree& node = reference.get_node( reference.insert( data, cuboids.back() ) );
+			IntOctree::NodeCode code = tree.get_node_code( handles.back() );
+
+			BOOST_CHECK( tree.get_node_size( code ) == node.get_size() );
+			BOOST_CHECK( tree.get_node_position( code ) == node.get_position() );
+		}
+
+		BOOST_CHECK( tree.count_all() == NUM_DATA );
+
+		// Erase every third entry from both trees.
+		for( int data = 0; data < NUM_DATA; data += 3 ) {
+			tree.erase( handles[static_cast<std::size_t>( data )] );
+			reference.erase( data, cuboids[static_cast<std::size_t>( data )] );
+		}
+
+		for( int query_idx = 0; query_idx < 100; ++query_idx ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 128 );
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 400 ) - 72.0f;
+
+			IntOctree::DataCuboid query( x, y, z, size, size, size );
+			IntOctree::DataArray results;
+			PointerOctree::DataArray expected;
+
+			tree.search( query, results );
+			reference.search( query, expected );
+
+			std::sort( results.begin(), results.end() );
+			std::sort( expected.begin(), expected.end() );
+
+			BOOST_CHECK( results == expected );
+		}
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		bool completed = tree.search(
+			IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+			[&num_visited]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+				return ++num_visited < 10;
+			}
+		);
+
+		BOOST_CHECK( completed == false );
+		BOOST_CHECK( num_visited == 10 );
+
+		// Emptying the tree removes all nodes but the root.
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			tree.erase( handles[static_cast<std::size_t>( data )] );
+		}
+
+		BOOST_CHECK( tree.count_all() == 0 );
+		BOOST_CHECK( tree.get_num_nodes() == 1 );
+	}
+}
@@ -1,6 +1,50 @@
 #include <FWU/LooseOctree.hpp>
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+template <class U>
+struct CountingAllocator {
+	typedef U value_type;
+
+	CountingAllocator( std::size_t* counter_ ) :
+		counter( counter_ )
+	{
+	}
+
+	template <class V>
+	CountingAllocator( const CountingAllocator<V>& other ) :
+		counter( other.counter )
+	{
+	}
+
+	U* allocate( std::size_t num ) {
+		++*counter;
+		return std::allocator<U>().allocate( num );
+	}
+
+	void deallocate( U* ptr, std::size_t num ) {
+		std::allocator<U>().deallocate( ptr, num );
+	}
+
+	std::size_t* counter;
+};
+
+template <class U, class V>
+bool operator==( const CountingAllocator<U>& first, const CountingAllocator<V>& second ) {
+	return first.counter == second.counter;
+}
+
+template <class U, class V>
+bool operator!=( const CountingAllocator<U>& first, const CountingAllocator<V>& second ) {
+	return first.counter != second.counter;
+}
+
+}
 
 BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 	BOOST_MESSAGE( "Testing loose octree..." );
@@ -17,6 +61,8 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 		BOOST_CHECK( tree.get_position() == IntOctree::Vector( 0, 0, 0 ) );
 		BOOST_CHECK( tree.is_subdivided() == false );
 		BOOST_CHECK( tree.get_num_data() == 0 );
+		BOOST_CHECK( tree.get_loose_min() == IntOctree::DataVector( -64, -64, -64 ) );
+		BOOST_CHECK( tree.get_loose_max() == IntOctree::DataVector( 192, 192, 192 ) );
 
 		BOOST_CHECK( tree.has_child( IntOctree::LEFT_BOTTOM_FAR ) == false );
 		BOOST_CHECK( tree.has_child( IntOctree::RIGHT_BOTTOM_FAR ) == false );
@@ -32,7 +78,7 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 	{
 		IntOctree tree( 32 );
 
-		BOOST_CHECK( &tree.insert( 1337, IntOctree::DataCuboid( 0, 0, 0, 32, 32, 32 ) ) == &tree );
+		BOOST_CHECK( &tree.get_node( tree.insert( 1337, IntOctree::DataCuboid( 0, 0, 0, 32, 32, 32 ) ) ) == &tree );
 
 		BOOST_CHECK( tree.is_subdivided() == false );
 		BOOST_CHECK( tree.get_num_data() == 1 );
@@ -90,7 +136,7 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 				static_cast<IntOctree::Size>( info.cuboid.z )
 			);
 
-			BOOST_CHECK( &tree.insert( info.data, info.cuboid ) != &tree );
+			BOOST_CHECK( &tree.get_node( tree.insert( info.data, info.cuboid ) ) != &tree );
 
 			BOOST_CHECK( tree.is_subdivided() == true );
 			BOOST_CHECK( tree.get_num_data() == 0 );
@@ -100,6 +146,8 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 
 			BOOST_CHECK( child.get_size() == TREE_SIZE / 2 );
 			BOOST_CHECK( child.get_position() == tree_position );
+			BOOST_CHECK( child.get_loose_min() == IntOctree::DataVector( info.cuboid.x - 8, info.cuboid.y - 8, info.cuboid.z - 8 ) );
+			BOOST_CHECK( child.get_loose_max() == IntOctree::DataVector( info.cuboid.x + 24, info.cuboid.y + 24, info.cuboid.z + 24 ) );
 			BOOST_CHECK( child.is_subdivided() == false );
 
 			BOOST_REQUIRE( child.get_num_data() == 1 );
@@ -137,7 +185,7 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 			SingleDataQuadrantInfo& info = infos[idx];
 			IntOctree tree( TREE_SIZE );
 
-			BOOST_CHECK( &tree.insert( info.data, info.cuboid ) != &tree );
+			BOOST_CHECK( &tree.get_node( tree.insert( info.data, info.cuboid ) ) != &tree );
 
 			BOOST_CHECK( tree.is_subdivided() == true );
 			BOOST_CHECK( tree.get_num_data() == 0 );
@@ -467,7 +515,7 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 		static const IntOctree::Size TREE_SIZE = 4;
 
 		IntOctree tree( TREE_SIZE );
-		IntOctree& node = tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ) );
+		IntOctree& node = tree.get_node( tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ) ) );
 
 		BOOST_REQUIRE( tree.is_subdivided() == false );
 
@@ -489,8 +537,8 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 		static const IntOctree::Size TREE_SIZE = 4;
 
 		IntOctree tree( TREE_SIZE );
-		IntOctree& node0 = tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2 ) );
-		IntOctree& node1 = tree.insert( 1, IntOctree::DataCuboid( TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2 ) );
+		IntOctree& node0 = tree.get_node( tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2 ) ) );
+		IntOctree& node1 = tree.get_node( tree.insert( 1, IntOctree::DataCuboid( TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE - TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2, TREE_SIZE / 2 / 2 ) ) );
 
 		BOOST_REQUIRE( tree.is_subdivided() == true );
 		BOOST_REQUIRE( tree.get_child( IntOctree::LEFT_BOTTOM_FAR ).is_subdivided() == true );
@@ -519,4 +567,1263 @@ BOOST_AUTO_TEST_CASE( TestLooseOctree ) {
 
 		BOOST_CHECK( tree.is_subdivided() == false );
 	}
+
+	// Erase from a dense node keeps the remaining entries intact.
+	{
+		static const IntOctree::Size TREE_SIZE = 4;
+		static const int NUM_DATA = 300;
+
+		IntOctree tree( TREE_SIZE );
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			tree.insert(
+				data,
+				IntOctree::DataCuboid( 0, 0, static_cast<float>( data % 2 ), TREE_SIZE, TREE_SIZE, TREE_SIZE / 2 )
+			);
+		}
+
+		BOOST_REQUIRE( tree.get_num_data() == NUM_DATA );
+
+		for( int data = 0; data < NUM_DATA; data += 3 ) {
+			tree.erase( data );
+		}
+
+		BOOST_REQUIRE( tree.get_num_data() == NUM_DATA - NUM_DATA / 3 );
+
+		// Only odd data covers z = 2.5.
+		IntOctree::DataArray results;
+		tree.search( IntOctree::DataCuboid( 0, 0, 2.5f, 1, 1, 0.1f ), results );
+
+		std::sort( results.begin(), results.end() );
+
+		std::size_t num_expected = 0;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			if( data % 3 != 0 && data % 2 == 1 ) {
+				BOOST_REQUIRE( num_expected < results.size() );
+				BOOST_CHECK( results[num_expected] == data );
+				++num_expected;
+			}
+		}
+
+		BOOST_CHECK( results.size() == num_expected );
+	}
+
+	// Access and erase data by handle.
+	{
+		static const IntOctree::Size TREE_SIZE = 8;
+
+		IntOctree tree( TREE_SIZE );
+
+		IntOctree::Handle invalid;
+		BOOST_CHECK( tree.is_valid( invalid ) == false );
+
+		IntOctree::Handle root_handle = tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 8, 8, 8 ) );
+		IntOctree::Handle deep_handle = tree.insert( 2, IntOctree::DataCuboid( 7, 7, 7, 1, 1, 1 ) );
+		IntOctree::Handle other_handle = tree.insert( 3, IntOctree::DataCuboid( 1, 2, 3, 8, 4, 4 ) );
+
+		BOOST_CHECK( root_handle != deep_handle );
+		BOOST_CHECK( tree.is_valid( root_handle ) == true );
+		BOOST_CHECK( tree.is_valid( deep_handle ) == true );
+		BOOST_CHECK( tree.is_valid( other_handle ) == true );
+
+		BOOST_CHECK( tree.get( root_handle ) == 1 );
+		BOOST_CHECK( tree.get( deep_handle ) == 2 );
+		BOOST_CHECK( tree.get( other_handle ) == 3 );
+		BOOST_CHECK( tree.get_cuboid( other_handle ) == IntOctree::DataCuboid( 1, 2, 3, 8, 4, 4 ) );
+		BOOST_CHECK( &tree.get_node( root_handle ) == &tree );
+		BOOST_CHECK( tree.get_node( deep_handle ).get_size() == 1 );
+
+		tree.get( deep_handle ) = 20;
+		BOOST_CHECK( tree.get( deep_handle ) == 20 );
+
+		// Erasing the first entry of a node moves the last one, handles must follow.
+		tree.erase( root_handle );
+
+		BOOST_CHECK( tree.is_valid( root_handle ) == false );
+		BOOST_CHECK( tree.is_valid( other_handle ) == true );
+		BOOST_CHECK( tree.get( other_handle ) == 3 );
+		BOOST_CHECK( tree.get_cuboid( other_handle ) == IntOctree::DataCuboid( 1, 2, 3, 8, 4, 4 ) );
+		BOOST_CHECK( tree.get_num_data() == 1 );
+
+		// Erasing a stale handle does nothing.
+		tree.erase( root_handle );
+		BOOST_CHECK( tree.get_num_data() == 1 );
+
+		// Erasing the deep entry cleans up the empty nodes.
+		tree.erase( deep_handle );
+
+		BOOST_CHECK( tree.is_valid( deep_handle ) == false );
+		BOOST_CHECK( tree.is_subdivided() == false );
+
+		// A reused slot doesn't revive old handles.
+		IntOctree::Handle new_handle = tree.insert( 4, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		BOOST_CHECK( tree.is_valid( new_handle ) == true );
+		BOOST_CHECK( tree.is_valid( deep_handle ) == false );
+		BOOST_CHECK( tree.is_valid( root_handle ) == false );
+		BOOST_CHECK( tree.get( new_handle ) == 4 );
+
+		// Erasing by data invalidates handles, too.
+		tree.erase( 3 );
+		BOOST_CHECK( tree.is_valid( other_handle ) == false );
+
+		tree.erase( 4, IntOctree::DataCuboid( 0, 0, 0, 8, 8, 8 ) );
+		BOOST_CHECK( tree.is_valid( new_handle ) == false );
+	}
+
+	// Update data cuboids.
+	{
+		static const IntOctree::Size TREE_SIZE = 16;
+
+		IntOctree tree( TREE_SIZE );
+
+		IntOctree::Handle handle = tree.insert( 1, IntOctree::DataCuboid( 1, 1, 1, 1, 1, 1 ) );
+		IntOctree::Handle other = tree.insert( 2, IntOctree::DataCuboid( 1, 1, 1, 1, 1, 1 ) );
+		IntOctree* node = &tree.get_node( handle );
+
+		BOOST_REQUIRE( node->get_size() == 1 );
+
+		// Tiny move inside the loose bounds keeps the node.
+		tree.update( handle, IntOctree::DataCuboid( 1.25f, 0.75f, 1.5f, 1, 1, 1 ) );
+
+		BOOST_CHECK( &tree.get_node( handle ) == node );
+		BOOST_CHECK( tree.get_cuboid( handle ) == IntOctree::DataCuboid( 1.25f, 0.75f, 1.5f, 1, 1, 1 ) );
+		BOOST_CHECK( tree.get( handle ) == 1 );
+
+		{
+			IntOctree::DataArray results;
+			tree.search( IntOctree::DataCuboid( 2.1f, 1.5f, 2.1f, 0.1f, 0.1f, 0.1f ), results );
+
+			BOOST_REQUIRE( results.size() == 1 );
+			BOOST_CHECK( results[0] == 1 );
+		}
+
+		// Move to the opposite corner relocates the data, handle stays valid.
+		tree.update( handle, IntOctree::DataCuboid( 14, 14, 14, 1, 1, 1 ) );
+
+		BOOST_REQUIRE( tree.is_valid( handle ) == true );
+		BOOST_CHECK( &tree.get_node( handle ) != node );
+		BOOST_CHECK( tree.get_node( handle ).get_size() == 1 );
+		BOOST_CHECK( tree.get_node( handle ).get_position() == IntOctree::Vector( 14, 14, 14 ) );
+		BOOST_CHECK( tree.get( handle ) == 1 );
+		BOOST_CHECK( tree.get( other ) == 2 );
+
+		{
+			IntOctree::DataArray results;
+			tree.search( IntOctree::DataCuboid( 14, 14, 14, 1, 1, 1 ), results );
+
+			BOOST_REQUIRE( results.size() == 1 );
+			BOOST_CHECK( results[0] == 1 );
+		}
+
+		// Growing the cuboid moves data up.
+		tree.update( handle, IntOctree::DataCuboid( 4, 4, 4, 10, 10, 10 ) );
+
+		BOOST_CHECK( &tree.get_node( handle ) == &tree );
+		BOOST_CHECK( tree.get_num_data() == 1 );
+
+		// Old nodes are cleaned up when they become empty.
+		tree.erase( other );
+		BOOST_CHECK( tree.is_subdivided() == false );
+
+		// Shrinking keeps data in place as long as it fits.
+		tree.update( handle, IntOctree::DataCuboid( 4, 4, 4, 1, 1, 1 ) );
+		BOOST_CHECK( &tree.get_node( handle ) == &tree );
+
+		{
+			IntOctree::DataArray results;
+			tree.search( IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ), results );
+
+			BOOST_REQUIRE( results.size() == 1 );
+			BOOST_CHECK( results[0] == 1 );
+		}
+	}
+
+	// Search with visitor.
+	{
+		static const IntOctree::Size TREE_SIZE = 4;
+
+		IntOctree tree( TREE_SIZE );
+
+		tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		tree.insert( 2, IntOctree::DataCuboid( 3, 3, 3, 1, 1, 1 ) );
+		tree.insert( 3, IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ) );
+
+		// Visit all hits with their cuboids.
+		{
+			std::vector<int> data;
+			std::vector<IntOctree::DataCuboid> cuboids;
+
+			bool finished = tree.search(
+				IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+				[&]( const int& data_, const IntOctree::DataCuboid& cuboid_ ) -> bool {
+					data.push_back( data_ );
+					cuboids.push_back( cuboid_ );
+					return true;
+				}
+			);
+
+			BOOST_CHECK( finished == true );
+			BOOST_REQUIRE( data.size() == 3 );
+			BOOST_CHECK( data[0] == 3 );
+			BOOST_CHECK( cuboids[0] == IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ) );
+			BOOST_CHECK( data[1] == 1 );
+			BOOST_CHECK( cuboids[1] == IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+			BOOST_CHECK( data[2] == 2 );
+			BOOST_CHECK( cuboids[2] == IntOctree::DataCuboid( 3, 3, 3, 1, 1, 1 ) );
+		}
+
+		// Stop at first hit.
+		{
+			std::size_t num_calls = 0;
+
+			bool finished = tree.search(
+				IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+				[&]( const int&, const IntOctree::DataCuboid& ) -> bool {
+					++num_calls;
+					return false;
+				}
+			);
+
+			BOOST_CHECK( finished == false );
+			BOOST_CHECK( num_calls == 1 );
+		}
+
+		// Stop in a child node.
+		{
+			std::size_t num_calls = 0;
+
+			bool finished = tree.search(
+				IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+				[&]( const int& data, const IntOctree::DataCuboid& ) -> bool {
+					++num_calls;
+					return data != 1;
+				}
+			);
+
+			BOOST_CHECK( finished == false );
+			BOOST_CHECK( num_calls == 2 );
+		}
+
+		// Nothing found.
+		{
+			bool finished = tree.search(
+				IntOctree::DataCuboid( 5, 5, 5, 1, 1, 1 ),
+				[]( const int&, const IntOctree::DataCuboid& ) -> bool {
+					return false;
+				}
+			);
+
+			BOOST_CHECK( finished == true );
+		}
+	}
+
+	// Overlap test against loose bounds.
+	{
+		IntOctree tree( 4 );
+
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) ) == true );
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( -3, -3, -3, 2, 2, 2 ) ) == true );
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( 5, 5, 5, 2, 2, 2 ) ) == true );
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( -3, -3, -3, 1, 1, 1 ) ) == false );
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( 6, 0, 0, 1, 1, 1 ) ) == false );
+		BOOST_CHECK( tree.overlaps_loosely( IntOctree::DataCuboid( 0, 0, 0, 1, 0, 1 ) ) == false );
+	}
+
+	// Search and count match brute force, with and without covering whole subtrees.
+	{
+		static const IntOctree::Size TREE_SIZE = 64;
+		static const int NUM_DATA = 500;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 1337;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 12 );
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE - 12) );
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE - 12) );
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE - 12) );
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size * 0.5f, size ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		std::vector<IntOctree::DataCuboid> queries;
+		queries.push_back( IntOctree::DataCuboid( -100, -100, -100, 300, 300, 300 ) );
+		queries.push_back( IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ) );
+		queries.push_back( IntOctree::DataCuboid( -20, -20, -20, 60, 60, 60 ) );
+		queries.push_back( IntOctree::DataCuboid( 10, 20, 30, 5, 6, 7 ) );
+		queries.push_back( IntOctree::DataCuboid( 31.5f, 0, 0, 1, 64, 64 ) );
+		queries.push_back( IntOctree::DataCuboid( 70, 70, 70, 5, 5, 5 ) );
+
+		for( std::size_t query_idx = 0; query_idx < queries.size(); ++query_idx ) {
+			const IntOctree::DataCuboid& query = queries[query_idx];
+			std::vector<int> expected;
+
+			for( int data = 0; data < NUM_DATA; ++data ) {
+				if( IntOctree::DataCuboid::calc_intersection( cuboids[static_cast<std::size_t>( data )], query ).width > 0 ) {
+					expected.push_back( data );
+				}
+			}
+
+			IntOctree::DataArray results;
+			tree.search( query, results );
+			std::sort( results.begin(), results.end() );
+
+			BOOST_CHECK( results == expected );
+			BOOST_CHECK( tree.count( query ) == expected.size() );
+
+			std::size_t num_visited = 0;
+
+			tree.search(
+				query,
+				[&]( const int& data, const IntOctree::DataCuboid& cuboid ) -> bool {
+					BOOST_CHECK( cuboid == cuboids[static_cast<std::size_t>( data )] );
+					++num_visited;
+					return true;
+				}
+			);
+
+			BOOST_CHECK( num_visited == expected.size() );
+		}
+
+		BOOST_CHECK( tree.count_all() == NUM_DATA );
+
+		// Batched search matches single searches.
+		for( int query_idx = 0; query_idx < 200; ++query_idx ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 24 );
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 90 ) - 13.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 90 ) - 13.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 90 ) - 13.0f;
+
+			queries.push_back( IntOctree::DataCuboid( x, y, z, size, size, size * 2.0f ) );
+		}
+
+		std::vector<IntOctree::DataArray> batch_results;
+		tree.search( queries, batch_results );
+
+		BOOST_REQUIRE( batch_results.size() == queries.size() );
+
+		for( std::size_t query_idx = 0; query_idx < queries.size(); ++query_idx ) {
+			IntOctree::DataArray results;
+			tree.search( queries[query_idx], results );
+
+			std::sort( results.begin(), results.end() );
+			std::sort( batch_results[query_idx].begin(), batch_results[query_idx].end() );
+
+			BOOST_CHECK( batch_results[query_idx] == results );
+		}
+
+		// Parallel batched search matches, too.
+		ThreadPool pool( 4 );
+		std::vector<IntOctree::DataArray> parallel_results( queries.size() );
+
+		tree.search( queries.data(), queries.size(), parallel_results.data(), pool );
+
+		for( std::size_t query_idx = 0; query_idx < queries.size(); ++query_idx ) {
+			std::sort( parallel_results[query_idx].begin(), parallel_results[query_idx].end() );
+			BOOST_CHECK( parallel_results[query_idx] == batch_results[query_idx] );
+		}
+	}
+
+	// Bulk loading builds the same tree as inserting one by one.
+	{
+		typedef std::pair<int, IntOctree::DataCuboid> Item;
+
+		static const IntOctree::Size TREE_SIZE = 64;
+		static const int NUM_DATA = 2000;
+
+		std::vector<Item> items;
+		uint32_t seed = 4711;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / (data % 3 == 0 ? 1.0f : 8.0f);
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE * 4) ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE * 4) ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE * 4) ) / 4.0f;
+
+			// Centers inside the tree, cuboids inside the loose bounds.
+			items.push_back( Item( data, IntOctree::DataCuboid( x - size / 2, y - size / 4, z - size / 2, size, size / 2, size ) ) );
+		}
+
+		// Centers on node boundaries and the tree's upper bounds.
+		items.push_back( Item( NUM_DATA, IntOctree::DataCuboid( 31, 31, 31, 2, 2, 2 ) ) );
+		items.push_back( Item( NUM_DATA + 1, IntOctree::DataCuboid( 63, 63, 63, 2, 2, 2 ) ) );
+		items.push_back( Item( NUM_DATA + 2, IntOctree::DataCuboid( 60, 0, 62, 8, 1, 4 ) ) );
+		items.push_back( Item( NUM_DATA + 3, IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ) ) );
+
+		// Compares structure and per-node data order recursively.
+		struct Compare {
+			static bool equal( const IntOctree& first, const IntOctree& second ) {
+				if(
+					first.get_position() != second.get_position() ||
+					first.get_size() != second.get_size() ||
+					first.get_data() != second.get_data() ||
+					first.is_subdivided() != second.is_subdivided()
+				) {
+					return false;
+				}
+
+				for( int quadrant = 0; quadrant < IntOctree::SAME_QUADRANT; ++quadrant ) {
+					IntOctree::Quadrant q = static_cast<IntOctree::Quadrant>( quadrant );
+
+					if( first.has_child( q ) != second.has_child( q ) ) {
+						return false;
+					}
+
+					if( first.has_child( q ) && !equal( first.get_child( q ), second.get_child( q ) ) ) {
+						return false;
+					}
+				}
+
+				return true;
+			}
+		};
+
+		IntOctree inserted( TREE_SIZE );
+		std::vector<IntOctree::Handle> inserted_handles;
+
+		for( std::size_t item_idx = 0; item_idx < items.size(); ++item_idx ) {
+			inserted_handles.push_back( inserted.insert( items[item_idx].first, items[item_idx].second ) );
+		}
+
+		IntOctree built( TREE_SIZE );
+		std::vector<IntOctree::Handle> built_handles( items.size() );
+
+		built.build( items.begin(), items.end(), built_handles.data() );
+
+		BOOST_CHECK( Compare::equal( inserted, built ) );
+		BOOST_CHECK( built_handles == inserted_handles );
+		BOOST_CHECK( built.count_all() == items.size() );
+
+		for( std::size_t item_idx = 0; item_idx < items.size(); ++item_idx ) {
+			BOOST_CHECK( built.get( built_handles[item_idx] ) == items[item_idx].first );
+			BOOST_CHECK( built.get_cuboid( built_handles[item_idx] ) == items[item_idx].second );
+		}
+
+		// Parallel.
+		ThreadPool pool( 4 );
+		IntOctree parallel_built( TREE_SIZE );
+		std::vector<IntOctree::Handle> parallel_handles( items.size() );
+
+		parallel_built.build( items.begin(), items.end(), pool, parallel_handles.data() );
+
+		BOOST_CHECK( Compare::equal( inserted, parallel_built ) );
+		BOOST_CHECK( parallel_handles == inserted_handles );
+
+		// Into a tree that already holds data and has reusable slots.
+		IntOctree mixed( TREE_SIZE );
+		std::size_t half = items.size() / 2;
+
+		for( std::size_t item_idx = 0; item_idx < half; ++item_idx ) {
+			mixed.insert( items[item_idx].first, items[item_idx].second );
+		}
+
+		IntOctree::Handle erased = mixed.insert( -1, IntOctree::DataCuboid( 5, 5, 5, 1, 1, 1 ) );
+		mixed.erase( erased );
+
+		IntOctree mixed_inserted( TREE_SIZE );
+
+		for( std::size_t item_idx = 0; item_idx < half; ++item_idx ) {
+			mixed_inserted.insert( items[item_idx].first, items[item_idx].second );
+		}
+
+		erased = mixed_inserted.insert( -1, IntOctree::DataCuboid( 5, 5, 5, 1, 1, 1 ) );
+		mixed_inserted.erase( erased );
+
+		for( std::size_t item_idx = half; item_idx < items.size(); ++item_idx ) {
+			mixed_inserted.insert( items[item_idx].first, items[item_idx].second );
+		}
+
+		mixed.build( items.begin() + static_cast<std::ptrdiff_t>( half ), items.end() );
+
+		BOOST_CHECK( Compare::equal( mixed_inserted, mixed ) );
+
+		// Empty range.
+		IntOctree empty( TREE_SIZE );
+		empty.build( items.end(), items.end() );
+
+		BOOST_CHECK( empty.is_subdivided() == false );
+		BOOST_CHECK( empty.get_num_data() == 0 );
+	}
+
+	// Insert directly into deep trees.
+	{
+		IntOctree tree( 4096 );
+
+		IntOctree& deepest = tree.get_node( tree.insert( 1, IntOctree::DataCuboid( 4095.25f, 0.25f, 2049.5f, 0.5f, 0.5f, 0.5f ) ) );
+		BOOST_CHECK( deepest.get_size() == 1 );
+		BOOST_CHECK( deepest.get_position() == IntOctree::Vector( 4095, 0, 2049 ) );
+
+		IntOctree& sibling = tree.get_node( tree.insert( 2, IntOctree::DataCuboid( 4093.5f, 0, 2049, 1, 1, 1 ) ) );
+		BOOST_CHECK( sibling.get_size() == 1 );
+		BOOST_CHECK( sibling.get_position() == IntOctree::Vector( 4094, 0, 2049 ) );
+
+		IntOctree& middle = tree.get_node( tree.insert( 3, IntOctree::DataCuboid( 1000, 1000, 1000, 65, 3, 3 ) ) );
+		BOOST_CHECK( middle.get_size() == 128 );
+		BOOST_CHECK( middle.get_position() == IntOctree::Vector( 1024, 896, 896 ) );
+
+		// Centers on the upper bounds belong to the last cells.
+		IntOctree& corner = tree.get_node( tree.insert( 4, IntOctree::DataCuboid( 4095, 4095, 4095, 2, 2, 2 ) ) );
+		BOOST_CHECK( corner.get_size() == 2 );
+		BOOST_CHECK( corner.get_position() == IntOctree::Vector( 4094, 4094, 4094 ) );
+
+		BOOST_CHECK( &tree.get_node( tree.insert( 5, IntOctree::DataCuboid( 0, 0, 0, 4096, 1, 1 ) ) ) == &tree );
+
+		// Trees too large for 64 bit location codes descend level by level first.
+		IntOctree huge( 1u << 23 );
+
+		IntOctree& huge_deepest = huge.get_node( huge.insert( 1, IntOctree::DataCuboid( 3, 5, 7, 1, 1, 1 ) ) );
+		BOOST_CHECK( huge_deepest.get_size() == 1 );
+		BOOST_CHECK( huge_deepest.get_position() == IntOctree::Vector( 3, 5, 7 ) );
+	}
+
+	// Ray casts.
+	{
+		IntOctree tree( 64 );
+
+		tree.insert( 1, IntOctree::DataCuboid( 10, 0, 0, 1, 1, 1 ) );
+		tree.insert( 2, IntOctree::DataCuboid( 20, 0, 0, 4, 4, 4 ) );
+		tree.insert( 3, IntOctree::DataCuboid( 5, 5, 0, 1, 1, 1 ) );
+		tree.insert( 4, IntOctree::DataCuboid( 30, 0, 0, 40, 40, 40 ) );
+
+		IntOctree::RayHit hit;
+
+		// Nearest hit along the x axis, from outside the tree.
+		BOOST_REQUIRE( tree.raycast( IntOctree::DataVector( -10, 0.5f, 0.5f ), IntOctree::DataVector( 1, 0, 0 ), 100, hit ) );
+		BOOST_CHECK( hit.data == 1 );
+		BOOST_CHECK( hit.distance == 20 );
+		BOOST_CHECK( hit.cuboid == IntOctree::DataCuboid( 10, 0, 0, 1, 1, 1 ) );
+
+		// Opposite direction.
+		BOOST_REQUIRE( tree.raycast( IntOctree::DataVector( 100, 0.5f, 0.5f ), IntOctree::DataVector( -1, 0, 0 ), 100, hit ) );
+		BOOST_CHECK( hit.data == 4 );
+		BOOST_CHECK( hit.distance == 30 );
+
+		// Too short and missing rays.
+		BOOST_CHECK( tree.raycast( IntOctree::DataVector( -10, 0.5f, 0.5f ), IntOctree::DataVector( 1, 0, 0 ), 19, hit ) == false );
+		BOOST_CHECK( tree.raycast( IntOctree::DataVector( -10, 0.5f, 0.5f ), IntOctree::DataVector( -1, 0, 0 ), 100, hit ) == false );
+		BOOST_CHECK( tree.raycast( IntOctree::DataVector( 0, 50, 0 ), IntOctree::DataVector( 1, 0, 0 ), 25, hit ) == false );
+
+		// Origin inside data.
+		BOOST_REQUIRE( tree.raycast( IntOctree::DataVector( 21, 1, 1 ), IntOctree::DataVector( 0, 1, 0 ), 100, hit ) );
+		BOOST_CHECK( hit.data == 2 );
+		BOOST_CHECK( hit.distance == 0 );
+
+		// Unnormalized direction.
+		BOOST_REQUIRE( tree.raycast( IntOctree::DataVector( 0, 0.5f, 0.5f ), IntOctree::DataVector( 2, 0, 0 ), 100, hit ) );
+		BOOST_CHECK( hit.data == 1 );
+		BOOST_CHECK( hit.distance == 5 );
+
+		// All hits, sorted.
+		std::vector<IntOctree::RayHit> hits;
+		tree.raycast( IntOctree::DataVector( -10, 0.5f, 0.5f ), IntOctree::DataVector( 1, 0, 0 ), 100, hits );
+
+		BOOST_REQUIRE( hits.size() == 3 );
+		BOOST_CHECK( hits[0].data == 1 && hits[0].distance == 20 );
+		BOOST_CHECK( hits[1].data == 2 && hits[1].distance == 30 );
+		BOOST_CHECK( hits[2].data == 4 && hits[2].distance == 40 );
+	}
+
+	// Ray casts match brute force.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 1500;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 2024;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 32 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE - 8) );
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE - 8) );
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE - 8) );
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size * 2, size ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		for( int ray_idx = 0; ray_idx < 200; ++ray_idx ) {
+			float values[6];
+
+			for( std::size_t value_idx = 0; value_idx < 6; ++value_idx ) {
+				seed = seed * 1664525u + 1013904223u;
+				values[value_idx] = static_cast<float>( (seed >> 8) % 2001 ) / 1000.0f - 1.0f;
+			}
+
+			// Axis aligned rays every now and then.
+			if( ray_idx % 4 == 0 ) {
+				values[3 + ray_idx % 3] = 0;
+				values[3 + (ray_idx + 1) % 3] = 0;
+			}
+
+			IntOctree::DataVector origin( values[0] * 150.0f + 64.0f, values[1] * 150.0f + 64.0f, values[2] * 150.0f + 64.0f );
+			IntOctree::DataVector direction( values[3], values[4], values[5] );
+
+			if( direction.x == 0 && direction.y == 0 && direction.z == 0 ) {
+				continue;
+			}
+
+			float max_distance = 400.0f;
+			std::vector<std::pair<float, int>> expected;
+
+			for( int data = 0; data < NUM_DATA; ++data ) {
+				const IntOctree::DataCuboid& cuboid = cuboids[static_cast<std::size_t>( data )];
+				float t_near = 0;
+				float t_far = max_distance;
+				bool hit = true;
+				float origins[] = { origin.x, origin.y, origin.z };
+				float directions[] = { direction.x, direction.y, direction.z };
+				float mins[] = { cuboid.x, cuboid.y, cuboid.z };
+				float maxs[] = { cuboid.x + cuboid.width, cuboid.y + cuboid.height, cuboid.z + cuboid.depth };
+
+				for( std::size_t axis = 0; axis < 3 && hit; ++axis ) {
+					if( directions[axis] == 0 ) {
+						hit = origins[axis] >= mins[axis] && origins[axis] <= maxs[axis];
+						continue;
+					}
+
+					float t0 = (mins[axis] - origins[axis]) / directions[axis];
+					float t1 = (maxs[axis] - origins[axis]) / directions[axis];
+
+					t_near = std::max( t_near, std::min( t0, t1 ) );
+					t_far = std::min( t_far, std::max( t0, t1 ) );
+					hit = t_near <= t_far;
+				}
+
+				if( hit ) {
+					expected.push_back( std::make_pair( t_near, data ) );
+				}
+			}
+
+			std::sort( expected.begin(), expected.end() );
+
+			std::vector<IntOctree::RayHit> hits;
+			tree.raycast( origin, direction, max_distance, hits );
+
+			BOOST_REQUIRE( hits.size() == expected.size() );
+
+			for( std::size_t hit_idx = 0; hit_idx < hits.size(); ++hit_idx ) {
+				BOOST_CHECK( std::abs( hits[hit_idx].distance - expected[hit_idx].first ) < 0.001f );
+				BOOST_CHECK( hits[hit_idx].cuboid == cuboids[static_cast<std::size_t>( hits[hit_idx].data )] );
+			}
+
+			IntOctree::RayHit nearest;
+			bool found = tree.raycast( origin, direction, max_distance, nearest );
+
+			BOOST_REQUIRE( found == !expected.empty() );
+
+			if( found ) {
+				BOOST_CHECK( std::abs( nearest.distance - expected.front().first ) < 0.001f );
+			}
+		}
+	}
+
+	// Frustum search.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 2000;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 31337;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size, size ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		// Orthographic projection of the box from 10, 20, 30 to 50, 60, 70 is
+		// exact.
+		FloatMatrix ortho(
+			2.0f / 40.0f, 0, 0, -30.0f / 20.0f,
+			0, 2.0f / 40.0f, 0, -40.0f / 20.0f,
+			0, 0, 2.0f / 40.0f, -50.0f / 20.0f,
+			0, 0, 0, 1
+		);
+
+		IntOctree::DataCuboid box( 10, 20, 30, 40, 40, 40 );
+		std::vector<int> expected;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			const IntOctree::DataCuboid& cuboid = cuboids[static_cast<std::size_t>( data )];
+
+			if(
+				cuboid.x <= box.x + box.width && cuboid.x + cuboid.width >= box.x &&
+				cuboid.y <= box.y + box.height && cuboid.y + cuboid.height >= box.y &&
+				cuboid.z <= box.z + box.depth && cuboid.z + cuboid.depth >= box.z
+			) {
+				expected.push_back( data );
+			}
+		}
+
+		IntOctree::DataArray results;
+		tree.search_frustum( FloatFrustum( ortho ), results );
+		std::sort( results.begin(), results.end() );
+
+		BOOST_CHECK( !expected.empty() );
+		BOOST_CHECK( results == expected );
+
+		// Perspective camera at 64, 64, 200 looking down -z: same results as
+		// classifying every cuboid.
+		float near = 1.0f;
+		float far = 180.0f;
+
+		FloatMatrix view_projection(
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, (far + near) / (near - far), 2 * far * near / (near - far),
+			0, 0, -1, 0
+		);
+
+		view_projection.translate( sf::Vector3f( -64, -64, -200 ) );
+
+		FloatFrustum frustum( view_projection );
+
+		expected.clear();
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			const IntOctree::DataCuboid& cuboid = cuboids[static_cast<std::size_t>( data )];
+			uint32_t mask = FloatFrustum::ALL_PLANES;
+
+			if(
+				frustum.classify(
+					sf::Vector3f( cuboid.x, cuboid.y, cuboid.z ),
+					sf::Vector3f( cuboid.x + cuboid.width, cuboid.y + cuboid.height, cuboid.z + cuboid.depth ),
+					mask
+				) != FloatFrustum::OUTSIDE
+			) {
+				expected.push_back( data );
+			}
+		}
+
+		results.clear();
+		tree.search_frustum( frustum, results );
+		std::sort( results.begin(), results.end() );
+
+		BOOST_CHECK( !expected.empty() && expected.size() < NUM_DATA );
+		BOOST_CHECK( results == expected );
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		BOOST_CHECK(
+			tree.search_frustum(
+				frustum,
+				[&num_visited]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+					return ++num_visited < 5;
+				}
+			) == false
+		);
+
+		BOOST_CHECK( num_visited == 5 );
+	}
+
+	// Sphere and capsule search.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 2000;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 2501;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size / 2, size ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		for( int query_idx = 0; query_idx < 50; ++query_idx ) {
+			float coords[7];
+
+			for( std::size_t coord_idx = 0; coord_idx < 7; ++coord_idx ) {
+				seed = seed * 1664525u + 1013904223u;
+				coords[coord_idx] = static_cast<float>( (seed >> 8) % 1600 ) / 10.0f - 16.0f;
+			}
+
+			sf::Vector3f start( coords[0], coords[1], coords[2] );
+			sf::Vector3f end( coords[3], coords[4], coords[5] );
+			float radius = coords[6] / 8.0f + 2.0f;
+
+			std::vector<int> expected_sphere;
+			std::vector<int> expected_capsule;
+
+			for( int data = 0; data < NUM_DATA; ++data ) {
+				const IntOctree::DataCuboid& cuboid = cuboids[static_cast<std::size_t>( data )];
+				sf::Vector3f box_min( cuboid.x, cuboid.y, cuboid.z );
+				sf::Vector3f box_max( cuboid.x + cuboid.width, cuboid.y + cuboid.height, cuboid.z + cuboid.depth );
+
+				if( calc_squared_distance_point_box( start, box_min, box_max ) <= radius * radius ) {
+					expected_sphere.push_back( data );
+				}
+
+				if( calc_squared_distance_segment_box( start, end, box_min, box_max ) <= radius * radius ) {
+					expected_capsule.push_back( data );
+				}
+			}
+
+			IntOctree::DataArray results;
+			tree.search_sphere( start, radius, results );
+			std::sort( results.begin(), results.end() );
+
+			BOOST_CHECK( results == expected_sphere );
+
+			results.clear();
+			tree.search_capsule( start, end, radius, results );
+			std::sort( results.begin(), results.end() );
+
+			BOOST_CHECK( results == expected_capsule );
+		}
+
+		// Spheres containing the whole tree collect everything.
+		IntOctree::DataArray results;
+		tree.search_sphere( sf::Vector3f( 64, 64, 64 ), 1000.0f, results );
+
+		BOOST_CHECK( results.size() == NUM_DATA );
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		BOOST_CHECK(
+			tree.search_capsule(
+				sf::Vector3f( 0, 0, 0 ),
+				sf::Vector3f( 128, 128, 128 ),
+				20.0f,
+				[&num_visited]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+					return ++num_visited < 5;
+				}
+			) == false
+		);
+
+		BOOST_CHECK( num_visited == 5 );
+	}
+
+	// Nearest neighbours.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 2000;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 1234;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 32 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size, size / 2 ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		for( int query_idx = 0; query_idx < 50; ++query_idx ) {
+			float coords[3];
+
+			for( std::size_t coord_idx = 0; coord_idx < 3; ++coord_idx ) {
+				seed = seed * 1664525u + 1013904223u;
+				coords[coord_idx] = static_cast<float>( (seed >> 8) % 1600 ) / 10.0f - 16.0f;
+			}
+
+			sf::Vector3f point( coords[0], coords[1], coords[2] );
+			std::size_t k = static_cast<std::size_t>( 1 + query_idx % 20 );
+			float max_distance = (query_idx % 3 == 0) ? 6.0f : 1000.0f;
+
+			std::vector<float> expected;
+
+			for( int data = 0; data < NUM_DATA; ++data ) {
+				const IntOctree::DataCuboid& cuboid = cuboids[static_cast<std::size_t>( data )];
+				float distance = std::sqrt( calc_squared_distance_point_box(
+					point,
+					sf::Vector3f( cuboid.x, cuboid.y, cuboid.z ),
+					sf::Vector3f( cuboid.x + cuboid.width, cuboid.y + cuboid.height, cuboid.z + cuboid.depth )
+				) );
+
+				if( distance <= max_distance ) {
+					expected.push_back( distance );
+				}
+			}
+
+			std::sort( expected.begin(), expected.end() );
+			expected.resize( std::min( expected.size(), k ) );
+
+			std::vector<IntOctree::Neighbour> neighbours;
+			tree.nearest( point, k, max_distance, neighbours );
+
+			BOOST_REQUIRE( neighbours.size() == expected.size() );
+
+			for( std::size_t neighbour_idx = 0; neighbour_idx < neighbours.size(); ++neighbour_idx ) {
+				const IntOctree::Neighbour& neighbour = neighbours[neighbour_idx];
+
+				BOOST_CHECK( neighbour.distance == expected[neighbour_idx] );
+				BOOST_CHECK( neighbour.cuboid == cuboids[static_cast<std::size_t>( neighbour.data )] );
+			}
+		}
+
+		// Results are appended, nothing found for k = 0.
+		std::vector<IntOctree::Neighbour> neighbours;
+
+		tree.nearest( sf::Vector3f( 64, 64, 64 ), 3, 1000.0f, neighbours );
+		tree.nearest( sf::Vector3f( 64, 64, 64 ), 2, 1000.0f, neighbours );
+		tree.nearest( sf::Vector3f( 64, 64, 64 ), 0, 1000.0f, neighbours );
+
+		BOOST_CHECK( neighbours.size() == 5 );
+		BOOST_CHECK( neighbours[3].data == neighbours[0].data );
+	}
+
+	// Overlapping pairs.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 1500;
+
+		typedef std::pair<int, int> Pair;
+
+		IntOctree tree( TREE_SIZE );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 9876;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 32 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 1200 ) / 10.0f;
+
+			// A few big ones end up in upper levels.
+			if( data % 100 == 0 ) {
+				size *= 8.0f;
+			}
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size / 2, size ) );
+			tree.insert( data, cuboids.back() );
+		}
+
+		std::vector<Pair> expected;
+
+		for( int first = 0; first < NUM_DATA; ++first ) {
+			for( int second = first + 1; second < NUM_DATA; ++second ) {
+				IntOctree::DataCuboid intersection = IntOctree::DataCuboid::calc_intersection(
+					cuboids[static_cast<std::size_t>( first )],
+					cuboids[static_cast<std::size_t>( second )]
+				);
+
+				if( intersection.width > 0 ) {
+					expected.push_back( Pair( first, second ) );
+				}
+			}
+		}
+
+		BOOST_CHECK( expected.size() > 100 );
+
+		std::vector<Pair> pairs;
+
+		BOOST_CHECK(
+			tree.for_each_overlapping_pair(
+				[&pairs, &cuboids]( const int& first, const IntOctree::DataCuboid& first_cuboid, const int& second, const IntOctree::DataCuboid& second_cuboid ) -> bool {
+					BOOST_CHECK( first_cuboid == cuboids[static_cast<std::size_t>( first )] );
+					BOOST_CHECK( second_cuboid == cuboids[static_cast<std::size_t>( second )] );
+
+					pairs.push_back( Pair( std::min( first, second ), std::max( first, second ) ) );
+					return true;
+				}
+			)
+		);
+
+		// Sorting doesn't merge duplicates.
+		std::sort( pairs.begin(), pairs.end() );
+		BOOST_CHECK( pairs == expected );
+
+		// Parallel.
+		ThreadPool pool( 4 );
+		std::mutex pairs_mutex;
+
+		pairs.clear();
+
+		BOOST_CHECK(
+			tree.for_each_overlapping_pair(
+				[&pairs, &pairs_mutex]( const int& first, const IntOctree::DataCuboid& /*first_cuboid*/, const int& second, const IntOctree::DataCuboid& /*second_cuboid*/ ) -> bool {
+					std::lock_guard<std::mutex> lock( pairs_mutex );
+
+					pairs.push_back( Pair( std::min( first, second ), std::max( first, second ) ) );
+					return true;
+				},
+				pool
+			)
+		);
+
+		std::sort( pairs.begin(), pairs.end() );
+		BOOST_CHECK( pairs == expected );
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		BOOST_CHECK(
+			tree.for_each_overlapping_pair(
+				[&num_visited]( const int& /*first*/, const IntOctree::DataCuboid& /*first_cuboid*/, const int& /*second*/, const IntOctree::DataCuboid& /*second_cuboid*/ ) -> bool {
+					return ++num_visited < 5;
+				}
+			) == false
+		);
+
+		BOOST_CHECK( num_visited == 5 );
+	}
+
+	// Overlapping pairs of two trees.
+	{
+		typedef LooseOctree<std::size_t> IndexOctree;
+		typedef std::pair<int, std::size_t> Pair;
+
+		static const int NUM_DATA = 800;
+		static const std::size_t NUM_OTHER_DATA = 1200;
+
+		IntOctree tree( 64 );
+		IndexOctree other( 256 );
+		std::vector<IntOctree::DataCuboid> cuboids;
+		std::vector<IntOctree::DataCuboid> other_cuboids;
+		uint32_t seed = 5555;
+
+		for( std::size_t data = 0; data < NUM_DATA + NUM_OTHER_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 32 ) / 4.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 560 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 560 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 560 ) / 10.0f;
+
+			if( data < NUM_DATA ) {
+				cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size, size / 2 ) );
+				tree.insert( static_cast<int>( data ), cuboids.back() );
+			}
+			else {
+				// Partially outside of the smaller tree.
+				other_cuboids.push_back( IntOctree::DataCuboid( x * 1.5f, y, z, size * 2.0f, size, size ) );
+				other.insert( data - NUM_DATA, other_cuboids.back() );
+			}
+		}
+
+		std::vector<Pair> expected;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			for( std::size_t other_data = 0; other_data < NUM_OTHER_DATA; ++other_data ) {
+				IntOctree::DataCuboid intersection = IntOctree::DataCuboid::calc_intersection(
+					cuboids[static_cast<std::size_t>( data )],
+					other_cuboids[other_data]
+				);
+
+				if( intersection.width > 0 ) {
+					expected.push_back( Pair( data, other_data ) );
+				}
+			}
+		}
+
+		BOOST_CHECK( expected.size() > 100 );
+
+		std::vector<Pair> pairs;
+
+		BOOST_CHECK(
+			tree.for_each_overlapping_pair(
+				other,
+				[&pairs, &cuboids, &other_cuboids]( const int& data, const IntOctree::DataCuboid& cuboid, const std::size_t& other_data, const IntOctree::DataCuboid& other_cuboid ) -> bool {
+					BOOST_CHECK( cuboid == cuboids[static_cast<std::size_t>( data )] );
+					BOOST_CHECK( other_cuboid == other_cuboids[other_data] );
+
+					pairs.push_back( Pair( data, other_data ) );
+					return true;
+				}
+			)
+		);
+
+		// Sorting doesn't merge duplicates.
+		std::sort( pairs.begin(), pairs.end() );
+		BOOST_CHECK( pairs == expected );
+
+		// Same pairs the other way around.
+		std::vector<std::pair<std::size_t, int>> reversed_pairs;
+
+		other.for_each_overlapping_pair(
+			tree,
+			[&reversed_pairs]( const std::size_t& other_data, const IntOctree::DataCuboid& /*other_cuboid*/, const int& data, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+				reversed_pairs.push_back( std::make_pair( other_data, data ) );
+				return true;
+			}
+		);
+
+		BOOST_CHECK( reversed_pairs.size() == expected.size() );
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		BOOST_CHECK(
+			tree.for_each_overlapping_pair(
+				other,
+				[&num_visited]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/, const std::size_t& /*other_data*/, const IntOctree::DataCuboid& /*other_cuboid*/ ) -> bool {
+					return ++num_visited < 5;
+				}
+			) == false
+		);
+
+		BOOST_CHECK( num_visited == 5 );
+	}
+
+	// Assign copies nodes, data order and handles.
+	{
+		IntOctree tree( 64 );
+		IntOctree copy( 64 );
+		std::vector<IntOctree::Handle> handles;
+
+		copy.insert( 99, IntOctree::DataCuboid( 50, 50, 50, 1, 1, 1 ) );
+
+		for( int data = 0; data < 50; ++data ) {
+			float offset = static_cast<float>( data );
+			handles.push_back( tree.insert( data, IntOctree::DataCuboid( offset, offset / 2, 1, 1 + offset / 8, 1, 1 ) ) );
+		}
+
+		tree.erase( handles[10] );
+		tree.erase( handles[20] );
+
+		copy.assign( tree );
+
+		BOOST_CHECK( copy.count_all() == 48 );
+		BOOST_CHECK( copy.is_valid( handles[10] ) == false );
+
+		for( int data = 0; data < 50; ++data ) {
+			const IntOctree::Handle& handle = handles[static_cast<std::size_t>( data )];
+
+			if( data == 10 || data == 20 ) {
+				continue;
+			}
+
+			BOOST_CHECK( copy.is_valid( handle ) );
+			BOOST_CHECK( copy.get( handle ) == data );
+			BOOST_CHECK( copy.get_cuboid( handle ) == tree.get_cuboid( handle ) );
+			BOOST_CHECK( copy.get_node( handle ).get_position() == tree.get_node( handle ).get_position() );
+			BOOST_CHECK( copy.get_node( handle ).get_data() == tree.get_node( handle ).get_data() );
+			BOOST_CHECK( &copy.get_node( handle ) != &tree.get_node( handle ) );
+		}
+
+		// Both trees are independent, freed slots are reused the same way.
+		IntOctree::Handle first = tree.insert( 100, IntOctree::DataCuboid( 5, 5, 5, 1, 1, 1 ) );
+		IntOctree::Handle second = copy.insert( 100, IntOctree::DataCuboid( 5, 5, 5, 1, 1, 1 ) );
+
+		BOOST_CHECK( first == second );
+		BOOST_CHECK( copy.count_all() == 49 );
+
+		copy.erase( handles[0] );
+
+		BOOST_CHECK( tree.is_valid( handles[0] ) );
+		BOOST_CHECK( copy.is_valid( handles[0] ) == false );
+	}
+
+	// Stats.
+	{
+		IntOctree tree( 64 );
+
+		tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		tree.insert( 2, IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ) );
+		tree.insert( 3, IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ) );
+
+		IntOctree::Stats stats = tree.collect_stats();
+
+		BOOST_CHECK( stats.num_nodes == 7 );
+		BOOST_CHECK( stats.num_nodes_per_depth == std::vector<std::size_t>( 7, 1 ) );
+		BOOST_CHECK( stats.num_empty_nodes == 5 );
+		BOOST_CHECK( stats.num_data == 3 );
+		BOOST_CHECK( stats.max_data_per_node == 2 );
+		BOOST_CHECK( stats.empty_node_ratio == 5.0f / 7.0f );
+
+		// 5 nodes without data, 1 node with 1 data, 1 node with 2 data.
+		BOOST_REQUIRE( stats.data_histogram.size() == 3 );
+		BOOST_CHECK( stats.data_histogram[0] == 5 );
+		BOOST_CHECK( stats.data_histogram[1] == 1 );
+		BOOST_CHECK( stats.data_histogram[2] == 1 );
+
+		BOOST_CHECK( stats.node_bytes == 7 * sizeof( IntOctree ) );
+		BOOST_CHECK( stats.children_bytes > 0 );
+		BOOST_CHECK( stats.data_bytes >= 3 * (sizeof( int ) + 6 * sizeof( float )) );
+		BOOST_CHECK( stats.slot_bytes > 0 );
+
+		// Subtree only.
+		int quadrant = 0;
+
+		while( !tree.has_child( static_cast<IntOctree::Quadrant>( quadrant ) ) ) {
+			++quadrant;
+		}
+
+		IntOctree::Stats child_stats = tree.get_child( static_cast<IntOctree::Quadrant>( quadrant ) ).collect_stats();
+
+		BOOST_CHECK( child_stats.num_nodes == 6 );
+		BOOST_CHECK( child_stats.num_data == 1 );
+		BOOST_CHECK( child_stats.num_nodes_per_depth.size() == 6 );
+	}
+
+	// Nodes and data blocks are recycled when cleaned up.
+	{
+		typedef LooseOctree<int, float, CountingAllocator<int>> CountingOctree;
+
+		static const CountingOctree::Size TREE_SIZE = 64;
+		std::size_t num_allocations = 0;
+		CountingOctree tree( TREE_SIZE, CountingAllocator<int>( &num_allocations ) );
+
+		// Warm up: creates the deepest path once.
+		tree.insert( 1, CountingOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		tree.erase( 1, CountingOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		BOOST_REQUIRE( tree.is_subdivided() == false );
+		BOOST_CHECK( num_allocations > 0 );
+
+		std::size_t num_warm_allocations = num_allocations;
+
+		for( std::size_t cycle = 0; cycle < 100; ++cycle ) {
+			tree.insert( 1, CountingOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+			tree.erase( 1, CountingOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		}
+
+		BOOST_CHECK( num_allocations == num_warm_allocations );
+	}
 }
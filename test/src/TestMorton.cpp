@@ -0,0 +1,76 @@
+#include <FWU/Morton.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE( TestMorton ) {
+	BOOST_MESSAGE( "Testing Morton codes..." );
+
+	using namespace util;
+
+	// Logarithms.
+	{
+		BOOST_CHECK( floor_log2( 1 ) == 0 );
+		BOOST_CHECK( floor_log2( 2 ) == 1 );
+		BOOST_CHECK( floor_log2( 3 ) == 1 );
+		BOOST_CHECK( floor_log2( 4096 ) == 12 );
+		BOOST_CHECK( floor_log2( 0xffffffffffffffffull ) == 63 );
+
+		BOOST_CHECK( ceil_log2( 1 ) == 0 );
+		BOOST_CHECK( ceil_log2( 2 ) == 1 );
+		BOOST_CHECK( ceil_log2( 3 ) == 2 );
+		BOOST_CHECK( ceil_log2( 4096 ) == 12 );
+		BOOST_CHECK( ceil_log2( 4097 ) == 13 );
+	}
+
+	// Spread and compact.
+	{
+		BOOST_CHECK( morton_spread( 0 ) == 0 );
+		BOOST_CHECK( morton_spread( 1 ) == 1 );
+		BOOST_CHECK( morton_spread( 3 ) == 9 );
+		BOOST_CHECK( morton_spread( 0x1fffff ) == 0x1249249249249249ull );
+		BOOST_CHECK( morton_spread( 0xffffffff ) == 0x1249249249249249ull );
+
+		BOOST_CHECK( morton_compact( 9 ) == 3 );
+		BOOST_CHECK( morton_compact( 0x1249249249249249ull ) == 0x1fffff );
+		BOOST_CHECK( morton_compact( 0xffffffffffffffffull ) == 0x1fffff );
+	}
+
+	// Interleave order.
+	{
+		BOOST_CHECK( morton_encode( 1, 0, 0 ) == 1 );
+		BOOST_CHECK( morton_encode( 0, 1, 0 ) == 2 );
+		BOOST_CHECK( morton_encode( 0, 0, 1 ) == 4 );
+		BOOST_CHECK( morton_encode( 1, 1, 1 ) == 7 );
+		BOOST_CHECK( morton_encode( 2, 0, 0 ) == 8 );
+		BOOST_CHECK( morton_encode( 0x1fffff, 0x1fffff, 0x1fffff ) == 0x7fffffffffffffffull );
+	}
+
+	// Round trip.
+	{
+		uint32_t values[] = { 0, 1, 2, 5, 1000, 65535, 1234567, 0x1fffff };
+		std::size_t num_values = sizeof( values ) / sizeof( values[0] );
+
+		for( std::size_t x_idx = 0; x_idx < num_values; ++x_idx ) {
+			for( std::size_t y_idx = 0; y_idx < num_values; ++y_idx ) {
+				for( std::size_t z_idx = 0; z_idx < num_values; ++z_idx ) {
+					uint32_t x = 0;
+					uint32_t y = 0;
+					uint32_t z = 0;
+
+					morton_decode( morton_encode( values[x_idx], values[y_idx], values[z_idx] ), x, y, z );
+
+					BOOST_CHECK( x == values[x_idx] );
+					BOOST_CHECK( y == values[y_idx] );
+					BOOST_CHECK( z == values[z_idx] );
+				}
+			}
+		}
+	}
+
+	// Codes preserve order along each axis.
+	{
+		BOOST_CHECK( morton_encode( 3, 0, 0 ) < morton_encode( 4, 0, 0 ) );
+		BOOST_CHECK( morton_encode( 0, 3, 0 ) < morton_encode( 0, 4, 0 ) );
+		BOOST_CHECK( morton_encode( 0, 0, 3 ) < morton_encode( 0, 0, 4 ) );
+	}
+}
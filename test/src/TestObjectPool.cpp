@@ -0,0 +1,238 @@
+#include <FWU/ObjectPool.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <new>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+/** Allocator failing after a number of allocations.
+ */
+template <class U>
+struct FailingAllocator {
+	typedef U value_type;
+
+	FailingAllocator( std::size_t* num_allowed_, std::size_t* num_live_ ) :
+		num_allowed( num_allowed_ ),
+		num_live( num_live_ )
+	{
+	}
+
+	template <class V>
+	FailingAllocator( const FailingAllocator<V>& other ) :
+		num_allowed( other.num_allowed ),
+		num_live( other.num_live )
+	{
+	}
+
+	U* allocate( std::size_t num ) {
+		if( *num_allowed == 0 ) {
+			throw std::bad_alloc();
+		}
+
+		--*num_allowed;
+		++*num_live;
+		return std::allocator<U>().allocate( num );
+	}
+
+	void deallocate( U* ptr, std::size_t num ) {
+		--*num_live;
+		std::allocator<U>().deallocate( ptr, num );
+	}
+
+	std::size_t* num_allowed;
+	std::size_t* num_live;
+};
+
+template <class U, class V>
+bool operator==( const FailingAllocator<U>& first, const FailingAllocator<V>& second ) {
+	return first.num_live == second.num_live;
+}
+
+template <class U, class V>
+bool operator!=( const FailingAllocator<U>& first, const FailingAllocator<V>& second ) {
+	return first.num_live != second.num_live;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( TestObjectPool ) {
+	BOOST_MESSAGE( "Testing object pool..." );
+
+	using namespace util;
+
+	struct Counted {
+		Counted( int value_, int& num_alive_ ) :
+			value( value_ ),
+			num_alive( num_alive_ )
+		{
+			++num_alive;
+		}
+
+		~Counted() {
+			--num_alive;
+		}
+
+		int value;
+		int& num_alive;
+	};
+
+	// Initial state.
+	{
+		ObjectPool<int> pool( 16 );
+
+		BOOST_CHECK( pool.get_page_size() == 16 );
+		BOOST_CHECK( pool.get_num_pages() == 0 );
+		BOOST_CHECK( pool.get_num_objects() == 0 );
+	}
+
+	// Allocate a full page, then one more.
+	{
+		ObjectPool<int> pool( 4 );
+		std::set<void*> pointers;
+
+		for( std::size_t idx = 0; idx < 4; ++idx ) {
+			pointers.insert( pool.allocate() );
+		}
+
+		BOOST_CHECK( pointers.size() == 4 );
+		BOOST_CHECK( pool.get_num_pages() == 1 );
+		BOOST_CHECK( pool.get_num_objects() == 4 );
+
+		pointers.insert( pool.allocate() );
+
+		BOOST_CHECK( pointers.size() == 5 );
+		BOOST_CHECK( pool.get_num_pages() == 2 );
+		BOOST_CHECK( pool.get_num_objects() == 5 );
+
+		for( std::set<void*>::iterator iter = pointers.begin(); iter != pointers.end(); ++iter ) {
+			pool.deallocate( *iter );
+		}
+
+		BOOST_CHECK( pool.get_num_pages() == 2 );
+		BOOST_CHECK( pool.get_num_objects() == 0 );
+	}
+
+	// Released storage is recycled.
+	{
+		ObjectPool<int> pool( 8 );
+
+		void* first = pool.allocate();
+		pool.deallocate( first );
+
+		BOOST_CHECK( pool.allocate() == first );
+		BOOST_CHECK( pool.get_num_pages() == 1 );
+	}
+
+	// Consecutive allocations from a fresh page are contiguous.
+	{
+		ObjectPool<double> pool( 8 );
+
+		double* first = static_cast<double*>( pool.allocate() );
+		double* second = static_cast<double*>( pool.allocate() );
+
+		BOOST_CHECK( second == first + 1 );
+	}
+
+	// Create and destroy objects.
+	{
+		int num_alive = 0;
+		ObjectPool<Counted> pool( 2 );
+
+		Counted* a = pool.create( 1, num_alive );
+		Counted* b = pool.create( 2, num_alive );
+		Counted* c = pool.create( 3, num_alive );
+
+		BOOST_CHECK( num_alive == 3 );
+		BOOST_CHECK( a->value == 1 );
+		BOOST_CHECK( b->value == 2 );
+		BOOST_CHECK( c->value == 3 );
+		BOOST_CHECK( pool.get_num_pages() == 2 );
+
+		pool.destroy( b );
+		pool.destroy( nullptr );
+
+		BOOST_CHECK( num_alive == 2 );
+		BOOST_CHECK( pool.get_num_objects() == 2 );
+
+		pool.destroy( a );
+		pool.destroy( c );
+
+		BOOST_CHECK( num_alive == 0 );
+		BOOST_CHECK( pool.get_num_objects() == 0 );
+	}
+
+	// Throwing constructors give the storage back.
+	{
+		struct Throwing {
+			Throwing( bool fail ) {
+				if( fail ) {
+					throw std::runtime_error( "Construction failed." );
+				}
+			}
+		};
+
+		ObjectPool<Throwing> pool( 4 );
+
+		Throwing* first = pool.create( false );
+		bool failed = false;
+
+		try {
+			pool.create( true );
+		}
+		catch( const std::runtime_error& ) {
+			failed = true;
+		}
+
+		BOOST_CHECK( failed );
+		BOOST_CHECK( pool.get_num_objects() == 1 );
+
+		// The rest of the page, including the failed object's storage, is free.
+		std::set<void*> pointers;
+
+		for( std::size_t idx = 0; idx < 3; ++idx ) {
+			pointers.insert( pool.allocate() );
+		}
+
+		BOOST_CHECK( pool.get_num_pages() == 1 );
+		BOOST_CHECK( pool.get_num_objects() == 4 );
+
+		for( std::set<void*>::iterator iter = pointers.begin(); iter != pointers.end(); ++iter ) {
+			pool.deallocate( *iter );
+		}
+
+		pool.destroy( first );
+
+		BOOST_CHECK( pool.get_num_objects() == 0 );
+	}
+
+	// Failing page allocations leak nothing.
+	{
+		for( std::size_t num_allowed = 0; num_allowed <= 4; ++num_allowed ) {
+			std::size_t num_left = num_allowed;
+			std::size_t num_live = 0;
+
+			{
+				ObjectPool<int, FailingAllocator<int>> pool( 4, FailingAllocator<int>( &num_left, &num_live ) );
+				bool failed = false;
+
+				try {
+					for( std::size_t idx = 0; idx < 8; ++idx ) {
+						pool.allocate();
+					}
+				}
+				catch( const std::bad_alloc& ) {
+					failed = true;
+				}
+
+				// Each page takes two allocations, blocks and page.
+				BOOST_CHECK( failed == (num_allowed < 4) );
+				BOOST_CHECK( pool.get_num_pages() == num_allowed / 2 );
+				BOOST_CHECK( num_live == 2 * pool.get_num_pages() );
+			}
+
+			BOOST_CHECK( num_live == 0 );
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#include <FWU/LooseOctree.hpp>
+#include <FWU/QueryCounters.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+
+BOOST_AUTO_TEST_CASE( TestQueryCounters ) {
+	BOOST_MESSAGE( "Testing query counters..." );
+
+	using namespace util;
+
+	typedef LooseOctree<int> IntOctree;
+
+	IntOctree tree( 64 );
+
+	tree.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+	tree.insert( 2, IntOctree::DataCuboid( 2, 0, 0, 1, 1, 1 ) );
+	tree.insert( 3, IntOctree::DataCuboid( 50, 50, 50, 1, 1, 1 ) );
+	tree.insert( 4, IntOctree::DataCuboid( 0, 0, 0, 64, 64, 64 ) );
+
+	get_query_counters().reset();
+
+	BOOST_CHECK( get_query_counters().nodes_visited == 0 );
+	BOOST_CHECK( get_query_counters().data_tested == 0 );
+	BOOST_CHECK( get_query_counters().hits == 0 );
+
+	IntOctree::DataArray results;
+	tree.search( IntOctree::DataCuboid( 0, 0, 0, 1.5f, 1, 1 ), results );
+
+	BOOST_REQUIRE( results.size() == 2 );
+
+	const QueryCounters& counters = get_query_counters();
+
+#if defined( FWU_QUERY_COUNTERS )
+	// Data of the root and of the node holding data 1. The node holding data 2
+	// doesn't overlap the query.
+	uint64_t nodes_visited = counters.nodes_visited;
+
+	BOOST_CHECK( nodes_visited >= 2 );
+	BOOST_CHECK( nodes_visited < tree.collect_stats().num_nodes );
+	BOOST_CHECK( counters.data_tested == 2 );
+	BOOST_CHECK( counters.hits == 2 );
+
+	// Covered subtrees count all their data as hits without testing.
+	get_query_counters().reset();
+	tree.search( IntOctree::DataCuboid( -64, -64, -64, 256, 256, 256 ), results );
+
+	BOOST_CHECK( counters.nodes_visited == tree.collect_stats().num_nodes );
+	BOOST_CHECK( counters.data_tested == 0 );
+	BOOST_CHECK( counters.hits == 4 );
+
+	// Other queries count, too.
+	get_query_counters().reset();
+	tree.search_sphere( IntOctree::DataVector( 50.5f, 50.5f, 50.5f ), 1.0f, results );
+
+	BOOST_CHECK( counters.nodes_visited > 0 );
+	BOOST_CHECK( counters.data_tested > 0 );
+	BOOST_CHECK( counters.hits == 2 );
+
+	// Counters are per thread.
+	uint64_t other_nodes_visited = 0;
+
+	std::thread other(
+		[&tree, &other_nodes_visited]() {
+			IntOctree::DataArray other_results;
+			tree.search( IntOctree::DataCuboid( 0, 0, 0, 1.5f, 1, 1 ), other_results );
+
+			other_nodes_visited = get_query_counters().nodes_visited;
+		}
+	);
+
+	other.join();
+
+	BOOST_CHECK( other_nodes_visited == nodes_visited );
+	BOOST_CHECK( counters.hits == 2 );
+#else
+	// Compiled out.
+	BOOST_CHECK( counters.nodes_visited == 0 );
+	BOOST_CHECK( counters.data_tested == 0 );
+	BOOST_CHECK( counters.hits == 0 );
+#endif
+}
@@ -0,0 +1,262 @@
+#include <FWU/ShardedLooseOctree.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestShardedLooseOctree ) {
+	BOOST_MESSAGE( "Testing sharded loose octree..." );
+
+	using namespace util;
+
+	typedef ShardedLooseOctree<int> IntOctree;
+
+	// Initial state and routing.
+	{
+		IntOctree tree( 128, 32 );
+
+		BOOST_CHECK( tree.get_size() == 128 );
+		BOOST_CHECK( tree.get_region_size() == 32 );
+		BOOST_CHECK( tree.get_num_shards() == 65 );
+		BOOST_CHECK( tree.get_overflow_shard() == 64 );
+		BOOST_CHECK( tree.count_all() == 0 );
+
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) ) == 0 );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 31, 0, 0, 2, 1, 1 ) ) == 1 );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 30, 0, 0, 2, 1, 1 ) ) == 0 );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 40, 70, 100, 4, 4, 4 ) ) == 1 + 4 * (2 + 4 * 3) );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 127, 127, 127, 1, 1, 1 ) ) == 63 );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 0, 0, 0, 32, 32, 32 ) ) == 0 );
+		BOOST_CHECK( tree.get_shard( IntOctree::DataCuboid( 0, 0, 0, 33, 1, 1 ) ) == 64 );
+	}
+
+	// Handles.
+	{
+		IntOctree tree( 128, 32 );
+
+		IntOctree::Handle handle = tree.insert( 7, IntOctree::DataCuboid( 1, 1, 1, 2, 2, 2 ) );
+
+		BOOST_CHECK( handle.shard == 0 );
+		BOOST_CHECK( tree.is_valid( handle ) );
+		BOOST_CHECK( tree.is_valid( IntOctree::Handle() ) == false );
+		BOOST_CHECK( tree.get( handle ) == 7 );
+		BOOST_CHECK( tree.get_cuboid( handle ) == IntOctree::DataCuboid( 1, 1, 1, 2, 2, 2 ) );
+
+		// Update within the shard keeps the handle.
+		IntOctree::Handle updated = tree.update( handle, IntOctree::DataCuboid( 10, 10, 10, 2, 2, 2 ) );
+
+		BOOST_CHECK( updated == handle );
+		BOOST_CHECK( tree.get_cuboid( handle ) == IntOctree::DataCuboid( 10, 10, 10, 2, 2, 2 ) );
+
+		// Moving to another shard returns a new handle.
+		IntOctree::Handle moved = tree.update( handle, IntOctree::DataCuboid( 100, 10, 10, 2, 2, 2 ) );
+
+		BOOST_CHECK( moved.shard == 3 );
+		BOOST_CHECK( tree.is_valid( handle ) == false );
+		BOOST_CHECK( tree.is_valid( moved ) );
+		BOOST_CHECK( tree.get( moved ) == 7 );
+		BOOST_CHECK( tree.count_all() == 1 );
+
+		tree.erase( moved );
+		tree.erase( IntOctree::Handle() );
+
+		BOOST_CHECK( tree.is_valid( moved ) == false );
+		BOOST_CHECK( tree.count_all() == 0 );
+	}
+
+	// Same results as a single tree.
+	{
+		static const IntOctree::Size TREE_SIZE = 128;
+		static const int NUM_DATA = 3000;
+
+		IntOctree tree( TREE_SIZE, 16 );
+		LooseOctree<int> reference( TREE_SIZE );
+		std::vector<IntOctree::Handle> handles;
+		std::vector<IntOctree::DataCuboid> cuboids;
+		uint32_t seed = 777;
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 ) / 2.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 960 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 960 ) / 10.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 960 ) / 10.0f;
+
+			cuboids.push_back( IntOctree::DataCuboid( x, y, z, size, size / 2, size ) );
+			handles.push_back( tree.insert( data, cuboids.back() ) );
+		}
+
+		// Move some, possibly into other shards, and erase others.
+		for( int data = 0; data < NUM_DATA; data += 3 ) {
+			std::size_t data_idx = static_cast<std::size_t>( data );
+			IntOctree::DataCuboid& cuboid = cuboids[data_idx];
+
+			cuboid.x = std::fmod( cuboid.x + 37.0f, 96.0f );
+			handles[data_idx] = tree.update( handles[data_idx], cuboid );
+		}
+
+		for( int data = 1; data < NUM_DATA; data += 7 ) {
+			tree.erase( handles[static_cast<std::size_t>( data )] );
+		}
+
+		for( int data = 0; data < NUM_DATA; ++data ) {
+			if( data % 7 != 1 ) {
+				reference.insert( data, cuboids[static_cast<std::size_t>( data )] );
+			}
+		}
+
+		BOOST_CHECK( tree.count_all() == reference.count_all() );
+
+		ThreadPool pool( 4 );
+
+		for( int query_idx = 0; query_idx < 100; ++query_idx ) {
+			seed = seed * 1664525u + 1013904223u;
+			float size = static_cast<float>( 1 + (seed >> 8) % 64 );
+			seed = seed * 1664525u + 1013904223u;
+			float x = static_cast<float>( (seed >> 8) % 160 ) - 16.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float y = static_cast<float>( (seed >> 8) % 160 ) - 16.0f;
+			seed = seed * 1664525u + 1013904223u;
+			float z = static_cast<float>( (seed >> 8) % 160 ) - 16.0f;
+
+			IntOctree::DataCuboid query( x, y, z, size, size, size );
+			IntOctree::DataArray expected;
+			IntOctree::DataArray results;
+			IntOctree::DataArray parallel_results;
+
+			reference.search( query, expected );
+			tree.search( query, results );
+			tree.search( query, parallel_results, pool );
+
+			std::sort( expected.begin(), expected.end() );
+			std::sort( results.begin(), results.end() );
+			std::sort( parallel_results.begin(), parallel_results.end() );
+
+			BOOST_CHECK( results == expected );
+			BOOST_CHECK( parallel_results == expected );
+		}
+
+		// Early exit.
+		std::size_t num_visited = 0;
+
+		BOOST_CHECK(
+			tree.search(
+				IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ),
+				[&num_visited]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+					return ++num_visited < 10;
+				}
+			) == false
+		);
+
+		BOOST_CHECK( num_visited == 10 );
+	}
+
+	// Parallel searches share the pool with tasks modifying the tree. The
+	// searching thread runs queued writer tasks while it waits.
+	{
+		static const int NUM_ROUNDS = 50;
+		static const int NUM_TASKS = 8;
+
+		IntOctree tree( 128, 32 );
+		ThreadPool pool( 2 );
+
+		for( int round = 0; round < NUM_ROUNDS; ++round ) {
+			for( int task_idx = 0; task_idx < NUM_TASKS; ++task_idx ) {
+				int data = round * NUM_TASKS + task_idx;
+
+				pool.enqueue(
+					[&tree, data, task_idx]() {
+						float offset = static_cast<float>( task_idx % 4 ) * 32.0f;
+						IntOctree::Handle handle = tree.insert( data, IntOctree::DataCuboid( offset, 1, 1, 1, 1, 1 ) );
+
+						tree.update( handle, IntOctree::DataCuboid( offset + 1, 1, 1, 1, 1, 1 ) );
+					}
+				);
+			}
+
+			IntOctree::DataArray results;
+			tree.search( IntOctree::DataCuboid( 0, 0, 0, 128, 128, 128 ), results, pool );
+
+			BOOST_CHECK( results.size() <= static_cast<std::size_t>( (round + 1) * NUM_TASKS ) );
+		}
+
+		pool.wait();
+
+		IntOctree::DataArray results;
+		tree.search( IntOctree::DataCuboid( 0, 0, 0, 128, 128, 128 ), results, pool );
+
+		BOOST_CHECK( tree.count_all() == NUM_ROUNDS * NUM_TASKS );
+		BOOST_CHECK( results.size() == NUM_ROUNDS * NUM_TASKS );
+	}
+
+	// Writers in different regions and readers run concurrently.
+	{
+		static const std::size_t NUM_WRITERS = 4;
+		static const int NUM_STEPS = 2000;
+
+		IntOctree tree( 128, 32 );
+		std::atomic<bool> stop( false );
+		std::atomic<std::size_t> num_errors( 0 );
+		std::vector<std::thread> threads;
+
+		std::vector<IntOctree::Handle> handles;
+
+		for( std::size_t writer_idx = 0; writer_idx < NUM_WRITERS; ++writer_idx ) {
+			float offset = static_cast<float>( writer_idx ) * 32.0f;
+			handles.push_back( tree.insert( static_cast<int>( writer_idx ), IntOctree::DataCuboid( offset, 0, 0, 1, 1, 1 ) ) );
+		}
+
+		// Readers always find the one entity of every writer.
+		threads.push_back(
+			std::thread(
+				[&tree, &stop, &num_errors]() {
+					while( !stop ) {
+						IntOctree::DataArray results;
+						tree.search( IntOctree::DataCuboid( 0, 0, 0, 128, 128, 128 ), results );
+
+						if( results.size() != NUM_WRITERS ) {
+							++num_errors;
+						}
+					}
+				}
+			)
+		);
+
+		for( std::size_t writer_idx = 0; writer_idx < NUM_WRITERS; ++writer_idx ) {
+			threads.push_back(
+				std::thread(
+					[&tree, &handles, &num_errors, writer_idx]() {
+						IntOctree::Handle handle = handles[writer_idx];
+						float offset = static_cast<float>( writer_idx ) * 32.0f;
+
+						for( int step = 0; step < NUM_STEPS; ++step ) {
+							// Mostly within the own region, sometimes into the next row.
+							float y = static_cast<float>( step % 48 );
+							handle = tree.update( handle, IntOctree::DataCuboid( offset + static_cast<float>( step % 31 ), y, 0, 1, 1, 1 ) );
+
+							if( tree.get( handle ) != static_cast<int>( writer_idx ) ) {
+								++num_errors;
+							}
+						}
+					}
+				)
+			);
+		}
+
+		for( std::size_t thread_idx = 1; thread_idx < threads.size(); ++thread_idx ) {
+			threads[thread_idx].join();
+		}
+
+		stop = true;
+		threads[0].join();
+
+		BOOST_CHECK( num_errors == 0 );
+		BOOST_CHECK( tree.count_all() == NUM_WRITERS );
+	}
+}
@@ -0,0 +1,109 @@
+#include <FWU/ThreadPool.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestThreadPool ) {
+	BOOST_MESSAGE( "Testing thread pool..." );
+
+	using namespace util;
+
+	// Initial state.
+	{
+		ThreadPool pool( 3 );
+		BOOST_CHECK( pool.get_num_threads() == 3 );
+	}
+
+	{
+		ThreadPool pool;
+		BOOST_CHECK( pool.get_num_threads() > 0 );
+	}
+
+	// Enqueue tasks and wait.
+	{
+		ThreadPool pool( 4 );
+		std::atomic<int> sum( 0 );
+
+		for( int value = 1; value <= 1000; ++value ) {
+			pool.enqueue( [&sum, value]() { sum += value; } );
+		}
+
+		pool.wait();
+
+		BOOST_CHECK( sum == 500500 );
+	}
+
+	// Parallel for visits every index exactly once.
+	{
+		static const std::size_t NUM_ITEMS = 10000;
+
+		ThreadPool pool( 4 );
+		std::vector<std::atomic<int>> visits( NUM_ITEMS );
+		std::atomic<std::size_t> num_oversized_chunks( 0 );
+
+		for( std::size_t idx = 0; idx < NUM_ITEMS; ++idx ) {
+			visits[idx] = 0;
+		}
+
+		pool.parallel_for(
+			0,
+			NUM_ITEMS,
+			7,
+			[&visits, &num_oversized_chunks]( std::size_t begin, std::size_t end ) {
+				if( end - begin > 7 ) {
+					++num_oversized_chunks;
+				}
+
+				for( std::size_t idx = begin; idx < end; ++idx ) {
+					++visits[idx];
+				}
+			}
+		);
+
+		std::size_t num_once = 0;
+
+		for( std::size_t idx = 0; idx < NUM_ITEMS; ++idx ) {
+			num_once += visits[idx] == 1 ? 1 : 0;
+		}
+
+		BOOST_CHECK( num_once == NUM_ITEMS );
+		BOOST_CHECK( num_oversized_chunks == 0 );
+	}
+
+	// Empty range.
+	{
+		ThreadPool pool( 2 );
+		bool called = false;
+
+		pool.parallel_for( 5, 5, 0, [&called]( std::size_t, std::size_t ) { called = true; } );
+
+		BOOST_CHECK( called == false );
+	}
+
+	// Nested parallel for.
+	{
+		ThreadPool pool( 2 );
+		std::atomic<std::size_t> sum( 0 );
+
+		pool.parallel_for(
+			0,
+			16,
+			1,
+			[&pool, &sum]( std::size_t outer_begin, std::size_t outer_end ) {
+				for( std::size_t outer = outer_begin; outer < outer_end; ++outer ) {
+					pool.parallel_for(
+						0,
+						100,
+						10,
+						[&sum]( std::size_t begin, std::size_t end ) {
+							sum += end - begin;
+						}
+					);
+				}
+			}
+		);
+
+		BOOST_CHECK( sum == 1600 );
+	}
+}
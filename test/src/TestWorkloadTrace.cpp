@@ -0,0 +1,279 @@
+#include <FWU/LinearLooseOctree.hpp>
+#include <FWU/RecordingLooseOctree.hpp>
+#include <FWU/ShardedLooseOctree.hpp>
+#include <FWU/WorkloadTrace.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( TestWorkloadTrace ) {
+	BOOST_MESSAGE( "Testing workload trace..." );
+
+	using namespace util;
+
+	typedef LooseOctree<int> IntOctree;
+	typedef RecordingLooseOctree<int> RecordingIntOctree;
+	typedef WorkloadTrace<float> Trace;
+
+	static const IntOctree::Size TREE_SIZE = 256;
+
+	uint32_t seed = 4321;
+
+	auto random_cuboid = [&seed]() -> IntOctree::DataCuboid {
+		seed = seed * 1664525u + 1013904223u;
+		float size = static_cast<float>( 1 + (seed >> 8) % 32 ) / 2.0f;
+		seed = seed * 1664525u + 1013904223u;
+		float x = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+		seed = seed * 1664525u + 1013904223u;
+		float y = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+		seed = seed * 1664525u + 1013904223u;
+		float z = static_cast<float>( (seed >> 8) % (TREE_SIZE - 16) );
+
+		return IntOctree::DataCuboid( x, y, z, size, size, size );
+	};
+
+	// Records a mixed workload.
+	auto record = [&random_cuboid]( RecordingIntOctree& recording ) {
+		std::vector<IntOctree::Handle> handles;
+		IntOctree::DataArray results;
+
+		for( int data = 0; data < 1000; ++data ) {
+			handles.push_back( recording.insert( data, random_cuboid() ) );
+
+			if( data % 10 == 0 ) {
+				IntOctree::DataCuboid query = random_cuboid();
+				recording.search( IntOctree::DataCuboid( query.x, query.y, query.z, 32, 32, 32 ), results );
+			}
+
+			if( data % 3 == 0 ) {
+				recording.erase( handles[static_cast<std::size_t>( data ) / 2] );
+			}
+		}
+	};
+
+	// Records.
+	{
+		IntOctree tree( TREE_SIZE );
+		Trace trace;
+
+		BOOST_CHECK( trace.is_empty() );
+		BOOST_CHECK( trace.get_num_bytes() == sizeof( WorkloadTraceHeader ) );
+
+		RecordingIntOctree recording( tree, trace );
+
+		BOOST_CHECK( &recording.get_tree() == &tree );
+		BOOST_CHECK( &recording.get_trace() == &trace );
+		BOOST_CHECK( trace.get_size() == TREE_SIZE );
+
+		IntOctree::Handle first = recording.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		std::size_t insert_size = trace.get_num_bytes() - sizeof( WorkloadTraceHeader );
+
+		IntOctree::Handle second = recording.insert( 2, IntOctree::DataCuboid( 2, 0, 0, 1, 1, 1 ) );
+
+		BOOST_CHECK( insert_size == 1 + 6 * sizeof( float ) );
+		BOOST_CHECK( trace.get_num_items() == 2 );
+		BOOST_CHECK( tree.count_all() == 2 );
+		BOOST_CHECK( tree.get( second ) == 2 );
+
+		std::size_t num_bytes = trace.get_num_bytes();
+		IntOctree::DataArray results;
+		recording.search( IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ), results );
+
+		BOOST_CHECK( results.size() == 2 );
+		BOOST_CHECK( trace.get_num_bytes() - num_bytes == 1 + sizeof( uint32_t ) + 6 * sizeof( float ) );
+
+		num_bytes = trace.get_num_bytes();
+		recording.erase( first );
+
+		BOOST_CHECK( trace.get_num_bytes() - num_bytes == 1 + sizeof( uint32_t ) );
+		BOOST_CHECK( tree.count_all() == 1 );
+
+		// Erasing invalid handles isn't recorded.
+		num_bytes = trace.get_num_bytes();
+		recording.erase( first );
+
+		BOOST_CHECK( trace.get_num_bytes() == num_bytes );
+
+		// Searches stopped by the visitor record no number of results.
+		recording.insert( 3, IntOctree::DataCuboid( 3, 0, 0, 1, 1, 1 ) );
+
+		bool completed = recording.search(
+			IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ),
+			[]( const int& /*data*/, const IntOctree::DataCuboid& /*cuboid*/ ) -> bool {
+				return false;
+			}
+		);
+
+		BOOST_CHECK( completed == false );
+
+		IntOctree other( TREE_SIZE );
+		Trace::ReplayResult result;
+
+		BOOST_REQUIRE( trace.replay( other, result ) );
+		BOOST_CHECK( result.num_inserts == 3 );
+		BOOST_CHECK( result.num_erases == 1 );
+		BOOST_CHECK( result.num_searches == 2 );
+		BOOST_CHECK( result.num_mismatches == 0 );
+		BOOST_CHECK( other.count_all() == 2 );
+
+		trace.clear();
+
+		BOOST_CHECK( trace.is_empty() );
+		BOOST_CHECK( trace.get_num_items() == 0 );
+		BOOST_CHECK( trace.get_size() == TREE_SIZE );
+	}
+
+	// Erasing by data records each erased item.
+	{
+		IntOctree tree( TREE_SIZE );
+		Trace trace;
+		RecordingIntOctree recording( tree, trace );
+
+		recording.insert( 1, IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+		recording.insert( 1, IntOctree::DataCuboid( 2, 0, 0, 1, 1, 1 ) );
+		recording.insert( 1, IntOctree::DataCuboid( 100, 0, 0, 1, 1, 1 ) );
+		recording.insert( 2, IntOctree::DataCuboid( 1, 0, 0, 1, 1, 1 ) );
+
+		std::size_t num_bytes = trace.get_num_bytes();
+		recording.erase( 1, IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ) );
+
+		BOOST_CHECK( trace.get_num_bytes() - num_bytes == 2 * (1 + sizeof( uint32_t )) );
+		BOOST_CHECK( tree.count_all() == 2 );
+
+		// Nothing erased, nothing recorded.
+		num_bytes = trace.get_num_bytes();
+		recording.erase( 1, IntOctree::DataCuboid( 0, 0, 0, 4, 4, 4 ) );
+
+		BOOST_CHECK( trace.get_num_bytes() == num_bytes );
+
+		IntOctree other( TREE_SIZE );
+		Trace::ReplayResult result;
+
+		BOOST_REQUIRE( trace.replay( other, result ) );
+		BOOST_CHECK( result.num_erases == 2 );
+		BOOST_CHECK( other.count_all() == 2 );
+	}
+
+	// Replays on all index implementations with the same results.
+	{
+		IntOctree tree( TREE_SIZE );
+		Trace trace;
+		RecordingIntOctree recording( tree, trace );
+
+		record( recording );
+
+		{
+			IntOctree other( TREE_SIZE );
+			Trace::ReplayResult result;
+
+			BOOST_REQUIRE( trace.replay( other, result ) );
+			BOOST_CHECK( result.num_inserts == 1000 );
+			BOOST_CHECK( result.num_erases == 334 );
+			BOOST_CHECK( result.num_searches == 100 );
+			BOOST_CHECK( result.num_mismatches == 0 );
+			BOOST_CHECK( other.count_all() == tree.count_all() );
+		}
+
+		{
+			LinearLooseOctree<uint32_t> other( TREE_SIZE );
+			Trace::ReplayResult result;
+
+			BOOST_REQUIRE( trace.replay( other, result ) );
+			BOOST_CHECK( result.num_searches == 100 );
+			BOOST_CHECK( result.num_mismatches == 0 );
+		}
+
+		{
+			ShardedLooseOctree<uint32_t> other( TREE_SIZE, 32 );
+			Trace::ReplayResult result;
+
+			BOOST_REQUIRE( trace.replay( other, result ) );
+			BOOST_CHECK( result.num_searches == 100 );
+			BOOST_CHECK( result.num_mismatches == 0 );
+			BOOST_CHECK( other.count_all() == tree.count_all() );
+		}
+
+		// Different results are detected.
+		{
+			IntOctree other( TREE_SIZE );
+			Trace::ReplayResult result;
+
+			other.insert( -1, IntOctree::DataCuboid( 0, 0, 0, TREE_SIZE, TREE_SIZE, TREE_SIZE ) );
+
+			BOOST_REQUIRE( trace.replay( other, result ) );
+			BOOST_CHECK( result.num_mismatches == 100 );
+		}
+
+		// Results add up.
+		{
+			IntOctree other( TREE_SIZE );
+			IntOctree another( TREE_SIZE );
+			Trace::ReplayResult result;
+
+			BOOST_REQUIRE( trace.replay( other, result ) );
+			BOOST_REQUIRE( trace.replay( another, result ) );
+			BOOST_CHECK( result.num_inserts == 2000 );
+			BOOST_CHECK( result.num_searches == 200 );
+		}
+	}
+
+	// Loading.
+	{
+		IntOctree tree( TREE_SIZE );
+		Trace trace;
+		RecordingIntOctree recording( tree, trace );
+
+		record( recording );
+
+		std::vector<char> bytes( trace.get_bytes(), trace.get_bytes() + trace.get_num_bytes() );
+		Trace loaded;
+
+		BOOST_REQUIRE( loaded.load( bytes.data(), bytes.size() ) );
+		BOOST_CHECK( loaded.get_num_bytes() == trace.get_num_bytes() );
+		BOOST_CHECK( loaded.get_num_items() == trace.get_num_items() );
+		BOOST_CHECK( loaded.get_size() == TREE_SIZE );
+
+		IntOctree other( TREE_SIZE );
+		Trace::ReplayResult result;
+
+		BOOST_REQUIRE( loaded.replay( other, result ) );
+		BOOST_CHECK( result.num_inserts == 1000 );
+		BOOST_CHECK( result.num_mismatches == 0 );
+
+		// Truncated records.
+		BOOST_CHECK( loaded.load( bytes.data(), bytes.size() - 1 ) == false );
+		BOOST_CHECK( loaded.is_empty() );
+		BOOST_CHECK( loaded.get_num_items() == 0 );
+
+		// Header.
+		BOOST_CHECK( loaded.load( bytes.data(), sizeof( WorkloadTraceHeader ) ) );
+		BOOST_CHECK( loaded.is_empty() );
+
+		BOOST_CHECK( loaded.load( bytes.data(), sizeof( WorkloadTraceHeader ) - 1 ) == false );
+
+		std::vector<char> corrupt( bytes );
+		corrupt[0] = 'X';
+		BOOST_CHECK( loaded.load( corrupt.data(), corrupt.size() ) == false );
+
+		corrupt = bytes;
+		corrupt[sizeof( WorkloadTraceHeader )] = 7;
+		BOOST_CHECK( loaded.load( corrupt.data(), corrupt.size() ) == false );
+
+		BOOST_CHECK( WorkloadTrace<double>().load( bytes.data(), bytes.size() ) == false );
+	}
+
+	// Erasing items not in the index stops the replay.
+	{
+		Trace trace( TREE_SIZE );
+		uint32_t item = trace.record_insert( IntOctree::DataCuboid( 0, 0, 0, 1, 1, 1 ) );
+
+		trace.record_erase( item );
+		trace.record_erase( item );
+
+		IntOctree other( TREE_SIZE );
+		Trace::ReplayResult result;
+
+		BOOST_CHECK( trace.replay( other, result ) == false );
+		BOOST_CHECK( result.num_erases == 1 );
+	}
+}